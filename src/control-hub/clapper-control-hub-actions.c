@@ -20,40 +20,91 @@
 
 #include "clapper-control-hub-actions.h"
 
+#define _VERB_IS(v) (memcmp (text, v, sizeof (v) - 1) == 0)
+
+/* Returns action when text consists of exactly
+ * given verb, or verb followed by space and arg(s) */
+#define _MATCH_VERB(v,a,args) {                                \
+    if (_VERB_IS (v))                                          \
+      return (has_args == args) ? a : CLAPPER_CONTROL_HUB_ACTION_INVALID; }
+
+/*
+ * Verb length together with its first character identifies
+ * almost every action, so at most two comparisons are made.
+ */
 inline ClapperControlHubAction
 clapper_control_hub_actions_get_action (const gchar *text)
 {
-  /* Actions without arg(s) */
-  if (strcmp (text, "toggle_play") == 0)
-    return CLAPPER_CONTROL_HUB_ACTION_TOGGLE_PLAY;
-  if (strcmp (text, "play") == 0)
-    return CLAPPER_CONTROL_HUB_ACTION_PLAY;
-  if (strcmp (text, "pause") == 0)
-    return CLAPPER_CONTROL_HUB_ACTION_PAUSE;
-  if (strcmp (text, "stop") == 0)
-    return CLAPPER_CONTROL_HUB_ACTION_STOP;
-  if (strcmp (text, "clear") == 0)
-    return CLAPPER_CONTROL_HUB_ACTION_CLEAR;
-
-  /* Actions followed by space and arg(s) */
-  if (g_str_has_prefix (text, "seek "))
-    return CLAPPER_CONTROL_HUB_ACTION_SEEK;
-  if (g_str_has_prefix (text, "set_speed "))
-    return CLAPPER_CONTROL_HUB_ACTION_SET_SPEED;
-  if (g_str_has_prefix (text, "set_volume "))
-    return CLAPPER_CONTROL_HUB_ACTION_SET_VOLUME;
-  if (g_str_has_prefix (text, "set_mute "))
-    return CLAPPER_CONTROL_HUB_ACTION_SET_MUTE;
-  if (g_str_has_prefix (text, "set_progression "))
-    return CLAPPER_CONTROL_HUB_ACTION_SET_PROGRESSION;
-  if (g_str_has_prefix (text, "add "))
-    return CLAPPER_CONTROL_HUB_ACTION_ADD;
-  if (g_str_has_prefix (text, "insert "))
-    return CLAPPER_CONTROL_HUB_ACTION_INSERT;
-  if (g_str_has_prefix (text, "select "))
-    return CLAPPER_CONTROL_HUB_ACTION_SELECT;
-  if (g_str_has_prefix (text, "remove "))
-    return CLAPPER_CONTROL_HUB_ACTION_REMOVE;
+  gsize len = 0;
+  gboolean has_args;
+
+  while (text[len] != '\0' && text[len] != ' ')
+    ++len;
+
+  has_args = (text[len] == ' ');
+
+  switch (len) {
+    case 3:
+      _MATCH_VERB ("add", CLAPPER_CONTROL_HUB_ACTION_ADD, TRUE);
+      break;
+    case 4:
+      switch (text[0]) {
+        case 'p':
+          _MATCH_VERB ("play", CLAPPER_CONTROL_HUB_ACTION_PLAY, FALSE);
+          break;
+        case 's':
+          _MATCH_VERB ("stop", CLAPPER_CONTROL_HUB_ACTION_STOP, FALSE);
+          _MATCH_VERB ("seek", CLAPPER_CONTROL_HUB_ACTION_SEEK, TRUE);
+          break;
+        default:
+          break;
+      }
+      break;
+    case 5:
+      switch (text[0]) {
+        case 'p':
+          _MATCH_VERB ("pause", CLAPPER_CONTROL_HUB_ACTION_PAUSE, FALSE);
+          break;
+        case 'c':
+          _MATCH_VERB ("clear", CLAPPER_CONTROL_HUB_ACTION_CLEAR, FALSE);
+          break;
+        default:
+          break;
+      }
+      break;
+    case 6:
+      switch (text[0]) {
+        case 'i':
+          _MATCH_VERB ("insert", CLAPPER_CONTROL_HUB_ACTION_INSERT, TRUE);
+          break;
+        case 's':
+          _MATCH_VERB ("select", CLAPPER_CONTROL_HUB_ACTION_SELECT, TRUE);
+          break;
+        case 'r':
+          _MATCH_VERB ("remove", CLAPPER_CONTROL_HUB_ACTION_REMOVE, TRUE);
+          break;
+        default:
+          break;
+      }
+      break;
+    case 8:
+      _MATCH_VERB ("set_mute", CLAPPER_CONTROL_HUB_ACTION_SET_MUTE, TRUE);
+      break;
+    case 9:
+      _MATCH_VERB ("set_speed", CLAPPER_CONTROL_HUB_ACTION_SET_SPEED, TRUE);
+      break;
+    case 10:
+      _MATCH_VERB ("set_volume", CLAPPER_CONTROL_HUB_ACTION_SET_VOLUME, TRUE);
+      break;
+    case 11:
+      _MATCH_VERB ("toggle_play", CLAPPER_CONTROL_HUB_ACTION_TOGGLE_PLAY, FALSE);
+      break;
+    case 15:
+      _MATCH_VERB ("set_progression", CLAPPER_CONTROL_HUB_ACTION_SET_PROGRESSION, TRUE);
+      break;
+    default:
+      break;
+  }
 
   return CLAPPER_CONTROL_HUB_ACTION_INVALID;
 }
@@ -94,6 +145,27 @@ _parse_uint (const gchar *text, guint *val)
   return TRUE;
 }
 
+/*
+ * Same check as gst_uri_is_valid(), but for not NUL terminated
+ * string, so URI can be validated directly within frame text.
+ */
+static gboolean
+_uri_is_valid (const gchar *uri, gsize len)
+{
+  gsize i;
+
+  if (len == 0 || !g_ascii_isalpha (uri[0]))
+    return FALSE;
+
+  for (i = 1; i < len; ++i) {
+    if (!g_ascii_isalnum (uri[i]) && uri[i] != '+' && uri[i] != '-' && uri[i] != '.')
+      break;
+  }
+
+  /* At least two characters long protocol, so drive letters are not one */
+  return (i < len && uri[i] == ':' && i >= 2);
+}
+
 static gboolean
 _parse_double (const gchar *text, gdouble *val)
 {
@@ -180,25 +252,32 @@ clapper_control_hub_actions_parse_add (const gchar *text, const gchar **uri)
   return TRUE;
 }
 
+/*
+ * URI is returned as a pointer into text together with its
+ * length, so it is only copied once item is going to be created.
+ */
 inline gboolean
-clapper_control_hub_actions_parse_insert (const gchar *text, gchar **uri, guint *after_id)
+clapper_control_hub_actions_parse_insert (const gchar *text, const gchar **uri, gsize *uri_len, guint *after_id)
 {
-  gchar **data;
-  gboolean res;
+  const gchar *sep;
 
   /* "insert" + whitespace = 7 */
   text += 7;
-  data = g_strsplit (text, " ", 2);
 
-  if ((res = (g_strv_length (data) == 2
-      && gst_uri_is_valid (data[0])
-      && _parse_uint (data[1], after_id)))) {
-    *uri = g_strdup (data[0]);
-  }
+  /* URI cannot contain spaces, so ID follows the first one */
+  if (!(sep = strchr (text, ' ')) || sep == text)
+    return FALSE;
+
+  if (!_parse_uint (sep + 1, after_id))
+    return FALSE;
 
-  g_strfreev (data);
+  if (!_uri_is_valid (text, sep - text))
+    return FALSE;
 
-  return res;
+  *uri = text;
+  *uri_len = sep - text;
+
+  return TRUE;
 }
 
 inline gboolean
@@ -64,7 +64,7 @@ G_GNUC_INTERNAL
 gboolean clapper_control_hub_actions_parse_add (const gchar *text, const gchar **uri);
 
 G_GNUC_INTERNAL
-gboolean clapper_control_hub_actions_parse_insert (const gchar *text, gchar **uri, guint *after_id);
+gboolean clapper_control_hub_actions_parse_insert (const gchar *text, const gchar **uri, gsize *uri_len, guint *after_id);
 
 G_GNUC_INTERNAL
 gboolean clapper_control_hub_actions_parse_select (const gchar *text, guint *id);
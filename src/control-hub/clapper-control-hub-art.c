@@ -0,0 +1,489 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Serves artwork of queue items. Images are optionally downscaled
+ * on a worker thread and encoded results are kept in a LRU cache,
+ * so the same image is not processed again for each request.
+ */
+
+#include "config.h"
+
+#include <gst/gst.h>
+
+#ifdef HAVE_IMAGE_UTILS
+#include "../utils/c/image/image-utils.h"
+#endif
+
+#include "clapper-control-hub-art.h"
+
+/* Total size of cached images */
+#define CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+#define GST_CAT_DEFAULT clapper_control_hub_art_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+struct _ClapperControlHubArtCache
+{
+  GMainContext *context;
+  GThreadPool *pool;
+
+  /* Key is "<id>:<size>", newest entries are at head */
+  GHashTable *entries;
+  GQueue lru;
+  gsize total_size;
+
+  /* Requests awaiting result of the same key */
+  GHashTable *waiting;
+
+  /* Incremented for each started job */
+  guint64 generation;
+};
+
+typedef struct
+{
+  GPtrArray *msgs;
+
+  /* Generation of the job that will respond, results
+   * of other (outdated) jobs for the same key are dropped */
+  guint64 generation;
+} ClapperControlHubArtWaiting;
+
+typedef struct
+{
+  gchar *key;
+  guint id;
+
+  GBytes *bytes;
+  gchar *content_type;
+  gchar *etag;
+
+  GList *link;
+} ClapperControlHubArtEntry;
+
+typedef struct
+{
+  ClapperControlHubArtCache *cache;
+  gchar *key;
+  guint id;
+  guint size;
+  GstSample *sample;
+  guint64 generation;
+
+  /* Result */
+  GBytes *bytes;
+  gchar *content_type;
+} ClapperControlHubArtJob;
+
+void
+clapper_control_hub_art_debug_init (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubart",
+      GST_DEBUG_FG_CYAN, "Clapper Control Hub Art");
+}
+
+static void
+_entry_free (ClapperControlHubArtEntry *entry)
+{
+  g_free (entry->key);
+  g_bytes_unref (entry->bytes);
+  g_free (entry->content_type);
+  g_free (entry->etag);
+
+  g_free (entry);
+}
+
+static void
+_waiting_free (ClapperControlHubArtWaiting *waiting)
+{
+  g_ptr_array_unref (waiting->msgs);
+  g_free (waiting);
+}
+
+static void
+_cache_clear_func (ClapperControlHubArtCache *cache)
+{
+  g_main_context_unref (cache->context);
+  g_hash_table_unref (cache->entries);
+  g_hash_table_unref (cache->waiting);
+}
+
+static void
+_job_free (ClapperControlHubArtJob *job)
+{
+  g_atomic_rc_box_release_full (job->cache, (GDestroyNotify) _cache_clear_func);
+
+  g_free (job->key);
+  gst_sample_unref (job->sample);
+
+  if (job->bytes)
+    g_bytes_unref (job->bytes);
+  g_free (job->content_type);
+
+  g_free (job);
+}
+
+static void
+_cache_remove_entry (ClapperControlHubArtCache *cache, ClapperControlHubArtEntry *entry)
+{
+  g_queue_delete_link (&cache->lru, entry->link);
+  cache->total_size -= g_bytes_get_size (entry->bytes);
+
+  /* Frees entry */
+  g_hash_table_remove (cache->entries, entry->key);
+}
+
+static void
+_respond (SoupServerMessage *msg, ClapperControlHubArtEntry *entry)
+{
+  SoupMessageHeaders *headers = soup_server_message_get_response_headers (msg);
+  const gchar *if_none_match;
+
+  soup_message_headers_replace (headers, "ETag", entry->etag);
+
+  if_none_match = soup_message_headers_get_one (
+      soup_server_message_get_request_headers (msg), "If-None-Match");
+
+  if (g_strcmp0 (if_none_match, entry->etag) == 0) {
+    soup_server_message_set_status (msg, SOUP_STATUS_NOT_MODIFIED, NULL);
+    return;
+  }
+
+  soup_message_headers_set_content_type (headers, entry->content_type, NULL);
+  soup_message_body_append_bytes (soup_server_message_get_response_body (msg), entry->bytes);
+  soup_server_message_set_status (msg, SOUP_STATUS_OK, NULL);
+}
+
+/* Image is only linked, let client fetch it directly */
+static void
+_respond_redirect (SoupServerMessage *msg, GstSample *sample)
+{
+  GstBuffer *buffer = gst_sample_get_buffer (sample);
+  GstMapInfo map_info;
+
+  if (buffer && gst_buffer_map (buffer, &map_info, GST_MAP_READ)) {
+    gchar *uri = g_strndup ((const gchar *) map_info.data, map_info.size);
+
+    g_strchomp (uri);
+    soup_server_message_set_redirect (msg, SOUP_STATUS_FOUND, uri);
+
+    g_free (uri);
+    gst_buffer_unmap (buffer, &map_info);
+  } else {
+    soup_server_message_set_status (msg, SOUP_STATUS_NOT_FOUND, NULL);
+  }
+}
+
+static inline gboolean
+_sample_is_uri_list (GstSample *sample)
+{
+  return gst_structure_has_name (gst_caps_get_structure (
+      gst_sample_get_caps (sample), 0), "text/uri-list");
+}
+
+#ifdef HAVE_IMAGE_UTILS
+static gboolean
+_downscale (ClapperControlHubArtJob *job, const guint8 *data, gsize data_size)
+{
+  GError *error = NULL;
+  const gchar *content_type = NULL;
+
+  job->bytes = image_utils_downscale (data, data_size, job->size, &content_type, &error);
+
+  if (job->bytes) {
+    job->content_type = g_strdup (content_type);
+  } else if (error) {
+    GST_WARNING ("Could not downscale image: %s", error->message);
+    g_error_free (error);
+  }
+
+  return (job->bytes != NULL);
+}
+#endif
+
+static gboolean
+_on_job_done_cb (ClapperControlHubArtJob *job)
+{
+  ClapperControlHubArtCache *cache = job->cache;
+  ClapperControlHubArtEntry *entry = NULL;
+  ClapperControlHubArtWaiting *waiting;
+  GPtrArray *msgs;
+  gchar *checksum;
+  guint i;
+
+  waiting = g_hash_table_lookup (cache->waiting, job->key);
+
+  /* Item was invalidated while processing. Either there is nobody to respond
+   * to anymore or a newer job was started for the same key and will do it. */
+  if (G_UNLIKELY (waiting == NULL || waiting->generation != job->generation)) {
+    GST_DEBUG ("Dropping outdated art: %s", job->key);
+    return G_SOURCE_REMOVE;
+  }
+
+  msgs = g_ptr_array_ref (waiting->msgs);
+  g_hash_table_remove (cache->waiting, job->key);
+
+  if (job->bytes) {
+    entry = g_new0 (ClapperControlHubArtEntry, 1);
+    entry->key = g_strdup (job->key);
+    entry->id = job->id;
+    entry->bytes = g_bytes_ref (job->bytes);
+    entry->content_type = g_strdup (job->content_type);
+
+    /* Strong ETag from content, so it stays the same between player runs */
+    checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, entry->bytes);
+    entry->etag = g_strdup_printf ("\"%s\"", checksum);
+    g_free (checksum);
+
+    g_hash_table_insert (cache->entries, entry->key, entry);
+    g_queue_push_head (&cache->lru, entry);
+    entry->link = cache->lru.head;
+    cache->total_size += g_bytes_get_size (entry->bytes);
+
+    /* Evict least recently used, but always keep the new one */
+    while (cache->total_size > CACHE_MAX_SIZE && cache->lru.length > 1)
+      _cache_remove_entry (cache, g_queue_peek_tail (&cache->lru));
+  }
+
+  for (i = 0; i < msgs->len; ++i) {
+    SoupServerMessage *msg = g_ptr_array_index (msgs, i);
+
+    if (entry)
+      _respond (msg, entry);
+    else
+      soup_server_message_set_status (msg, SOUP_STATUS_INTERNAL_SERVER_ERROR, NULL);
+
+    soup_server_message_unpause (msg);
+  }
+
+  g_ptr_array_unref (msgs);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_process_in_thread (ClapperControlHubArtJob *job, ClapperControlHubArtCache *cache)
+{
+  GstBuffer *buffer = gst_sample_get_buffer (job->sample);
+  GstMapInfo map_info;
+
+  GST_DEBUG ("Processing art: %s", job->key);
+
+  if (buffer && gst_buffer_map (buffer, &map_info, GST_MAP_READ)) {
+#ifdef HAVE_IMAGE_UTILS
+    if (job->size == 0 || !_downscale (job, map_info.data, map_info.size))
+#endif
+    {
+      const GstStructure *structure = gst_caps_get_structure (gst_sample_get_caps (job->sample), 0);
+
+      job->bytes = g_bytes_new (map_info.data, map_info.size);
+      job->content_type = g_strdup (gst_structure_get_name (structure));
+    }
+    gst_buffer_unmap (buffer, &map_info);
+  }
+
+  g_main_context_invoke_full (cache->context, G_PRIORITY_DEFAULT,
+      (GSourceFunc) _on_job_done_cb, job, (GDestroyNotify) _job_free);
+}
+
+ClapperControlHubArtCache *
+clapper_control_hub_art_cache_new (GMainContext *context)
+{
+  ClapperControlHubArtCache *cache = g_atomic_rc_box_new0 (ClapperControlHubArtCache);
+
+  cache->context = g_main_context_ref (context);
+  cache->pool = g_thread_pool_new_full ((GFunc) _process_in_thread,
+      cache, (GDestroyNotify) _job_free, 1, FALSE, NULL);
+  cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+      NULL, (GDestroyNotify) _entry_free);
+  g_queue_init (&cache->lru);
+  cache->waiting = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) _waiting_free);
+
+  return cache;
+}
+
+/*
+ * Drops queued jobs. Ones that are being processed hold a reference
+ * to cache (and so its context), so their results are just discarded.
+ */
+void
+clapper_control_hub_art_cache_free (ClapperControlHubArtCache *cache)
+{
+  g_thread_pool_free (cache->pool, TRUE, FALSE);
+  cache->pool = NULL;
+
+  clapper_control_hub_art_clear (cache);
+
+  g_atomic_rc_box_release_full (cache, (GDestroyNotify) _cache_clear_func);
+}
+
+static void
+_start_job (ClapperControlHubArtCache *cache, ClapperControlHubArtWaiting *waiting,
+    const gchar *key, guint id, guint size, GstSample *sample)
+{
+  ClapperControlHubArtJob *job = g_new0 (ClapperControlHubArtJob, 1);
+
+  job->cache = g_atomic_rc_box_acquire (cache);
+  job->key = g_strdup (key);
+  job->id = id;
+  job->size = size;
+  job->sample = gst_sample_ref (sample);
+  job->generation = waiting->generation = ++cache->generation;
+
+  g_thread_pool_push (cache->pool, job, NULL);
+}
+
+/*
+ * Responds with art image from sample, downscaled to fit into
+ * @size (if not zero). Processing happens asynchronously when
+ * result is not in cache yet, so message is paused meanwhile.
+ */
+void
+clapper_control_hub_art_serve (ClapperControlHubArtCache *cache, SoupServerMessage *msg,
+    guint id, GstSample *sample, guint size)
+{
+  ClapperControlHubArtEntry *entry;
+  ClapperControlHubArtWaiting *waiting;
+  gchar *key;
+
+  if (_sample_is_uri_list (sample)) {
+    _respond_redirect (msg, sample);
+    return;
+  }
+
+  key = g_strdup_printf ("%u:%u", id, size);
+
+  if ((entry = g_hash_table_lookup (cache->entries, key))) {
+    GST_LOG ("Serving cached art: %s", key);
+
+    g_queue_unlink (&cache->lru, entry->link);
+    g_queue_push_head_link (&cache->lru, entry->link);
+
+    _respond (msg, entry);
+    g_free (key);
+
+    return;
+  }
+
+  soup_server_message_pause (msg);
+
+  /* Same image is already being processed */
+  if ((waiting = g_hash_table_lookup (cache->waiting, key))) {
+    g_ptr_array_add (waiting->msgs, g_object_ref (msg));
+    g_free (key);
+
+    return;
+  }
+
+  waiting = g_new0 (ClapperControlHubArtWaiting, 1);
+  waiting->msgs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+  g_ptr_array_add (waiting->msgs, g_object_ref (msg));
+  g_hash_table_insert (cache->waiting, key, waiting);
+
+  _start_job (cache, waiting, key, id, size, sample);
+}
+
+static gboolean
+_parse_key (const gchar *key, guint *id, guint *size)
+{
+  gchar *endptr = NULL;
+
+  *id = (guint) g_ascii_strtoull (key, &endptr, 10);
+  if (*endptr != ':')
+    return FALSE;
+
+  *size = (guint) g_ascii_strtoull (endptr + 1, NULL, 10);
+
+  return TRUE;
+}
+
+/*
+ * Handles requests waiting for images of given item (or all
+ * items when @all is set). With @sample, processing is restarted
+ * using it, otherwise requests are answered with "Not Found".
+ */
+static void
+_restart_waiting (ClapperControlHubArtCache *cache, guint id, gboolean all, GstSample *sample)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, cache->waiting);
+
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    ClapperControlHubArtWaiting *waiting = value;
+    guint i, key_id, key_size;
+
+    if (!_parse_key (key, &key_id, &key_size) || (!all && key_id != id))
+      continue;
+
+    /* Jobs for older image are still running, their results are dropped */
+    if (sample && !_sample_is_uri_list (sample)) {
+      GST_DEBUG ("Restarting art processing: %s", (const gchar *) key);
+      _start_job (cache, waiting, key, key_id, key_size, sample);
+
+      continue;
+    }
+
+    for (i = 0; i < waiting->msgs->len; ++i) {
+      SoupServerMessage *msg = g_ptr_array_index (waiting->msgs, i);
+
+      if (sample)
+        _respond_redirect (msg, sample);
+      else
+        soup_server_message_set_status (msg, SOUP_STATUS_NOT_FOUND, NULL);
+
+      soup_server_message_unpause (msg);
+    }
+
+    g_hash_table_iter_remove (&iter);
+  }
+}
+
+/*
+ * Drops cached images of given item, e.g. after its tags changed
+ * or it was removed. When item still has an image, @sample should be
+ * set to it, so requests that were waiting for processing of the old
+ * one are served with the new image instead.
+ */
+void
+clapper_control_hub_art_invalidate (ClapperControlHubArtCache *cache, guint id, GstSample *sample)
+{
+  GList *link = cache->lru.head;
+
+  while (link) {
+    ClapperControlHubArtEntry *entry = link->data;
+
+    link = link->next;
+
+    if (entry->id == id)
+      _cache_remove_entry (cache, entry);
+  }
+
+  _restart_waiting (cache, id, FALSE, sample);
+}
+
+void
+clapper_control_hub_art_clear (ClapperControlHubArtCache *cache)
+{
+  while (cache->lru.length > 0)
+    _cache_remove_entry (cache, g_queue_peek_head (&cache->lru));
+
+  _restart_waiting (cache, 0, TRUE, NULL);
+}
@@ -0,0 +1,46 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ClapperControlHubArtCache ClapperControlHubArtCache;
+
+void clapper_control_hub_art_debug_init (void);
+
+G_GNUC_INTERNAL
+ClapperControlHubArtCache * clapper_control_hub_art_cache_new (GMainContext *context);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_art_cache_free (ClapperControlHubArtCache *cache);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_art_serve (ClapperControlHubArtCache *cache, SoupServerMessage *msg, guint id, GstSample *sample, guint size);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_art_invalidate (ClapperControlHubArtCache *cache, guint id, GstSample *sample);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_art_clear (ClapperControlHubArtCache *cache);
+
+G_END_DECLS
@@ -0,0 +1,507 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Pairing with a shared token. Client receives random nonce once per
+ * connection and proves it knows the token by sending back HMAC-SHA256
+ * of that nonce keyed with it.
+ *
+ * Successful pairing creates a session. Its key is HMAC-SHA256 of
+ * "session:<nonce>" keyed with the token, so both sides derive it
+ * without ever sending it. Reconnecting client passes session ID and
+ * answers the challenge with HMAC of the fresh nonce keyed with session
+ * key instead, thus observed IDs cannot be replayed. Session ID is
+ * rotated on each successful challenge.
+ *
+ * HTTP requests are signed with session key too. Signature covers
+ * request method, path and client timestamp, which must be recent and
+ * increasing within session, so observed requests cannot be replayed.
+ *
+ * Attempts and failures are limited per remote host.
+ */
+
+#include "config.h"
+
+#ifdef _WIN32
+#define _CRT_RAND_S
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_GETRANDOM
+#include <sys/random.h>
+#elif defined (__unix__) || defined (__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "clapper-control-hub-auth.h"
+
+#define NONCE_N_BYTES 16
+#define SESSION_ID_N_BYTES 16
+
+/* How long session can be resumed after pairing */
+#define SESSION_LIFETIME (24 * G_TIME_SPAN_HOUR)
+
+/* Largest accepted difference (in milliseconds) between
+ * timestamp of signed HTTP request and server clock */
+#define REQUEST_MAX_SKEW (60 * 1000)
+
+/* Oldest sessions are dropped above that */
+#define MAX_SESSIONS 64
+
+/* Per remote host limits within a time window. Host that
+ * goes over them is refused until block time passes. */
+#define LIMIT_WINDOW (G_TIME_SPAN_MINUTE)
+#define MAX_ATTEMPTS 20
+#define MAX_FAILURES 5
+#define BLOCK_TIME (5 * G_TIME_SPAN_MINUTE)
+
+/* Stale hosts are forgotten above that */
+#define MAX_LIMITS 256
+
+#define GST_CAT_DEFAULT clapper_control_hub_auth_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+typedef struct
+{
+  /* Hex encoded, never sent */
+  gchar *key;
+
+  gint64 created;
+
+  /* Timestamp of the last accepted signed request */
+  gint64 last_request;
+} ClapperControlHubAuthSession;
+
+typedef struct
+{
+  gint64 window_start;
+  guint n_attempts;
+  guint n_failures;
+  gint64 blocked_until;
+} ClapperControlHubAuthLimit;
+
+void
+clapper_control_hub_auth_debug_init (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubauth",
+      GST_DEBUG_FG_CYAN, "Clapper Control Hub Auth");
+}
+
+static void
+_session_free (ClapperControlHubAuthSession *session)
+{
+  g_free (session->key);
+  g_free (session);
+}
+
+/* Reads from OS random source, never falls back
+ * to a pseudo random generator */
+static gboolean
+_read_random (guint8 *buf, gsize len)
+{
+#if defined (HAVE_GETRANDOM)
+  gsize done = 0;
+
+  while (done < len) {
+    gssize res = getrandom (buf + done, len - done, 0);
+
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return FALSE;
+    }
+    done += res;
+  }
+
+  return TRUE;
+#elif defined (__unix__) || defined (__APPLE__)
+  gsize done = 0;
+  gint fd;
+
+  if ((fd = open ("/dev/urandom", O_RDONLY | O_CLOEXEC)) < 0)
+    return FALSE;
+
+  while (done < len) {
+    gssize res = read (fd, buf + done, len - done);
+
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res <= 0)
+      break;
+
+    done += res;
+  }
+
+  close (fd);
+
+  return (done == len);
+#elif defined (_WIN32)
+  gsize i;
+
+  for (i = 0; i < len; i += sizeof (guint)) {
+    guint val;
+
+    if (rand_s (&val) != 0)
+      return FALSE;
+
+    memcpy (buf + i, &val, MIN (sizeof (val), len - i));
+  }
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+static gchar *
+_new_random_hex (gsize n_bytes)
+{
+  guint8 buf[32];
+  GString *hex;
+  gsize i;
+
+  g_return_val_if_fail (n_bytes <= sizeof (buf), NULL);
+
+  if (!_read_random (buf, n_bytes)) {
+    GST_ERROR ("Could not read OS random source");
+    return NULL;
+  }
+
+  hex = g_string_sized_new (n_bytes * 2);
+
+  for (i = 0; i < n_bytes; ++i)
+    g_string_append_printf (hex, "%02x", buf[i]);
+
+  return g_string_free (hex, FALSE);
+}
+
+/* Compares without exiting early, so timing does not reveal
+ * how many leading characters of the response were correct */
+static gboolean
+_secure_equal (const gchar *a, const gchar *b)
+{
+  gsize i, len = strlen (a);
+  guint8 diff = 0;
+
+  if (strlen (b) != len)
+    return FALSE;
+
+  for (i = 0; i < len; ++i)
+    diff |= g_ascii_tolower (a[i]) ^ g_ascii_tolower (b[i]);
+
+  return (diff == 0);
+}
+
+static gchar *
+_compute_hmac (const gchar *key, const gchar *data)
+{
+  return g_compute_hmac_for_string (G_CHECKSUM_SHA256,
+      (const guchar *) key, strlen (key), data, -1);
+}
+
+static void
+_drop_expired_sessions (ClapperControlHub *hub, gint64 now)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  gint64 oldest_time = G_MAXINT64;
+  gpointer oldest = NULL;
+
+  g_hash_table_iter_init (&iter, hub->auth_sessions);
+
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    ClapperControlHubAuthSession *session = value;
+
+    if (now - session->created > SESSION_LIFETIME) {
+      g_hash_table_iter_remove (&iter);
+    } else if (session->created < oldest_time) {
+      oldest_time = session->created;
+      oldest = key;
+    }
+  }
+
+  if (oldest && g_hash_table_size (hub->auth_sessions) >= MAX_SESSIONS)
+    g_hash_table_remove (hub->auth_sessions, oldest);
+}
+
+static ClapperControlHubAuthSession *
+_lookup_session (ClapperControlHub *hub, const gchar *id, gint64 now)
+{
+  ClapperControlHubAuthSession *session;
+
+  if (!(session = g_hash_table_lookup (hub->auth_sessions, id)))
+    return NULL;
+
+  if (now - session->created > SESSION_LIFETIME) {
+    g_hash_table_remove (hub->auth_sessions, id);
+    return NULL;
+  }
+
+  return session;
+}
+
+/* Returns limit entry of host with its window advanced to now */
+static ClapperControlHubAuthLimit *
+_get_limit (ClapperControlHub *hub, const gchar *remote_host, gint64 now)
+{
+  ClapperControlHubAuthLimit *limit;
+
+  if (!(limit = g_hash_table_lookup (hub->auth_limits, remote_host))) {
+    /* Forget hosts that are neither blocked nor recently seen */
+    if (g_hash_table_size (hub->auth_limits) >= MAX_LIMITS) {
+      GHashTableIter iter;
+      gpointer value;
+
+      g_hash_table_iter_init (&iter, hub->auth_limits);
+
+      while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        ClapperControlHubAuthLimit *stale = value;
+
+        if (now >= stale->blocked_until && now - stale->window_start > LIMIT_WINDOW)
+          g_hash_table_iter_remove (&iter);
+      }
+
+      /* Too many hosts at once, refuse until some expire */
+      if (g_hash_table_size (hub->auth_limits) >= MAX_LIMITS)
+        return NULL;
+    }
+
+    limit = g_new0 (ClapperControlHubAuthLimit, 1);
+    limit->window_start = now;
+    g_hash_table_insert (hub->auth_limits, g_strdup (remote_host), limit);
+  }
+
+  if (now - limit->window_start > LIMIT_WINDOW) {
+    limit->window_start = now;
+    limit->n_attempts = 0;
+    limit->n_failures = 0;
+  }
+
+  return limit;
+}
+
+static void
+_report_failure (ClapperControlHub *hub, const gchar *remote_host)
+{
+  ClapperControlHubAuthLimit *limit;
+  gint64 now = g_get_monotonic_time ();
+
+  GST_WARNING_OBJECT (hub, "Client %s failed authentication", GST_STR_NULL (remote_host));
+
+  if (!remote_host || !(limit = _get_limit (hub, remote_host, now)))
+    return;
+
+  if (++limit->n_failures >= MAX_FAILURES) {
+    GST_WARNING_OBJECT (hub, "Blocking %s after %u failed attempts",
+        remote_host, limit->n_failures);
+    limit->blocked_until = now + BLOCK_TIME;
+  }
+}
+
+static gboolean
+_is_blocked (ClapperControlHub *hub, const gchar *remote_host, gint64 now)
+{
+  ClapperControlHubAuthLimit *limit;
+
+  if (!remote_host || !(limit = _get_limit (hub, remote_host, now)))
+    return TRUE;
+
+  return (now < limit->blocked_until);
+}
+
+void
+clapper_control_hub_auth_init (ClapperControlHub *hub)
+{
+  hub->auth_sessions = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) _session_free);
+  hub->auth_limits = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, g_free);
+}
+
+void
+clapper_control_hub_auth_finalize (ClapperControlHub *hub)
+{
+  g_hash_table_unref (hub->auth_sessions);
+  g_hash_table_unref (hub->auth_limits);
+}
+
+/* Returns %NULL if OS random source could not be read */
+gchar *
+clapper_control_hub_auth_new_nonce (void)
+{
+  return _new_random_hex (NONCE_N_BYTES);
+}
+
+/*
+ * Counts an authentication attempt (connection that gets challenged)
+ * of given host. Returns %FALSE when host should be refused.
+ */
+gboolean
+clapper_control_hub_auth_allow_attempt (ClapperControlHub *hub, const gchar *remote_host)
+{
+  ClapperControlHubAuthLimit *limit;
+  gint64 now = g_get_monotonic_time ();
+
+  if (!remote_host || !(limit = _get_limit (hub, remote_host, now)))
+    return FALSE;
+
+  if (now < limit->blocked_until)
+    return FALSE;
+
+  if (++limit->n_attempts > MAX_ATTEMPTS) {
+    GST_WARNING_OBJECT (hub, "Too many attempts from %s", remote_host);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Whether given session can be resumed with a challenge */
+gboolean
+clapper_control_hub_auth_has_session (ClapperControlHub *hub, const gchar *id)
+{
+  return (_lookup_session (hub, id, g_get_monotonic_time ()) != NULL);
+}
+
+/*
+ * Checks client response to given nonce. When @id is set, response
+ * must be keyed with that session key, otherwise with pairing token.
+ * On success returns new ID of the (possibly resumed) session.
+ */
+gchar *
+clapper_control_hub_auth_verify (ClapperControlHub *hub, const gchar *remote_host,
+    const gchar *nonce, const gchar *id, const gchar *response)
+{
+  ClapperControlHubAuthSession *session = NULL;
+  gchar *expected = NULL, *new_id = NULL;
+  gpointer old_id;
+  gint64 now;
+
+  if (G_UNLIKELY (hub->pairing_token == NULL))
+    return NULL;
+
+  now = g_get_monotonic_time ();
+
+  if (_is_blocked (hub, remote_host, now))
+    return NULL;
+
+  if (id && !(session = _lookup_session (hub, id, now)))
+    goto finish;
+
+  expected = _compute_hmac ((session) ? session->key : hub->pairing_token, nonce);
+
+  if (!_secure_equal (expected, response))
+    goto finish;
+
+  if (!(new_id = _new_random_hex (SESSION_ID_N_BYTES)))
+    goto finish;
+
+  if (session) {
+    /* Rotate ID, so previously issued one stops working */
+    g_hash_table_steal_extended (hub->auth_sessions, id, &old_id, NULL);
+    g_free (old_id);
+
+    g_hash_table_insert (hub->auth_sessions, g_strdup (new_id), session);
+
+    GST_DEBUG_OBJECT (hub, "Client resumed session");
+  } else {
+    gchar *key_data = g_strconcat ("session:", nonce, NULL);
+
+    _drop_expired_sessions (hub, now);
+
+    session = g_new0 (ClapperControlHubAuthSession, 1);
+    session->key = _compute_hmac (hub->pairing_token, key_data);
+    session->created = now;
+    g_hash_table_insert (hub->auth_sessions, g_strdup (new_id), session);
+
+    g_free (key_data);
+
+    GST_DEBUG_OBJECT (hub, "Client paired, sessions: %u",
+        g_hash_table_size (hub->auth_sessions));
+  }
+
+finish:
+  if (!new_id)
+    _report_failure (hub, remote_host);
+
+  g_free (expected);
+
+  return new_id;
+}
+
+/*
+ * Checks signed HTTP request credentials in "<id>:<timestamp>:<signature>"
+ * format. Timestamp is Unix time in milliseconds and signature is HMAC-SHA256
+ * of "<method>|<path>|<timestamp>" keyed with session key.
+ */
+gboolean
+clapper_control_hub_auth_check_request (ClapperControlHub *hub, const gchar *remote_host,
+    const gchar *method, const gchar *path, const gchar *credentials)
+{
+  ClapperControlHubAuthSession *session;
+  gchar **parts, *data, *expected, *endptr = NULL;
+  gint64 now = g_get_monotonic_time ();
+  gint64 timestamp, real_now;
+  gboolean success = FALSE;
+
+  if (_is_blocked (hub, remote_host, now))
+    return FALSE;
+
+  parts = g_strsplit (credentials, ":", 3);
+
+  if (g_strv_length (parts) != 3 || !(session = _lookup_session (hub, parts[0], now)))
+    goto finish;
+
+  timestamp = g_ascii_strtoll (parts[1], &endptr, 10);
+  real_now = g_get_real_time () / 1000;
+
+  if (endptr == parts[1] || *endptr != '\0' || ABS (real_now - timestamp) > REQUEST_MAX_SKEW) {
+    GST_DEBUG_OBJECT (hub, "Signed request timestamp out of range");
+    goto finish;
+  }
+
+  data = g_strdup_printf ("%s|%s|%s", method, path, parts[1]);
+  expected = _compute_hmac (session->key, data);
+
+  /* Each timestamp works only once, so request cannot be replayed */
+  if ((success = (_secure_equal (expected, parts[2]) && timestamp > session->last_request)))
+    session->last_request = timestamp;
+
+  g_free (data);
+  g_free (expected);
+
+finish:
+  if (!success)
+    _report_failure (hub, remote_host);
+
+  g_strfreev (parts);
+
+  return success;
+}
+
+/* Forgets all sessions, e.g. when pairing token changes */
+void
+clapper_control_hub_auth_clear (ClapperControlHub *hub)
+{
+  g_hash_table_remove_all (hub->auth_sessions);
+}
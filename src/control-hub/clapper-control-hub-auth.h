@@ -0,0 +1,53 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "clapper-control-hub.h"
+
+G_BEGIN_DECLS
+
+void clapper_control_hub_auth_debug_init (void);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_auth_init (ClapperControlHub *hub);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_auth_finalize (ClapperControlHub *hub);
+
+G_GNUC_INTERNAL
+gchar * clapper_control_hub_auth_new_nonce (void);
+
+G_GNUC_INTERNAL
+gboolean clapper_control_hub_auth_allow_attempt (ClapperControlHub *hub, const gchar *remote_host);
+
+G_GNUC_INTERNAL
+gboolean clapper_control_hub_auth_has_session (ClapperControlHub *hub, const gchar *id);
+
+G_GNUC_INTERNAL
+gchar * clapper_control_hub_auth_verify (ClapperControlHub *hub, const gchar *remote_host, const gchar *nonce, const gchar *id, const gchar *response);
+
+G_GNUC_INTERNAL
+gboolean clapper_control_hub_auth_check_request (ClapperControlHub *hub, const gchar *remote_host, const gchar *method, const gchar *path, const gchar *credentials);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_auth_clear (ClapperControlHub *hub);
+
+G_END_DECLS
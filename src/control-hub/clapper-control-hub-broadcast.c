@@ -0,0 +1,210 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "clapper-control-hub-broadcast.h"
+#include "clapper-control-hub-json.h"
+#include "clapper-control-hub-ws.h"
+
+#define WS_EVENT_SIZE CLAPPER_CONTROL_HUB_JSON_EVENT_SIZE
+
+#define PROPERTY_FIRST CLAPPER_CONTROL_HUB_PROPERTY_STATE
+#define PROPERTY_LAST CLAPPER_CONTROL_HUB_PROPERTY_PROGRESSION
+
+#define GST_CAT_DEFAULT clapper_control_hub_broadcast_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+void
+clapper_control_hub_broadcast_debug_init (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubbroadcast",
+      GST_DEBUG_FG_CYAN, "Clapper Control Hub Broadcast");
+}
+
+/* Formats message with current (latest) value of given property
+ * and either appends it to the frame or sends it right away */
+static void
+_emit_property_message (ClapperControlHub *hub, ClapperControlHubProperty property, GString *frame)
+{
+  gchar data[WS_EVENT_SIZE];
+
+  switch (property) {
+    case CLAPPER_CONTROL_HUB_PROPERTY_STATE:
+      clapper_control_hub_json_fill_state_changed_message (data, hub->state);
+      break;
+    case CLAPPER_CONTROL_HUB_PROPERTY_POSITION:
+      clapper_control_hub_json_fill_position_changed_message (data,
+          hub->position, hub->speed, hub->position_time / 1000);
+      break;
+    case CLAPPER_CONTROL_HUB_PROPERTY_SPEED:
+      clapper_control_hub_json_fill_speed_changed_message (data, hub->speed);
+      break;
+    case CLAPPER_CONTROL_HUB_PROPERTY_VOLUME:
+      clapper_control_hub_json_fill_volume_changed_message (data, hub->volume);
+      break;
+    case CLAPPER_CONTROL_HUB_PROPERTY_MUTE:
+      clapper_control_hub_json_fill_mute_changed_message (data, hub->mute);
+      break;
+    case CLAPPER_CONTROL_HUB_PROPERTY_PLAYED_INDEX:
+      clapper_control_hub_json_fill_played_index_changed_message (data, hub->played_index);
+      break;
+    case CLAPPER_CONTROL_HUB_PROPERTY_PROGRESSION:
+      clapper_control_hub_json_fill_progression_changed_message (data, hub->progression);
+      break;
+    default:
+      g_assert_not_reached ();
+      return;
+  }
+
+  if (frame)
+    g_string_append (frame, data);
+  else
+    clapper_control_hub_ws_send (hub, data);
+}
+
+static gboolean
+_broadcast_timeout_cb (ClapperControlHub *hub)
+{
+  GST_LOG_OBJECT (hub, "Broadcast window elapsed");
+
+  g_clear_pointer (&hub->broadcast_source, g_source_unref);
+  clapper_control_hub_broadcast_flush (hub);
+
+  return G_SOURCE_REMOVE;
+}
+
+static inline void
+_schedule_flush (ClapperControlHub *hub)
+{
+  if (hub->broadcast_source)
+    return;
+
+  hub->broadcast_source = g_timeout_source_new (hub->broadcast_interval);
+  g_source_set_priority (hub->broadcast_source, G_PRIORITY_DEFAULT);
+  g_source_set_callback (hub->broadcast_source,
+      (GSourceFunc) _broadcast_timeout_cb, hub, NULL);
+  g_source_attach (hub->broadcast_source, hub->context);
+}
+
+/*
+ * Marks property as changed. Its message is formatted when
+ * broadcasting, so only the latest value is ever sent.
+ */
+void
+clapper_control_hub_broadcast_property (ClapperControlHub *hub, ClapperControlHubProperty property)
+{
+  if (hub->broadcast_interval == 0) {
+    _emit_property_message (hub, property, NULL);
+    return;
+  }
+
+  hub->pending_properties |= property;
+  _schedule_flush (hub);
+}
+
+/*
+ * Queues event that cannot be coalesced (e.g. queue changes).
+ * These are always sent in order in which they were queued.
+ */
+void
+clapper_control_hub_broadcast_event (ClapperControlHub *hub, const gchar *text)
+{
+  if (hub->broadcast_interval == 0) {
+    clapper_control_hub_ws_send (hub, text);
+    return;
+  }
+
+  g_ptr_array_add (hub->pending_events, g_strdup (text));
+  _schedule_flush (hub);
+}
+
+/*
+ * Sends all pending events at once. When more than a single event
+ * is pending, they are combined into one "batch" event frame.
+ */
+void
+clapper_control_hub_broadcast_flush (ClapperControlHub *hub)
+{
+  ClapperControlHubProperty property;
+  GString *frame;
+  guint i, n_events;
+  gboolean batch;
+
+  if (hub->broadcast_source) {
+    g_source_destroy (hub->broadcast_source);
+    g_clear_pointer (&hub->broadcast_source, g_source_unref);
+  }
+
+  for (n_events = hub->pending_events->len, property = PROPERTY_FIRST;
+      property <= PROPERTY_LAST; property <<= 1) {
+    if (hub->pending_properties & property)
+      n_events++;
+  }
+
+  if (n_events == 0)
+    return;
+
+  GST_LOG_OBJECT (hub, "Flushing %u pending events", n_events);
+
+  frame = g_string_new (NULL);
+
+  if ((batch = (n_events > 1)))
+    g_string_append (frame, "{\"event\":\"batch\",\"events\":[");
+
+  /* Queue events first, so values of properties
+   * such as "played_index" apply to updated queue */
+  for (i = 0; i < hub->pending_events->len; ++i) {
+    if (i > 0)
+      g_string_append_c (frame, ',');
+
+    g_string_append (frame, g_ptr_array_index (hub->pending_events, i));
+  }
+
+  for (property = PROPERTY_FIRST; property <= PROPERTY_LAST; property <<= 1) {
+    if (!(hub->pending_properties & property))
+      continue;
+
+    if (i++ > 0)
+      g_string_append_c (frame, ',');
+
+    _emit_property_message (hub, property, frame);
+  }
+
+  if (batch)
+    g_string_append (frame, "]}");
+
+  g_ptr_array_set_size (hub->pending_events, 0);
+  hub->pending_properties = 0;
+
+  clapper_control_hub_ws_send (hub, frame->str);
+  g_string_free (frame, TRUE);
+}
+
+/*
+ * Drops all pending events without sending them.
+ */
+void
+clapper_control_hub_broadcast_clear (ClapperControlHub *hub)
+{
+  if (hub->broadcast_source) {
+    g_source_destroy (hub->broadcast_source);
+    g_clear_pointer (&hub->broadcast_source, g_source_unref);
+  }
+
+  g_ptr_array_set_size (hub->pending_events, 0);
+  hub->pending_properties = 0;
+}
@@ -0,0 +1,52 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "clapper-control-hub.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  CLAPPER_CONTROL_HUB_PROPERTY_STATE = 1 << 0,
+  CLAPPER_CONTROL_HUB_PROPERTY_POSITION = 1 << 1,
+  CLAPPER_CONTROL_HUB_PROPERTY_SPEED = 1 << 2,
+  CLAPPER_CONTROL_HUB_PROPERTY_VOLUME = 1 << 3,
+  CLAPPER_CONTROL_HUB_PROPERTY_MUTE = 1 << 4,
+  CLAPPER_CONTROL_HUB_PROPERTY_PLAYED_INDEX = 1 << 5,
+  CLAPPER_CONTROL_HUB_PROPERTY_PROGRESSION = 1 << 6
+} ClapperControlHubProperty;
+
+void clapper_control_hub_broadcast_debug_init (void);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_broadcast_property (ClapperControlHub *hub, ClapperControlHubProperty property);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_broadcast_event (ClapperControlHub *hub, const gchar *text);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_broadcast_flush (ClapperControlHub *hub);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_broadcast_clear (ClapperControlHub *hub);
+
+G_END_DECLS
@@ -0,0 +1,161 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+
+#include "clapper-control-hub-http.h"
+
+/* Smaller responses are not worth compressing */
+#define MIN_COMPRESS_SIZE 1024
+
+static const gchar *const encoding_names[CLAPPER_CONTROL_HUB_HTTP_N_ENCODINGS] = {
+  NULL, "gzip", "deflate"
+};
+
+/*
+ * Picks response encoding based on client "Accept-Encoding" header
+ * and size of the data that is about to be sent.
+ */
+ClapperControlHubHttpEncoding
+clapper_control_hub_http_get_encoding (SoupServerMessage *msg, gsize size)
+{
+  ClapperControlHubHttpEncoding encoding = CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY;
+  const gchar *header;
+  GSList *list, *l;
+
+  if (size < MIN_COMPRESS_SIZE)
+    return encoding;
+
+  header = soup_message_headers_get_list (
+      soup_server_message_get_request_headers (msg), "Accept-Encoding");
+
+  if (!header)
+    return encoding;
+
+  /* List is sorted by quality */
+  list = soup_header_parse_quality_list (header, NULL);
+
+  for (l = list; l != NULL; l = g_slist_next (l)) {
+    if (g_ascii_strcasecmp (l->data, "gzip") == 0) {
+      encoding = CLAPPER_CONTROL_HUB_HTTP_ENCODING_GZIP;
+      break;
+    }
+    if (g_ascii_strcasecmp (l->data, "deflate") == 0) {
+      encoding = CLAPPER_CONTROL_HUB_HTTP_ENCODING_DEFLATE;
+      break;
+    }
+  }
+
+  soup_header_free_list (list);
+
+  return encoding;
+}
+
+GBytes *
+clapper_control_hub_http_compress (GBytes *bytes, ClapperControlHubHttpEncoding encoding)
+{
+  GConverter *compressor;
+  GByteArray *out;
+  const guint8 *in;
+  guint8 buf[16 * 1024];
+  gsize in_size;
+  GConverterResult res;
+  GError *error = NULL;
+
+  g_return_val_if_fail (encoding != CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY, NULL);
+
+  /* HTTP "deflate" means zlib format */
+  compressor = G_CONVERTER (g_zlib_compressor_new (
+      (encoding == CLAPPER_CONTROL_HUB_HTTP_ENCODING_GZIP)
+      ? G_ZLIB_COMPRESSOR_FORMAT_GZIP
+      : G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1));
+
+  in = g_bytes_get_data (bytes, &in_size);
+  out = g_byte_array_sized_new (in_size / 4 + 64);
+
+  do {
+    gsize n_read = 0, n_written = 0;
+
+    res = g_converter_convert (compressor, in, in_size, buf, sizeof (buf),
+        G_CONVERTER_INPUT_AT_END, &n_read, &n_written, &error);
+
+    if (res == G_CONVERTER_ERROR)
+      break;
+
+    g_byte_array_append (out, buf, n_written);
+    in += n_read;
+    in_size -= n_read;
+  } while (res != G_CONVERTER_FINISHED);
+
+  g_object_unref (compressor);
+
+  if (error) {
+    g_debug ("Could not compress response: %s", error->message);
+    g_error_free (error);
+    g_byte_array_unref (out);
+
+    return NULL;
+  }
+
+  return g_byte_array_free_to_bytes (out);
+}
+
+/*
+ * Sets response with data already encoded with given encoding.
+ */
+void
+clapper_control_hub_http_set_response (SoupServerMessage *msg, const gchar *content_type,
+    GBytes *bytes, ClapperControlHubHttpEncoding encoding)
+{
+  SoupMessageHeaders *headers = soup_server_message_get_response_headers (msg);
+
+  soup_message_headers_set_content_type (headers, content_type, NULL);
+  soup_message_headers_append (headers, "Vary", "Accept-Encoding");
+
+  if (encoding != CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY)
+    soup_message_headers_replace (headers, "Content-Encoding", encoding_names[encoding]);
+
+  soup_message_body_append_bytes (soup_server_message_get_response_body (msg), bytes);
+  soup_server_message_set_status (msg, SOUP_STATUS_OK, NULL);
+}
+
+/*
+ * Sets response with given data, compressing it
+ * when client accepts that and it is worth it.
+ */
+void
+clapper_control_hub_http_set_response_take (SoupServerMessage *msg, const gchar *content_type, gchar *data)
+{
+  ClapperControlHubHttpEncoding encoding;
+  GBytes *bytes, *encoded = NULL;
+  gsize size = strlen (data);
+
+  bytes = g_bytes_new_take (data, size);
+  encoding = clapper_control_hub_http_get_encoding (msg, size);
+
+  if (encoding != CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY
+      && !(encoded = clapper_control_hub_http_compress (bytes, encoding)))
+    encoding = CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY;
+
+  clapper_control_hub_http_set_response (msg, content_type,
+      (encoded) ? encoded : bytes, encoding);
+
+  if (encoded)
+    g_bytes_unref (encoded);
+  g_bytes_unref (bytes);
+}
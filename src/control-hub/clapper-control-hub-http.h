@@ -0,0 +1,46 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY = 0,
+  CLAPPER_CONTROL_HUB_HTTP_ENCODING_GZIP,
+  CLAPPER_CONTROL_HUB_HTTP_ENCODING_DEFLATE,
+  CLAPPER_CONTROL_HUB_HTTP_N_ENCODINGS
+} ClapperControlHubHttpEncoding;
+
+G_GNUC_INTERNAL
+ClapperControlHubHttpEncoding clapper_control_hub_http_get_encoding (SoupServerMessage *msg, gsize size);
+
+G_GNUC_INTERNAL
+GBytes * clapper_control_hub_http_compress (GBytes *bytes, ClapperControlHubHttpEncoding encoding);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_http_set_response (SoupServerMessage *msg, const gchar *content_type, GBytes *bytes, ClapperControlHubHttpEncoding encoding);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_http_set_response_take (SoupServerMessage *msg, const gchar *content_type, gchar *data);
+
+G_END_DECLS
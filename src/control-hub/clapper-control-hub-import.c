@@ -0,0 +1,296 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Bulk import of URIs into the queue from body of "POST /queue"
+ * request. Body is either M3U playlist or a plain list with one URI
+ * per line. It is parsed on a worker thread and items are added in
+ * big batches, each with a single round trip to the main thread
+ * where the queue must be altered.
+ *
+ * Import pool is shared within process and can outlive the hub, so
+ * jobs still in progress during hub teardown are only marked as
+ * orphaned. They finish adding items, but never touch the message.
+ */
+
+#include <gst/gst.h>
+
+#include "clapper-control-hub-import.h"
+#include "clapper-control-hub-http.h"
+#include "clapper-control-hub-queue.h"
+
+#include "../utils/c/playlist/playlist-utils.h"
+
+/* Amount of items added into queue at once */
+#define IMPORT_BATCH_SIZE 512
+
+#define GST_CAT_DEFAULT clapper_control_hub_import_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+typedef struct
+{
+  ClapperControlHub *hub;
+  GMainContext *context;
+  GSource *respond_source;
+  gboolean orphaned;
+
+  SoupServerMessage *msg;
+  GBytes *bytes;
+  ClapperQueue *queue;
+
+  /* Items awaiting to be added */
+  GPtrArray *batch;
+
+  /* Result */
+  guint n_added;
+  guint n_invalid;
+} ClapperControlHubImportJob;
+
+/* Shared by all hubs, imports are done one after another */
+static GThreadPool *_import_pool = NULL;
+
+/* Guards jobs state changed from both main and server threads */
+G_LOCK_DEFINE_STATIC (import_lock);
+
+void
+clapper_control_hub_import_debug_init (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubimport",
+      GST_DEBUG_FG_CYAN, "Clapper Control Hub Import");
+}
+
+static GPtrArray *
+_batch_new (void)
+{
+  return g_ptr_array_new_full (IMPORT_BATCH_SIZE, (GDestroyNotify) gst_object_unref);
+}
+
+static void
+_job_free (ClapperControlHubImportJob *job)
+{
+  g_main_context_unref (job->context);
+  g_object_unref (job->msg);
+  g_bytes_unref (job->bytes);
+  gst_object_unref (job->queue);
+  g_ptr_array_unref (job->batch);
+
+  g_free (job);
+}
+
+/* Schedules adding of collected items into queue. Batches are appended
+ * in order they were scheduled, so there is no need to wait for them. */
+static void
+_flush_batch (ClapperControlHubImportJob *job)
+{
+  if (job->batch->len == 0)
+    return;
+
+  GST_DEBUG ("Adding batch of %u items", job->batch->len);
+
+  clapper_control_hub_queue_append_items (job->queue, job->batch, NULL, NULL, NULL);
+  job->n_added += job->batch->len;
+
+  /* Scheduled batch keeps a reference to the array */
+  g_ptr_array_unref (job->batch);
+  job->batch = _batch_new ();
+}
+
+static gboolean
+_add_entry (ClapperControlHubImportJob *job, const gchar *location, gssize len,
+    GstTagList *tags, GError **error G_GNUC_UNUSED)
+{
+  ClapperMediaItem *item;
+  gchar *uri = g_strndup (location, len);
+
+  /* There is no base URI to resolve relative ones against */
+  if (!gst_uri_is_valid (uri)) {
+    GST_LOG ("Skipping invalid URI: %s", uri);
+    job->n_invalid++;
+    g_free (uri);
+
+    return FALSE;
+  }
+
+  item = clapper_media_item_new (uri);
+  g_free (uri);
+
+  if (tags)
+    clapper_media_item_populate_tags (item, tags);
+
+  g_ptr_array_add (job->batch, item);
+
+  if (job->batch->len >= IMPORT_BATCH_SIZE)
+    _flush_batch (job);
+
+  return TRUE;
+}
+
+static gboolean
+_respond_cb (ClapperControlHubImportJob *job)
+{
+  G_LOCK (import_lock);
+
+  /* Finished before teardown, so hub is still alive */
+  g_ptr_array_remove_fast (job->hub->imports, job);
+  job->respond_source = NULL;
+
+  G_UNLOCK (import_lock);
+
+  GST_DEBUG ("Import finished, added: %u, invalid: %u", job->n_added, job->n_invalid);
+
+  if (job->n_added == 0 && job->n_invalid > 0) {
+    soup_server_message_set_status (job->msg, SOUP_STATUS_BAD_REQUEST, NULL);
+  } else {
+    soup_server_message_set_status (job->msg, SOUP_STATUS_OK, NULL);
+    clapper_control_hub_http_set_response_take (job->msg, "application/json",
+        g_strdup_printf ("{\"n_added\":%u,\"n_invalid\":%u}", job->n_added, job->n_invalid));
+  }
+
+  soup_server_message_unpause (job->msg);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called from main thread after all batches were appended */
+static gboolean
+_all_added_cb (ClapperControlHubImportJob *job)
+{
+  G_LOCK (import_lock);
+
+  if (job->orphaned) {
+    G_UNLOCK (import_lock);
+
+    GST_DEBUG ("Import finished after hub teardown, added: %u", job->n_added);
+    _job_free (job);
+
+    return G_SOURCE_REMOVE;
+  }
+
+  /* Teardown destroys this source if it was not dispatched yet */
+  job->respond_source = g_idle_source_new ();
+  g_source_set_priority (job->respond_source, G_PRIORITY_DEFAULT);
+  g_source_set_callback (job->respond_source,
+      (GSourceFunc) _respond_cb, job, (GDestroyNotify) _job_free);
+  g_source_attach (job->respond_source, job->context);
+  g_source_unref (job->respond_source);
+
+  G_UNLOCK (import_lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_import_in_thread (ClapperControlHubImportJob *job, gpointer user_data G_GNUC_UNUSED)
+{
+  const gchar *data;
+  gsize size;
+
+  data = g_bytes_get_data (job->bytes, &size);
+
+  /* Plain URI lists are M3U files without any directives */
+  playlist_utils_parse_m3u (data, size, (PlaylistUtilsEntryFunc) _add_entry, job, NULL, NULL);
+  _flush_batch (job);
+
+  /* Empty batch, only to respond once everything before it is added */
+  clapper_control_hub_queue_append_items (job->queue, job->batch,
+      (GSourceFunc) _all_added_cb, job, NULL);
+}
+
+/*
+ * Starts importing body of given request into queue of hub player.
+ * Message is paused until all items are added.
+ */
+void
+clapper_control_hub_import_request (ClapperControlHub *hub, SoupServerMessage *msg)
+{
+  static gsize initialized = 0;
+  ClapperControlHubImportJob *job;
+  ClapperPlayer *player;
+  SoupMessageBody *body;
+  GBytes *bytes;
+
+  if (g_once_init_enter (&initialized)) {
+    _import_pool = g_thread_pool_new ((GFunc) _import_in_thread, NULL, 1, FALSE, NULL);
+    g_once_init_leave (&initialized, 1);
+  }
+
+  body = soup_server_message_get_request_body (msg);
+
+  /* Usually already refused based on "Content-Length" header,
+   * but chunked bodies are only known after being read */
+  if (body->length > CLAPPER_CONTROL_HUB_IMPORT_MAX_SIZE) {
+    soup_server_message_set_status (msg, SOUP_STATUS_REQUEST_ENTITY_TOO_LARGE, NULL);
+    return;
+  }
+  if (body->length == 0) {
+    soup_server_message_set_status (msg, SOUP_STATUS_BAD_REQUEST, NULL);
+    return;
+  }
+  if (!(player = clapper_reactable_get_player (CLAPPER_REACTABLE_CAST (hub)))) {
+    soup_server_message_set_status (msg, SOUP_STATUS_SERVICE_UNAVAILABLE, NULL);
+    return;
+  }
+
+  bytes = soup_message_body_flatten (body);
+  GST_DEBUG_OBJECT (hub, "Importing %" G_GSIZE_FORMAT " bytes into queue", g_bytes_get_size (bytes));
+
+  job = g_new0 (ClapperControlHubImportJob, 1);
+  job->hub = hub;
+  job->context = g_main_context_ref (hub->context);
+  job->msg = g_object_ref (msg);
+  job->bytes = bytes;
+  job->queue = gst_object_ref (clapper_player_get_queue (player));
+  job->batch = _batch_new ();
+
+  gst_object_unref (player);
+
+  G_LOCK (import_lock);
+  g_ptr_array_add (hub->imports, job);
+  G_UNLOCK (import_lock);
+
+  soup_server_message_pause (msg);
+  g_thread_pool_push (_import_pool, job, NULL);
+}
+
+/*
+ * Detaches imports in progress from hub, so they are not responded
+ * to anymore. Called from server thread during hub teardown.
+ */
+void
+clapper_control_hub_import_orphan_all (ClapperControlHub *hub)
+{
+  GSource *source;
+  guint i;
+
+  G_LOCK (import_lock);
+
+  for (i = 0; i < hub->imports->len; ++i) {
+    ClapperControlHubImportJob *job = g_ptr_array_index (hub->imports, i);
+
+    GST_DEBUG_OBJECT (hub, "Orphaning import in progress");
+    job->orphaned = TRUE;
+    job->hub = NULL;
+
+    /* Frees job, as main thread is already done with it */
+    if ((source = g_steal_pointer (&job->respond_source)))
+      g_source_destroy (source);
+  }
+  g_ptr_array_set_size (hub->imports, 0);
+
+  G_UNLOCK (import_lock);
+}
@@ -16,6 +16,8 @@
  * <https://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
+
 #include "clapper-control-hub-json.h"
 
 #define _JSON_BUILD(dest,...) {                                \
@@ -55,73 +57,263 @@
     __VA_ARGS__                                                \
     g_string_append (_json, "]"); }
 
-static inline void
-clapper_server_json_escape_string (gchar **string)
+#define _ADD_KEY_UINT(k,v) {                                   \
+    gchar _num[CLAPPER_CONTROL_HUB_JSON_NUMBER_SIZE];          \
+    _JSON_AUTO_COMMA                                           \
+    g_string_append_len (_json, "\"" k "\":", sizeof (k) + 2); \
+    g_string_append_len (_json, _num,                          \
+        clapper_control_hub_json_put_uint (_num, v) - _num); }
+
+#define _ADD_KEY_DOUBLE(k,v,p) {                               \
+    gchar _num[CLAPPER_CONTROL_HUB_JSON_NUMBER_SIZE];          \
+    _JSON_AUTO_COMMA                                           \
+    g_string_append_len (_json, "\"" k "\":", sizeof (k) + 2); \
+    g_string_append_len (_json, _num,                          \
+        clapper_control_hub_json_put_double (_num, v, p) - _num); }
+
+#define _ADD_KEY_STRING(k,v) {                                 \
+    _JSON_AUTO_COMMA                                           \
+    g_string_append_len (_json, "\"" k "\":\"", sizeof (k) + 3); \
+    g_string_append (_json, v);                                \
+    g_string_append_c (_json, '"'); }
+
+/* Values above are never legit for anything we send,
+ * clamping them keeps numbers within fixed size */
+#define MAX_FIXED_POINT_VALUE 1e15
+
+/* Escapes quotes, backslashes and control characters.
+ * Returns a new string or %NULL if nothing needs escaping. */
+static gchar *
+_escape_string (const gchar *string)
 {
-  const gchar *src = *string;
-  guint offset = 0;
+  const guchar *src;
+  GString *escaped;
 
-  while ((src = strchr (src, '"')) != NULL) {
-    ++offset;
-    ++src;
+  for (src = (const guchar *) string; *src; ++src) {
+    if (*src == '"' || *src == '\\' || *src < 0x20)
+      break;
   }
 
-  /* Needs escaping for JSON */
-  if (offset > 0) {
-    gchar *escaped, *dst;
-    src = *string;
-
-    /* Previous length + n_escapes + term */
-    escaped = g_new (gchar, strlen (src) + offset + 1);
-    dst = escaped;
-
-    while (*src) {
-      if (*src == '"') {
-        *dst++ = '\\';
-        *dst++ = '"';
-      } else {
-        *dst++ = *src;
-      }
-      ++src;
+  if (*src == '\0')
+    return NULL;
+
+  escaped = g_string_sized_new (strlen (string) + 8);
+  g_string_append_len (escaped, string, (const gchar *) src - string);
+
+  for (; *src; ++src) {
+    switch (*src) {
+      case '"':
+        g_string_append (escaped, "\\\"");
+        break;
+      case '\\':
+        g_string_append (escaped, "\\\\");
+        break;
+      case '\n':
+        g_string_append (escaped, "\\n");
+        break;
+      case '\r':
+        g_string_append (escaped, "\\r");
+        break;
+      case '\t':
+        g_string_append (escaped, "\\t");
+        break;
+      default:
+        if (*src < 0x20)
+          g_string_append_printf (escaped, "\\u%04x", *src);
+        else
+          g_string_append_c (escaped, *src);
+        break;
     }
-    *dst = '\0';
+  }
+
+  return g_string_free (escaped, FALSE);
+}
+
+static inline void
+clapper_server_json_escape_string (gchar **string)
+{
+  gchar *escaped;
 
+  if ((escaped = _escape_string (*string))) {
     g_free (*string);
     *string = escaped;
   }
 }
 
+/*
+ * Returns item title escaped for JSON. It is cached per item until
+ * it is invalidated, so snapshots do not process all titles again.
+ */
+static const gchar *
+_get_escaped_title (ClapperControlHub *hub, ClapperMediaItem *item)
+{
+  gchar *title;
+
+  if ((title = g_hash_table_lookup (hub->json_titles, item)))
+    return title;
+
+  if ((title = clapper_media_item_get_title (item)))
+    clapper_server_json_escape_string (&title);
+  else
+    title = g_strdup ("");
+
+  g_hash_table_insert (hub->json_titles, item, title);
+
+  return title;
+}
+
+/*
+ * Drops cached JSON data of given item or
+ * of all items when @item is %NULL.
+ */
+void
+clapper_control_hub_json_invalidate_item (ClapperControlHub *hub, ClapperMediaItem *item)
+{
+  if (item)
+    g_hash_table_remove (hub->json_titles, item);
+  else
+    g_hash_table_remove_all (hub->json_titles);
+}
+
+/*
+ * Writes number without terminating it and
+ * returns position right after its last digit.
+ */
+gchar *
+clapper_control_hub_json_put_uint (gchar *dest, guint64 value)
+{
+  gchar digits[20];
+  guint n_digits = 0;
+
+  do {
+    digits[n_digits++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  while (n_digits > 0)
+    *dest++ = digits[--n_digits];
+
+  return dest;
+}
+
+gchar *
+clapper_control_hub_json_put_int (gchar *dest, gint64 value)
+{
+  if (value < 0) {
+    *dest++ = '-';
+    return clapper_control_hub_json_put_uint (dest, -(guint64) value);
+  }
+
+  return clapper_control_hub_json_put_uint (dest, value);
+}
+
+/*
+ * Writes number in fixed point notation with given amount of
+ * decimal places (up to 3). Formatting is done on integers,
+ * so it is fast and independent of current locale.
+ */
+gchar *
+clapper_control_hub_json_put_double (gchar *dest, gdouble value, guint precision)
+{
+  static const guint64 scales[] = { 1, 10, 100, 1000 };
+  guint64 scaled, fraction;
+  guint i;
+
+  g_return_val_if_fail (precision < G_N_ELEMENTS (scales), dest);
+
+  /* JSON has no representation for these */
+  if (G_UNLIKELY (isnan (value)))
+    value = 0;
+
+  value = CLAMP (value, -MAX_FIXED_POINT_VALUE, MAX_FIXED_POINT_VALUE);
+  scaled = (guint64) (fabs (value) * scales[precision] + 0.5);
+
+  if (value < 0 && scaled > 0)
+    *dest++ = '-';
+
+  dest = clapper_control_hub_json_put_uint (dest, scaled / scales[precision]);
+
+  if (precision > 0) {
+    fraction = scaled % scales[precision];
+    *dest = '.';
+
+    for (i = precision; i > 0; --i) {
+      dest[i] = '0' + (fraction % 10);
+      fraction /= 10;
+    }
+    dest += precision + 1;
+  }
+
+  return dest;
+}
+
+/* Appends "items" array with up to @limit queue items starting at @offset */
+static void
+_append_items (GString *_json, ClapperControlHub *hub, guint offset, guint limit)
+{
+  guint i, end;
+
+  end = (offset < hub->items->len)
+      ? offset + MIN (limit, hub->items->len - offset)
+      : offset;
+
+  _ADD_NAMED_ARRAY ("items", {
+    for (i = offset; i < end; ++i) {
+      _ADD_OBJECT ({
+        ClapperMediaItem *item = (ClapperMediaItem *) g_ptr_array_index (hub->items, i);
+        _ADD_KEY_UINT ("id", clapper_media_item_get_id (item));
+        _ADD_KEY_STRING ("title", _get_escaped_title (hub, item));
+        _ADD_KEY_DOUBLE ("duration", clapper_media_item_get_duration (item), 3);
+      });
+    }
+  });
+}
+
+/* Determines which part of the queue goes into snapshot,
+ * centering it around currently played item */
+static void
+_get_snapshot_window (ClapperControlHub *hub, guint *offset, guint *limit)
+{
+  guint n_items = hub->items->len;
+
+  *offset = 0;
+  *limit = n_items;
+
+  if (hub->snapshot_window == 0 || hub->snapshot_window >= n_items)
+    return;
+
+  *limit = hub->snapshot_window;
+
+  if (hub->played_index != CLAPPER_QUEUE_INVALID_POSITION
+      && hub->played_index > hub->snapshot_window / 2)
+    *offset = MIN (hub->played_index - hub->snapshot_window / 2, n_items - hub->snapshot_window);
+}
+
 gchar *
 clapper_control_hub_json_build_default (ClapperControlHub *hub, gboolean as_event)
 {
   gchar *data;
+  guint offset, limit;
+
+  _get_snapshot_window (hub, &offset, &limit);
 
   _JSON_BUILD (&data, {
     if (as_event)
       _ADD_KEY_VAL ("event", "\"%s\"", "snapshot");
+    _ADD_KEY_VAL ("seq", "%" G_GUINT64_FORMAT, hub->seq);
     _ADD_KEY_VAL ("state", "%u", hub->state);
-    _ADD_KEY_VAL ("position", "%.3lf", hub->position);
-    _ADD_KEY_VAL ("speed", "%.2lf", hub->speed);
-    _ADD_KEY_VAL ("volume", "%.2lf", hub->volume);
+    _ADD_KEY_DOUBLE ("position", hub->position, 3);
+    _ADD_KEY_VAL ("position_timestamp", "%" G_GINT64_FORMAT, hub->position_time / 1000);
+    _ADD_KEY_DOUBLE ("speed", hub->speed, 2);
+    _ADD_KEY_DOUBLE ("volume", hub->volume, 2);
     _ADD_KEY_VAL ("mute", "%s", hub->mute ? "true" : "false");
     _ADD_NAMED_OBJECT ("queue", {
       _ADD_KEY_VAL ("controllable", "%s", hub->queue_controllable ? "true" : "false");
       _ADD_KEY_VAL ("progression", "%u", hub->progression);
       _ADD_KEY_VAL ("played_index", "%u", hub->played_index);
-      _ADD_NAMED_ARRAY ("items", {
-        guint i;
-        for (i = 0; i < hub->items->len; ++i) {
-          _ADD_OBJECT ({
-            ClapperMediaItem *item = (ClapperMediaItem *) g_ptr_array_index (hub->items, i);
-            gchar *title = clapper_media_item_get_title (item);
-            clapper_server_json_escape_string (&title);
-            _ADD_KEY_VAL ("id", "%u", clapper_media_item_get_id (item));
-            _ADD_KEY_VAL ("title", "\"%s\"", title);
-            _ADD_KEY_VAL ("duration", "%.3lf", clapper_media_item_get_duration (item));
-            g_free (title);
-          });
-        }
-      });
+      _ADD_KEY_VAL ("n_items", "%u", hub->items->len);
+      _ADD_KEY_VAL ("offset", "%u", offset);
+      _append_items (_json, hub, offset, limit);
     });
   });
 
@@ -129,17 +321,28 @@ clapper_control_hub_json_build_default (ClapperControlHub *hub, gboolean as_even
 }
 
 gchar *
-clapper_control_hub_json_build_item_info (ClapperControlHub *hub, ClapperMediaItem *item, gboolean with_timeline)
+clapper_control_hub_json_build_queue (ClapperControlHub *hub, guint offset, guint limit)
 {
-  gchar *data, *title;
+  gchar *data;
 
-  title = clapper_media_item_get_title (item);
-  clapper_server_json_escape_string (&title);
+  _JSON_BUILD (&data, {
+    _ADD_KEY_VAL ("n_items", "%u", hub->items->len);
+    _ADD_KEY_VAL ("offset", "%u", offset);
+    _append_items (_json, hub, offset, limit);
+  });
+
+  return data;
+}
+
+gchar *
+clapper_control_hub_json_build_item_info (ClapperControlHub *hub, ClapperMediaItem *item, gboolean with_timeline)
+{
+  gchar *data;
 
   _JSON_BUILD (&data, {
-    _ADD_KEY_VAL ("id", "%u", clapper_media_item_get_id (item));
-    _ADD_KEY_VAL ("title", "\"%s\"", title);
-    _ADD_KEY_VAL ("duration", "%.3lf", clapper_media_item_get_duration (item));
+    _ADD_KEY_UINT ("id", clapper_media_item_get_id (item));
+    _ADD_KEY_STRING ("title", _get_escaped_title (hub, item));
+    _ADD_KEY_DOUBLE ("duration", clapper_media_item_get_duration (item), 3);
     if (with_timeline) {
       _ADD_NAMED_ARRAY ("timeline", {
         ClapperTimeline *timeline = clapper_media_item_get_timeline (item);
@@ -148,10 +351,13 @@ clapper_control_hub_json_build_item_info (ClapperControlHub *hub, ClapperMediaIt
           ClapperMarker *marker = clapper_timeline_get_marker (timeline, i);
           if (!marker) break;
           _ADD_OBJECT ({
+            const gchar *marker_title = clapper_marker_get_title (marker);
+            gchar *escaped = (marker_title) ? _escape_string (marker_title) : NULL;
             _ADD_KEY_VAL ("marker_type", "%u", clapper_marker_get_marker_type (marker));
-            _ADD_KEY_VAL ("title", "\"%s\"", clapper_marker_get_title (marker));
-            _ADD_KEY_VAL ("start", "%.3lf", clapper_marker_get_start (marker));
-            _ADD_KEY_VAL ("end", "%.3lf", clapper_marker_get_end (marker));
+            _ADD_KEY_STRING ("title", (escaped) ? escaped : (marker_title) ? marker_title : "");
+            _ADD_KEY_DOUBLE ("start", clapper_marker_get_start (marker), 3);
+            _ADD_KEY_DOUBLE ("end", clapper_marker_get_end (marker), 3);
+            g_free (escaped);
           });
           gst_object_unref (marker);
         }
@@ -159,7 +365,5 @@ clapper_control_hub_json_build_item_info (ClapperControlHub *hub, ClapperMediaIt
     }
   });
 
-  g_free (title);
-
   return data;
 }
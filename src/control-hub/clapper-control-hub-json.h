@@ -19,55 +19,109 @@
 #pragma once
 
 #include <glib.h>
+#include <string.h>
 #include <clapper/clapper.h>
 
 #include "clapper-control-hub.h"
 
 G_BEGIN_DECLS
 
-#define __JSON_EMPTY_EVENT(n) "{\"event\":\"" n "\"}"
-#define __JSON_CHANGED_EVENT(n,t) "{\"event\":\"" n "_changed\",\"" n "\":" t "}"
-#define __JSON_CUSTOM_EVENT(n,k1,t1,k2,t2) "{\"event\":\"" n "\",\"" k1 "\":" t1 ",\"" k2 "\":" t2 "}"
+/* Minimal size of buffer that event messages are filled into */
+#define CLAPPER_CONTROL_HUB_JSON_EVENT_SIZE 128
+
+/* Longest number that can be written into JSON by "put" functions */
+#define CLAPPER_CONTROL_HUB_JSON_NUMBER_SIZE 24
+
+/*
+ * Event messages are assembled from constant text parts and numbers
+ * written directly into buffer, without going through printf and
+ * thus always using dot as decimal separator regardless of locale.
+ */
+#define __JSON_FILL(string,...) G_STMT_START {                                   \
+    gchar *_dst = (string);                                                      \
+    G_STATIC_ASSERT (sizeof (string) >= CLAPPER_CONTROL_HUB_JSON_EVENT_SIZE);    \
+    __VA_ARGS__                                                                  \
+    *_dst = '\0'; } G_STMT_END
+
+#define __JSON_TEXT(t) {                                                         \
+    memcpy (_dst, t, sizeof (t) - 1);                                            \
+    _dst += sizeof (t) - 1; }
+
+#define __JSON_UINT(v) _dst = clapper_control_hub_json_put_uint (_dst, (v));
+#define __JSON_INT(v) _dst = clapper_control_hub_json_put_int (_dst, (v));
+#define __JSON_DOUBLE(v,p) _dst = clapper_control_hub_json_put_double (_dst, (v), (p));
+
+#define __JSON_EVENT_PREFIX(n) "{\"event\":\"" n "\""
+#define __JSON_CHANGED_PREFIX(n) __JSON_EVENT_PREFIX (n "_changed") ",\"" n "\":"
+
+#define __JSON_FILL_CHANGED_UINT(string,n,v)                                     \
+  __JSON_FILL (string, __JSON_TEXT (__JSON_CHANGED_PREFIX (n)) __JSON_UINT (v) __JSON_TEXT ("}"))
+
+#define __JSON_FILL_CHANGED_DOUBLE(string,n,v,p)                                 \
+  __JSON_FILL (string, __JSON_TEXT (__JSON_CHANGED_PREFIX (n)) __JSON_DOUBLE (v, p) __JSON_TEXT ("}"))
+
+#define __JSON_FILL_CUSTOM_UINTS(string,n,k1,v1,k2,v2)                           \
+  __JSON_FILL (string, __JSON_TEXT (__JSON_EVENT_PREFIX (n) ",\"" k1 "\":")      \
+      __JSON_UINT (v1) __JSON_TEXT (",\"" k2 "\":") __JSON_UINT (v2) __JSON_TEXT ("}"))
 
 #define clapper_control_hub_json_fill_state_changed_message(string,state) \
-  g_snprintf (string, sizeof (string), __JSON_CHANGED_EVENT ("state", "%u"), (state))
+  __JSON_FILL_CHANGED_UINT (string, "state", state)
 
-#define clapper_control_hub_json_fill_position_changed_message(string,position) \
-  g_snprintf (string, sizeof (string), __JSON_CHANGED_EVENT ("position", "%.3lf"), (position))
+#define clapper_control_hub_json_fill_position_changed_message(string,position,speed,timestamp) \
+  __JSON_FILL (string, __JSON_TEXT (__JSON_CHANGED_PREFIX ("position")) __JSON_DOUBLE (position, 3) \
+      __JSON_TEXT (",\"speed\":") __JSON_DOUBLE (speed, 2) __JSON_TEXT (",\"timestamp\":") __JSON_INT (timestamp) __JSON_TEXT ("}"))
 
 #define clapper_control_hub_json_fill_speed_changed_message(string,speed) \
-  g_snprintf (string, sizeof (string), __JSON_CHANGED_EVENT ("speed", "%.2lf"), (speed))
+  __JSON_FILL_CHANGED_DOUBLE (string, "speed", speed, 2)
 
 #define clapper_control_hub_json_fill_volume_changed_message(string,volume) \
-  g_snprintf (string, sizeof (string), __JSON_CHANGED_EVENT ("volume", "%.2lf"), (volume))
+  __JSON_FILL_CHANGED_DOUBLE (string, "volume", volume, 2)
 
 #define clapper_control_hub_json_fill_mute_changed_message(string,mute) \
-  g_snprintf (string, sizeof (string), __JSON_CHANGED_EVENT ("mute", "%s"), ((mute) ? "true" : "false"))
+  __JSON_FILL (string, __JSON_TEXT (__JSON_CHANGED_PREFIX ("mute")) if (mute) __JSON_TEXT ("true}") else __JSON_TEXT ("false}"))
 
 #define clapper_control_hub_json_fill_played_index_changed_message(string,index) \
-  g_snprintf (string, sizeof (string), __JSON_CHANGED_EVENT ("played_index", "%u"), (index))
+  __JSON_FILL_CHANGED_UINT (string, "played_index", index)
 
 #define clapper_control_hub_json_fill_progression_changed_message(string,mode) \
-  g_snprintf (string, sizeof (string), __JSON_CHANGED_EVENT ("progression", "%u"), (mode))
+  __JSON_FILL_CHANGED_UINT (string, "progression", mode)
 
 #define clapper_control_hub_json_fill_item_updated_message(string,item_id,flags) \
-  g_snprintf (string, sizeof (string), __JSON_CUSTOM_EVENT ("item_updated", "id", "%u", "flags", "%u"), (item_id), (flags))
+  __JSON_FILL_CUSTOM_UINTS (string, "item_updated", "id", item_id, "flags", flags)
 
 #define clapper_control_hub_json_fill_item_added_message(string,item_id,index) \
-  g_snprintf (string, sizeof (string), __JSON_CUSTOM_EVENT ("item_added", "id", "%u", "index", "%u"), (item_id), (index))
+  __JSON_FILL_CUSTOM_UINTS (string, "item_added", "id", item_id, "index", index)
 
 #define clapper_control_hub_json_fill_item_removed_message(string,item_id,index) \
-  g_snprintf (string, sizeof (string), __JSON_CUSTOM_EVENT ("item_removed", "id", "%u", "index", "%u"), (item_id), (index))
+  __JSON_FILL_CUSTOM_UINTS (string, "item_removed", "id", item_id, "index", index)
 
 #define clapper_control_hub_json_fill_item_repositioned_message(string,before,after) \
-  g_snprintf (string, sizeof (string), __JSON_CUSTOM_EVENT ("item_repositioned", "before", "%u", "after", "%u"), (before), (after))
+  __JSON_FILL_CUSTOM_UINTS (string, "item_repositioned", "before", before, "after", after)
 
 #define clapper_control_hub_json_fill_queue_cleared_message(string) \
-  g_snprintf (string, sizeof (string), __JSON_EMPTY_EVENT ("queue_cleared"))
+  __JSON_FILL (string, __JSON_TEXT (__JSON_EVENT_PREFIX ("queue_cleared") "}"))
+
+#define clapper_control_hub_json_fill_clock_message(string,timestamp) \
+  __JSON_FILL (string, __JSON_TEXT (__JSON_EVENT_PREFIX ("clock") ",\"timestamp\":") __JSON_INT (timestamp) __JSON_TEXT ("}"))
+
+G_GNUC_INTERNAL
+gchar * clapper_control_hub_json_put_uint (gchar *dest, guint64 value);
+
+G_GNUC_INTERNAL
+gchar * clapper_control_hub_json_put_int (gchar *dest, gint64 value);
+
+G_GNUC_INTERNAL
+gchar * clapper_control_hub_json_put_double (gchar *dest, gdouble value, guint precision);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_json_invalidate_item (ClapperControlHub *hub, ClapperMediaItem *item);
 
 G_GNUC_INTERNAL
 gchar * clapper_control_hub_json_build_default (ClapperControlHub *hub, gboolean as_event);
 
+G_GNUC_INTERNAL
+gchar * clapper_control_hub_json_build_queue (ClapperControlHub *hub, guint offset, guint limit);
+
 G_GNUC_INTERNAL
 gchar * clapper_control_hub_json_build_item_info (ClapperControlHub *hub, ClapperMediaItem *item, gboolean with_timeline);
 
@@ -16,280 +16,1218 @@
  * <https://www.gnu.org/licenses/>.
  */
 
+/*
+ * Minimal MDNS/DNS-SD responder. It runs within server main context,
+ * waking up only when a packet arrives. Answer packets with records
+ * of all published services are built in DNS wire format once per
+ * network interface (each one carrying only addresses of its own
+ * interface) and then reused until port, services or addresses change.
+ *
+ * Interfaces are enumerated with getifaddrs() where available. Elsewhere
+ * a single default interface is used with addresses that system routes
+ * MDNS traffic through.
+ */
+
 #include "config.h"
 
-#include <gst/gst.h>
-#include <sys/socket.h>
+#include <string.h>
+#include <gio/gnetworking.h>
+
+#ifdef HAVE_GETIFADDRS
+#include <ifaddrs.h>
+#endif
 
 #include "clapper-control-hub-mdns.h"
+#include "clapper-control-hub-server.h"
+
+#define MDNS_PORT 5353
+#define MDNS_GROUP_IPV4 "224.0.0.251"
+#define MDNS_GROUP_IPV6 "ff02::fb"
+
+#define SERVICE_TYPE "_clapper._tcp.local"
+#define SERVICES_ENUMERATION "_services._dns-sd._udp.local"
 
-#define CLAPPER_CONTROL_HUB_MDNS_SERVICE "_clapper._tcp.local"
+#define RECORD_TTL 120
+#define LEGACY_RECORD_TTL 10
 
-#define N_ANSWERS 4
-#define N_TXT 4
+/* Number of unsolicited responses sent after change (RFC 6762, 8.3) */
+#define N_ANNOUNCES 2
+#define ANNOUNCE_INTERVAL 1000
 
-#define PTR_INDEX 0
-#define TXT_INDEX 1
-#define SRV_INDEX 2
-#define A_AAAA_INDEX 3
+/* Same records are not multicasted more often than that (RFC 6762, 6) */
+#define MIN_MULTICAST_INTERVAL G_USEC_PER_SEC
+
+#define MAX_PACKET_SIZE 9000
+#define MAX_NAME_LENGTH 256
+#define MAX_NAME_JUMPS 16
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_PTR 12
+#define DNS_TYPE_TXT 16
+#define DNS_TYPE_AAAA 28
+#define DNS_TYPE_SRV 33
+
+#define DNS_CLASS_IN 1
+#define DNS_CLASS_CACHE_FLUSH 0x8000
+#define DNS_CLASS_UNICAST_RESPONSE 0x8000
+
+#define DNS_FLAG_RESPONSE 0x8000
+#define DNS_FLAG_AUTHORITATIVE 0x0400
 
 #define GST_CAT_DEFAULT clapper_control_hub_mdns_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
 #define parent_class clapper_control_hub_mdns_parent_class
-G_DEFINE_TYPE (ClapperControlHubMdns, clapper_control_hub_mdns, CLAPPER_TYPE_THREADED_OBJECT);
+G_DEFINE_TYPE (ClapperControlHubMdns, clapper_control_hub_mdns, GST_TYPE_OBJECT);
+
+typedef struct
+{
+  /* Name and index are %NULL and zero for default interface */
+  gchar *name;
+  guint index;
+
+  /* Addresses assigned to interface and subnets they belong to,
+   * queries are answered on interface that source is within */
+  GPtrArray *addresses;
+  GPtrArray *masks;
+
+#ifdef HAVE_GETIFADDRS
+  /* Used to select outgoing interface for IPv4 multicast */
+  struct in_addr ipv4;
+#endif
+  gboolean has_ipv4;
+  gboolean has_ipv6;
+
+  gboolean joined4;
+  gboolean joined6;
+
+  /* Answer packet, rebuilt only when something in it changes */
+  GBytes *packet;
+  gint64 last_multicast_time;
+} ClapperControlHubMdnsInterface;
+
+typedef struct
+{
+  guint index;
+
+  /* Instance name, e.g. "host app controlhub0"
+   * and full name with service type appended */
+  gchar *instance;
+  gchar *full_name;
+
+  gchar *path;
+  gboolean auth_required;
+  gchar **txt_records;
+} ClapperControlHubMdnsService;
+
+static ClapperControlHubMdnsInterface *
+_interface_new (const gchar *name, guint index)
+{
+  ClapperControlHubMdnsInterface *iface = g_new0 (ClapperControlHubMdnsInterface, 1);
+
+  iface->name = g_strdup (name);
+  iface->index = index;
+  iface->addresses = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+  iface->masks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+  return iface;
+}
+
+static void
+_interface_free (ClapperControlHubMdnsInterface *iface)
+{
+  g_free (iface->name);
+  g_ptr_array_unref (iface->addresses);
+  g_ptr_array_unref (iface->masks);
+
+  if (iface->packet)
+    g_bytes_unref (iface->packet);
+
+  g_free (iface);
+}
+
+static void
+_service_free (ClapperControlHubMdnsService *service)
+{
+  g_free (service->instance);
+  g_free (service->full_name);
+  g_free (service->path);
+  g_strfreev (service->txt_records);
+
+  g_free (service);
+}
 
-static gint _cch_id = 0;
+static inline void
+_write_u16 (GByteArray *packet, guint16 val)
+{
+  guint8 data[2] = { val >> 8, val & 0xFF };
+  g_byte_array_append (packet, data, sizeof (data));
+}
 
 static inline void
-_send_entries (ClapperControlHubMdns *self, const struct sockaddr *addr,
-    enum mdns_announce_type type)
-{
-  gint i, port = g_atomic_int_get (&self->port);
-  struct rr_entry answers[N_ANSWERS];
-  struct mdns_hdr hdr = { 0, };
-  struct rr_data_txt txt_data[N_TXT];
-
-  GST_LOG_OBJECT (self, "Preparing answers for MDNS query, service: \"%s\""
-      ", domain: \"%s\", link: \"%s\"",
-      CLAPPER_CONTROL_HUB_MDNS_SERVICE, self->domain_name, self->service_link);
-
-  hdr.flags |= FLAG_QR;
-  hdr.flags |= FLAG_AA;
-  hdr.num_ans_rr = N_ANSWERS;
-
-  for (i = 0; i < N_TXT; ++i) {
-    g_strlcpy (txt_data[i].txt, self->txt_records[i], sizeof (txt_data[i].txt));
-    txt_data[i].next = (i < N_TXT - 1) ? &txt_data[i + 1] : NULL;
-  }
-
-  answers[PTR_INDEX] = (struct rr_entry) {
-    .type = RR_PTR,
-    .name = (char *) CLAPPER_CONTROL_HUB_MDNS_SERVICE,
-    .data.PTR.domain = self->service_link,
-    .rr_class = RR_IN,
-    .msbit = 1,
-    .ttl = (type == MDNS_ANNOUNCE_GOODBYE) ? 0 : 120,
-    .next = &answers[TXT_INDEX]
-  };
-
-  answers[TXT_INDEX] = (struct rr_entry) {
-    .type = RR_TXT,
-    .name = self->service_link,
-    .data.TXT = &txt_data[0],
-    .rr_class = RR_IN,
-    .msbit = 1,
-    .ttl = (type == MDNS_ANNOUNCE_GOODBYE) ? 0 : 120,
-    .next = &answers[SRV_INDEX]
-  };
-
-  answers[SRV_INDEX] = (struct rr_entry) {
-    .type = RR_SRV,
-    .name = self->service_link,
-    .data.SRV.port = port,
-    .data.SRV.priority = 0,
-    .data.SRV.weight = 0,
-    .data.SRV.target = self->domain_name,
-    .rr_class = RR_IN,
-    .msbit = 1,
-    .ttl = (type == MDNS_ANNOUNCE_GOODBYE) ? 0 : 120,
-    .next = &answers[A_AAAA_INDEX]
-  };
-
-  answers[A_AAAA_INDEX] = (struct rr_entry) {
-    .name = self->domain_name,
-    .rr_class = RR_IN,
-    .msbit = 1,
-    .ttl = (type == MDNS_ANNOUNCE_GOODBYE) ? 0 : 120,
-    .next = NULL
-  };
-
-  if (addr->sa_family == AF_INET) {
-    answers[A_AAAA_INDEX].type = RR_A;
-    memcpy (&answers[A_AAAA_INDEX].data.A.addr,
-        &((struct sockaddr_in *) addr)->sin_addr,
-        sizeof (answers[A_AAAA_INDEX].data.A.addr));
+_write_u32 (GByteArray *packet, guint32 val)
+{
+  guint8 data[4] = { val >> 24, (val >> 16) & 0xFF, (val >> 8) & 0xFF, val & 0xFF };
+  g_byte_array_append (packet, data, sizeof (data));
+}
+
+/*
+ * Writes name made of optional instance label followed by dot
+ * separated domain. Already written suffixes are replaced with
+ * pointers to them (RFC 1035, 4.1.4), their offsets are kept
+ * in a table keyed by remaining labels.
+ */
+static void
+_write_name (GByteArray *packet, GHashTable *offsets, const gchar *instance, const gchar *domain)
+{
+  gchar **domain_labels = g_strsplit (domain, ".", -1);
+  GPtrArray *labels = g_ptr_array_new ();
+  guint i;
+
+  if (instance)
+    g_ptr_array_add (labels, (gpointer) instance);
+  for (i = 0; domain_labels[i]; ++i)
+    g_ptr_array_add (labels, domain_labels[i]);
+  g_ptr_array_add (labels, NULL);
+
+  for (i = 0; i < labels->len - 1; ++i) {
+    const gchar *label = g_ptr_array_index (labels, i);
+    gchar *key = g_strjoinv ("\n", (gchar **) labels->pdata + i);
+    gpointer offset;
+    guint8 len;
+
+    if (g_hash_table_lookup_extended (offsets, key, NULL, &offset)) {
+      _write_u16 (packet, 0xC000 | GPOINTER_TO_UINT (offset));
+      g_free (key);
+
+      goto finish;
+    }
+
+    if (packet->len < 0x3FFF)
+      g_hash_table_insert (offsets, key, GUINT_TO_POINTER (packet->len));
+    else
+      g_free (key);
+
+    len = MIN (strlen (label), 63);
+    g_byte_array_append (packet, &len, 1);
+    g_byte_array_append (packet, (const guint8 *) label, len);
+  }
+
+  /* Root label */
+  g_byte_array_append (packet, (const guint8 *) "", 1);
+
+finish:
+  g_ptr_array_unref (labels);
+  g_strfreev (domain_labels);
+}
+
+/* Writes record header and returns offset of its data length */
+static guint
+_write_record (GByteArray *packet, GHashTable *offsets, const gchar *instance,
+    const gchar *domain, guint16 type, gboolean unique, guint32 ttl)
+{
+  guint length_offset;
+
+  _write_name (packet, offsets, instance, domain);
+  _write_u16 (packet, type);
+  _write_u16 (packet, (unique) ? DNS_CLASS_IN | DNS_CLASS_CACHE_FLUSH : DNS_CLASS_IN);
+  _write_u32 (packet, ttl);
+
+  length_offset = packet->len;
+  _write_u16 (packet, 0); // Updated when record data is written
+
+  return length_offset;
+}
+
+static void
+_finish_record (GByteArray *packet, guint length_offset)
+{
+  guint16 length = packet->len - length_offset - 2;
+
+  packet->data[length_offset] = length >> 8;
+  packet->data[length_offset + 1] = length & 0xFF;
+}
+
+/*
+ * Builds response packet with records of given services. When
+ * interface is given, records announcing services type and its
+ * addresses are included too. Zero TTL makes it a goodbye packet.
+ *
+ * When legacy query is given (RFC 6762, 6.7), its ID and questions
+ * (ending at "questions_end") are repeated in the reply, TTLs are
+ * capped and records are sent without cache-flush bit.
+ */
+static GBytes *
+_build_packet (ClapperControlHubMdns *self, GPtrArray *services,
+    ClapperControlHubMdnsInterface *iface, guint32 ttl,
+    const guint8 *query, gsize questions_end)
+{
+  GByteArray *packet = g_byte_array_sized_new (512);
+  GHashTable *offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  gchar *host_domain = g_strdup_printf ("%s.local", self->host_name);
+  gboolean unique = (query == NULL);
+  guint i, j, n_answers, length_offset;
+
+  n_answers = services->len * 3;
+  if (iface)
+    n_answers += 1 + iface->addresses->len;
+
+  /* Header, ID is zero for multicast responses */
+  if (query) {
+    g_byte_array_append (packet, query, 2);
+    ttl = MIN (ttl, LEGACY_RECORD_TTL);
   } else {
-    answers[A_AAAA_INDEX].type = RR_AAAA;
-    memcpy (&answers[A_AAAA_INDEX].data.AAAA.addr,
-        &((struct sockaddr_in6 *) addr)->sin6_addr,
-        sizeof (answers[A_AAAA_INDEX].data.AAAA.addr));
+    _write_u16 (packet, 0);
+  }
+  _write_u16 (packet, DNS_FLAG_RESPONSE | DNS_FLAG_AUTHORITATIVE);
+  if (query)
+    g_byte_array_append (packet, query + 4, 2);
+  else
+    _write_u16 (packet, 0);
+  _write_u16 (packet, n_answers);
+  _write_u16 (packet, 0);
+  _write_u16 (packet, 0);
+
+  /* Copied at the same offset, so name pointers in questions stay valid */
+  if (query)
+    g_byte_array_append (packet, query + 12, questions_end - 12);
+
+  for (i = 0; i < services->len; ++i) {
+    ClapperControlHubMdnsService *service = g_ptr_array_index (services, i);
+
+    length_offset = _write_record (packet, offsets, NULL, SERVICE_TYPE, DNS_TYPE_PTR, FALSE, ttl);
+    _write_name (packet, offsets, service->instance, SERVICE_TYPE);
+    _finish_record (packet, length_offset);
+
+    /* All services share the same port, they differ by path in TXT */
+    length_offset = _write_record (packet, offsets, service->instance, SERVICE_TYPE, DNS_TYPE_SRV, unique, ttl);
+    _write_u16 (packet, 0); // Priority
+    _write_u16 (packet, 0); // Weight
+    _write_u16 (packet, self->port);
+    _write_name (packet, offsets, NULL, host_domain);
+    _finish_record (packet, length_offset);
+
+    length_offset = _write_record (packet, offsets, service->instance, SERVICE_TYPE, DNS_TYPE_TXT, unique, ttl);
+    for (j = 0; service->txt_records[j]; ++j) {
+      guint8 len = MIN (strlen (service->txt_records[j]), 255);
+
+      g_byte_array_append (packet, &len, 1);
+      g_byte_array_append (packet, (const guint8 *) service->txt_records[j], len);
+    }
+    _finish_record (packet, length_offset);
   }
 
-  GST_LOG_OBJECT (self, "Sending answers");
-  mdns_entries_send (self->ctx, &hdr, answers);
+  if (iface) {
+    length_offset = _write_record (packet, offsets, NULL, SERVICES_ENUMERATION, DNS_TYPE_PTR, FALSE, ttl);
+    _write_name (packet, offsets, NULL, SERVICE_TYPE);
+    _finish_record (packet, length_offset);
+
+    for (i = 0; i < iface->addresses->len; ++i) {
+      GInetAddress *address = g_ptr_array_index (iface->addresses, i);
+      gboolean is_ipv4 = (g_inet_address_get_family (address) == G_SOCKET_FAMILY_IPV4);
+
+      length_offset = _write_record (packet, offsets, NULL, host_domain,
+          (is_ipv4) ? DNS_TYPE_A : DNS_TYPE_AAAA, unique, ttl);
+      g_byte_array_append (packet, g_inet_address_to_bytes (address),
+          g_inet_address_get_native_size (address));
+      _finish_record (packet, length_offset);
+    }
+  }
+
+  if (G_UNLIKELY (packet->len > MAX_PACKET_SIZE))
+    GST_WARNING_OBJECT (self, "Answer packet is too big: %u bytes", packet->len);
+
+  g_hash_table_unref (offsets);
+  g_free (host_domain);
+
+  return g_byte_array_free_to_bytes (packet);
 }
 
 static void
-_mdns_cb (ClapperControlHubMdns *self, const struct sockaddr *addr,
-    const char* service, enum mdns_announce_type type)
+_send_packet_to (ClapperControlHubMdns *self, GSocket *socket, GSocketAddress *address, GBytes *packet)
 {
-  /* We should respond when service is NULL too (e.g. in INITIAL announce) */
-  if (service && strcmp (service, CLAPPER_CONTROL_HUB_MDNS_SERVICE) != 0)
-    return;
+  GError *error = NULL;
+
+  if (g_socket_send_to (socket, address, g_bytes_get_data (packet, NULL),
+      g_bytes_get_size (packet), NULL, &error) < 0) {
+    GST_DEBUG_OBJECT (self, "Could not send packet: %s", error->message);
+    g_error_free (error);
+  }
+}
+
+/* Sends packet to MDNS group on given interface */
+static void
+_send_multicast (ClapperControlHubMdns *self, ClapperControlHubMdnsInterface *iface, GBytes *packet)
+{
+  GInetAddress *group;
+  GSocketAddress *address;
 
-  GST_LOG_OBJECT (self, "Handling announcement type: %s",
-      (type == MDNS_ANNOUNCE_RESPONSE) ? "RESPONSE"
-      : (type == MDNS_ANNOUNCE_INITIAL) ? "INITIAL" : "GOODBYE");
+  if (iface->joined4) {
+    gboolean selected = TRUE;
 
-  _send_entries (self, addr, type);
+#ifdef HAVE_GETIFADDRS
+    selected = (setsockopt (g_socket_get_fd (self->socket4), IPPROTO_IP,
+        IP_MULTICAST_IF, &iface->ipv4, sizeof (iface->ipv4)) == 0);
+#endif
+    if (selected) {
+      group = g_inet_address_new_from_string (MDNS_GROUP_IPV4);
+      address = g_inet_socket_address_new (group, MDNS_PORT);
+
+      _send_packet_to (self, self->socket4, address, packet);
+
+      g_object_unref (address);
+      g_object_unref (group);
+    }
+  }
+
+  if (iface->joined6 && g_socket_set_option (self->socket6, IPPROTO_IPV6,
+      IPV6_MULTICAST_IF, iface->index, NULL)) {
+    group = g_inet_address_new_from_string (MDNS_GROUP_IPV6);
+    address = g_inet_socket_address_new (group, MDNS_PORT);
+
+    _send_packet_to (self, self->socket6, address, packet);
+
+    g_object_unref (address);
+    g_object_unref (group);
+  }
+
+  iface->last_multicast_time = g_get_monotonic_time ();
+}
+
+/* Sends each interface its own answer packet, or goodbye
+ * packet for all of them when @ttl is zero */
+static void
+_send_multicast_all (ClapperControlHubMdns *self, guint32 ttl)
+{
+  guint i;
+
+  for (i = 0; i < self->interfaces->len; ++i) {
+    ClapperControlHubMdnsInterface *iface = g_ptr_array_index (self->interfaces, i);
+
+    if (ttl > 0) {
+      if (iface->packet)
+        _send_multicast (self, iface, iface->packet);
+    } else {
+      GBytes *goodbye = _build_packet (self, self->services, iface, 0, NULL, 0);
+
+      _send_multicast (self, iface, goodbye);
+      g_bytes_unref (goodbye);
+    }
+  }
 }
 
 static gboolean
-mdns_stop_cb (ClapperControlHubMdns *self)
+_announce_cb (ClapperControlHubMdns *self)
 {
-  return (g_atomic_int_get (&self->run) == 0);
+  GST_DEBUG_OBJECT (self, "Announcing services");
+  _send_multicast_all (self, RECORD_TTL);
+
+  if (++self->n_announces < N_ANNOUNCES)
+    return G_SOURCE_CONTINUE;
+
+  g_clear_pointer (&self->announce_source, g_source_unref);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
-_post_error_str (ClapperControlHubMdns *self, const gchar *err_str)
+_clear_announce (ClapperControlHubMdns *self)
+{
+  if (self->announce_source) {
+    g_source_destroy (self->announce_source);
+    g_clear_pointer (&self->announce_source, g_source_unref);
+  }
+}
+
+static void
+_announce (ClapperControlHubMdns *self)
+{
+  _clear_announce (self);
+
+  self->n_announces = 0;
+  if (_announce_cb (self) == G_SOURCE_REMOVE)
+    return;
+
+  self->announce_source = g_timeout_source_new (ANNOUNCE_INTERVAL);
+  g_source_set_callback (self->announce_source, (GSourceFunc) _announce_cb, self, NULL);
+  g_source_attach (self->announce_source, self->context);
+}
+
+/* Rebuilds answer packets and announces them if anything changed */
+static void
+_update_packets (ClapperControlHubMdns *self)
+{
+  gboolean changed = FALSE;
+  guint i;
+
+  if (!self->running)
+    return;
+
+  for (i = 0; i < self->interfaces->len; ++i) {
+    ClapperControlHubMdnsInterface *iface = g_ptr_array_index (self->interfaces, i);
+    GBytes *packet = _build_packet (self, self->services, iface, RECORD_TTL, NULL, 0);
+
+    if (iface->packet && g_bytes_equal (iface->packet, packet)) {
+      g_bytes_unref (packet);
+      continue;
+    }
+
+    GST_DEBUG_OBJECT (self, "Answer packet of interface %s updated, size: %"
+        G_GSIZE_FORMAT, GST_STR_NULL (iface->name), g_bytes_get_size (packet));
+
+    if (iface->packet)
+      g_bytes_unref (iface->packet);
+    iface->packet = packet;
+
+    changed = TRUE;
+  }
+
+  if (changed && self->services->len > 0)
+    _announce (self);
+}
+
+/* Reads (possibly compressed) name into lowercase dotted string */
+static gboolean
+_read_name (const guint8 *data, gsize size, gsize *offset, gchar *name)
 {
-  ClapperReactable *reactable;
+  gsize pos = *offset, name_len = 0;
+  guint n_jumps = 0;
+  gboolean jumped = FALSE;
 
-  reactable = CLAPPER_REACTABLE_CAST (gst_object_get_parent (GST_OBJECT_CAST (self)));
-  if (G_LIKELY (reactable != NULL)) {
-    ClapperPlayer *player = clapper_reactable_get_player (reactable);
+  while (pos < size) {
+    guint8 len = data[pos];
+
+    if (len == 0) {
+      if (!jumped)
+        *offset = pos + 1;
+      name[name_len] = '\0';
+
+      return TRUE;
+    }
 
-    if (G_LIKELY (player != NULL)) {
-      GstStructure *structure;
-      GError *error;
+    /* Pointer to previous name */
+    if ((len & 0xC0) == 0xC0) {
+      if (pos + 1 >= size || ++n_jumps > MAX_NAME_JUMPS)
+        return FALSE;
+      if (!jumped)
+        *offset = pos + 2;
 
-      /* Post error message with reactable set as source */
-      error = g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED, "%s", err_str);
-      structure = gst_structure_new ("enhancer-error",
-          "error", G_TYPE_ERROR, error, NULL);
-      clapper_player_post_message (player,
-          gst_message_new_application (GST_OBJECT_CAST (reactable), structure),
-          CLAPPER_PLAYER_MESSAGE_DESTINATION_APPLICATION);
+      pos = ((len & 0x3F) << 8) | data[pos + 1];
+      jumped = TRUE;
 
-      g_error_free (error);
-      gst_object_unref (player);
+      continue;
     }
 
-    gst_object_unref (reactable);
+    if (len > 63 || pos + 1 + len > size || name_len + len + 2 > MAX_NAME_LENGTH)
+      return FALSE;
+
+    if (name_len > 0)
+      name[name_len++] = '.';
+
+    memcpy (name + name_len, data + pos + 1, len);
+    name_len += len;
+    pos += 1 + len;
+  }
+
+  return FALSE;
+}
+
+static gboolean
+_name_is_ours (ClapperControlHubMdns *self, const gchar *name)
+{
+  gsize host_len = strlen (self->host_name);
+  guint i;
+
+  if (g_ascii_strcasecmp (name, SERVICE_TYPE) == 0
+      || g_ascii_strcasecmp (name, SERVICES_ENUMERATION) == 0)
+    return TRUE;
+
+  /* Host name with ".local" suffix */
+  if (g_ascii_strncasecmp (name, self->host_name, host_len) == 0
+      && g_ascii_strcasecmp (name + host_len, ".local") == 0)
+    return TRUE;
+
+  for (i = 0; i < self->services->len; ++i) {
+    ClapperControlHubMdnsService *service = g_ptr_array_index (self->services, i);
+
+    if (g_ascii_strcasecmp (name, service->full_name) == 0)
+      return TRUE;
   }
+
+  return FALSE;
 }
 
+/*
+ * Checks whether query asks about any of our names. All records
+ * are sent at once in response, as there are only a few of them.
+ * Offset where questions section ends is stored in "questions_end".
+ */
 static gboolean
-_serve_in_thread_func (ClapperControlHubMdns *self)
+_query_is_ours (ClapperControlHubMdns *self, const guint8 *data, gsize size,
+    gboolean *unicast, gsize *questions_end)
 {
-  if (!self->initialized) {
-    int resp;
-    char err_str[128];
-    const gchar *host_name, *prgname, *cch_name;
+  gchar name[MAX_NAME_LENGTH];
+  gsize offset = 12;
+  guint i, n_questions;
+  gboolean ours = FALSE;
+
+  /* Header, ignore responses */
+  if (size < 12 || (data[2] & 0x80))
+    return FALSE;
 
-    GST_DEBUG_OBJECT (self, "Initializing");
+  n_questions = (data[4] << 8) | data[5];
 
-    host_name = g_get_host_name ();
-    if (!(prgname = g_get_prgname ()))
-      prgname = "unknown";
-    cch_name = GST_OBJECT_NAME (self);
+  for (i = 0; i < n_questions; ++i) {
+    guint16 qclass;
 
-    if (!self->domain_name)
-      self->domain_name = g_strdup_printf ("%s.local", host_name);
-    if (!self->service_link) {
-      self->service_link = g_strdup_printf ("%s %s %s.%s",
-          host_name, prgname, cch_name, CLAPPER_CONTROL_HUB_MDNS_SERVICE);
+    if (!_read_name (data, size, &offset, name) || offset + 4 > size)
+      return FALSE;
+
+    qclass = (data[offset + 2] << 8) | data[offset + 3];
+    offset += 4;
+
+    if (!ours && _name_is_ours (self, name)) {
+      *unicast = (qclass & DNS_CLASS_UNICAST_RESPONSE) != 0;
+      ours = TRUE;
     }
-    if (!self->txt_records) {
-      GStrvBuilder *builder = g_strv_builder_new ();
-      gchar *id_txt, *app_txt;
+  }
 
-      id_txt = g_strdup_printf ("id=%s-%s-%s", host_name, prgname, cch_name);
-      app_txt = g_strdup_printf ("app=%s", prgname);
+  *questions_end = offset;
 
-      /* XXX: When entries are added/removed here, "N_TXT" must be updated.
-       * Also, note that these are sent in reverse order. */
-      g_strv_builder_add (builder, id_txt);
-      g_strv_builder_add (builder, "chver=" CONTROL_HUB_VERSION_S);
-      g_strv_builder_add (builder, "cver=" CLAPPER_VERSION_S);
-      g_strv_builder_add (builder, app_txt);
+  return ours;
+}
+
+/*
+ * Finds interface that query came through, so it is answered only
+ * with addresses reachable from there. Queries from outside of local
+ * subnets are not answered (RFC 6762, 11).
+ */
+static ClapperControlHubMdnsInterface *
+_find_source_interface (ClapperControlHubMdns *self, GInetSocketAddress *src)
+{
+  GInetAddress *address = g_inet_socket_address_get_address (src);
+  guint32 scope_id = 0;
+  guint i, j;
+
+  /* Link-local IPv6 source carries index of interface. Check it
+   * first, since all interfaces share the same link-local subnet. */
+  if (g_inet_address_get_family (address) == G_SOCKET_FAMILY_IPV6)
+    scope_id = g_inet_socket_address_get_scope_id (src);
+
+  for (i = 0; scope_id != 0 && i < self->interfaces->len; ++i) {
+    ClapperControlHubMdnsInterface *iface = g_ptr_array_index (self->interfaces, i);
 
-      self->txt_records = g_strv_builder_end (builder);
-      g_strv_builder_unref (builder);
+    if (iface->index == scope_id)
+      return iface;
+  }
+
+  for (i = 0; i < self->interfaces->len; ++i) {
+    ClapperControlHubMdnsInterface *iface = g_ptr_array_index (self->interfaces, i);
+
+    /* Default interface with unknown subnets */
+    if (iface->masks->len == 0)
+      return iface;
 
-      g_free (id_txt);
-      g_free (app_txt);
+    for (j = 0; j < iface->masks->len; ++j) {
+      if (g_inet_address_mask_matches (g_ptr_array_index (iface->masks, j), address))
+        return iface;
     }
+  }
 
-    if ((resp = mdns_init (&self->ctx, MDNS_ADDR_IPV4, MDNS_PORT)) < 0) {
-      mdns_strerror (resp, err_str, sizeof (err_str));
-      GST_ERROR_OBJECT (self, "Could not initialize MDNS, reason: %s", err_str);
-      _post_error_str (self, err_str);
-    } else {
-      mdns_announce (self->ctx, RR_PTR, (mdns_announce_callback) _mdns_cb, self);
-      self->initialized = TRUE;
-      GST_DEBUG_OBJECT (self, "Initialized");
+  return NULL;
+}
+
+static gboolean
+_socket_readable_cb (GSocket *socket, GIOCondition condition, ClapperControlHubMdns *self)
+{
+  ClapperControlHubMdnsInterface *iface;
+  guint8 data[MAX_PACKET_SIZE];
+  GSocketAddress *src = NULL;
+  GError *error = NULL;
+  gboolean unicast = FALSE;
+  gsize questions_end = 0;
+  gssize size;
+
+  if ((size = g_socket_receive_from (socket, &src, (gchar *) data, sizeof (data), NULL, &error)) < 0) {
+    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+      GST_WARNING_OBJECT (self, "Could not receive packet: %s", error->message);
+
+    g_error_free (error);
+
+    return G_SOURCE_CONTINUE;
+  }
+
+  if (self->services->len == 0 || !_query_is_ours (self, data, size, &unicast, &questions_end))
+    goto finish;
+
+  if (!(iface = _find_source_interface (self, G_INET_SOCKET_ADDRESS (src))) || !iface->packet) {
+    GST_LOG_OBJECT (self, "Ignoring query from outside of local networks");
+    goto finish;
+  }
+
+  /* Legacy resolvers (RFC 6762, 6.7) expect unicast reply with query ID and questions */
+  if (g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (src)) != MDNS_PORT) {
+    GBytes *reply = _build_packet (self, self->services, iface, RECORD_TTL, data, questions_end);
+
+    GST_LOG_OBJECT (self, "Answering legacy query");
+    _send_packet_to (self, socket, src, reply);
+    g_bytes_unref (reply);
+  } else if (unicast) {
+    GST_LOG_OBJECT (self, "Answering query with unicast");
+    _send_packet_to (self, socket, src, iface->packet);
+  } else if (g_get_monotonic_time () - iface->last_multicast_time >= MIN_MULTICAST_INTERVAL) {
+    GST_LOG_OBJECT (self, "Answering query with multicast");
+    _send_multicast (self, iface, iface->packet);
+  }
+
+finish:
+  g_clear_object (&src);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+_leave_groups (ClapperControlHubMdns *self)
+{
+  GInetAddress *group4, *group6;
+  guint i;
+
+  group4 = g_inet_address_new_from_string (MDNS_GROUP_IPV4);
+  group6 = g_inet_address_new_from_string (MDNS_GROUP_IPV6);
+
+  for (i = 0; i < self->interfaces->len; ++i) {
+    ClapperControlHubMdnsInterface *iface = g_ptr_array_index (self->interfaces, i);
+
+    if (iface->joined4)
+      g_socket_leave_multicast_group (self->socket4, group4, FALSE, iface->name, NULL);
+    if (iface->joined6)
+      g_socket_leave_multicast_group (self->socket6, group6, FALSE, iface->name, NULL);
+
+    iface->joined4 = iface->joined6 = FALSE;
+  }
+
+  g_object_unref (group4);
+  g_object_unref (group6);
+}
+
+static void
+_join_groups (ClapperControlHubMdns *self)
+{
+  GInetAddress *group4, *group6;
+  GError *error = NULL;
+  guint i;
+
+  group4 = g_inet_address_new_from_string (MDNS_GROUP_IPV4);
+  group6 = g_inet_address_new_from_string (MDNS_GROUP_IPV6);
+
+  for (i = 0; i < self->interfaces->len; ++i) {
+    ClapperControlHubMdnsInterface *iface = g_ptr_array_index (self->interfaces, i);
+
+    if (self->socket4 && iface->has_ipv4) {
+      if (!(iface->joined4 = g_socket_join_multicast_group (self->socket4,
+          group4, FALSE, iface->name, &error))) {
+        GST_WARNING_OBJECT (self, "Could not join IPv4 group on %s: %s",
+            GST_STR_NULL (iface->name), error->message);
+        g_clear_error (&error);
+      }
     }
+    if (self->socket6 && iface->has_ipv6) {
+      if (!(iface->joined6 = g_socket_join_multicast_group (self->socket6,
+          group6, FALSE, iface->name, &error))) {
+        GST_WARNING_OBJECT (self, "Could not join IPv6 group on %s: %s",
+            GST_STR_NULL (iface->name), error->message);
+        g_clear_error (&error);
+      }
+    }
+
+    GST_DEBUG_OBJECT (self, "Interface %s, IPv4: %s, IPv6: %s", GST_STR_NULL (iface->name),
+        (iface->joined4) ? "yes" : "no", (iface->joined6) ? "yes" : "no");
+  }
+
+  g_object_unref (group4);
+  g_object_unref (group6);
+}
+
+#ifdef HAVE_GETIFADDRS
+static ClapperControlHubMdnsInterface *
+_find_interface (GPtrArray *interfaces, const gchar *name)
+{
+  guint i;
+
+  for (i = 0; i < interfaces->len; ++i) {
+    ClapperControlHubMdnsInterface *iface = g_ptr_array_index (interfaces, i);
+
+    if (strcmp (iface->name, name) == 0)
+      return iface;
   }
-  if (self->initialized) {
-    int resp;
-    char err_str[128];
 
-    GST_INFO_OBJECT (self, "Serving");
+  return NULL;
+}
+
+static void
+_interface_add_address (ClapperControlHubMdnsInterface *iface,
+    const guint8 *bytes, const guint8 *mask_bytes, GSocketFamily family)
+{
+  GInetAddress *address = g_inet_address_new_from_bytes (bytes, family);
+
+  g_ptr_array_add (iface->addresses, address);
+
+  if (mask_bytes) {
+    GInetAddressMask *mask;
+    guint i, size, prefix = 0;
 
-    /* NOTE: This function blocks (runs loop internally) */
-    if ((resp = mdns_serve (self->ctx, (mdns_stop_func) mdns_stop_cb, self)) < 0) {
-      mdns_strerror (resp, err_str, sizeof (err_str));
-      GST_ERROR_OBJECT (self, "Could start MDNS, reason: %s", err_str);
-      _post_error_str (self, err_str);
+    size = g_inet_address_get_native_size (address);
+
+    for (i = 0; i < size; ++i) {
+      guint8 byte = mask_bytes[i];
+
+      while (byte & 0x80) {
+        prefix++;
+        byte <<= 1;
+      }
+      if (mask_bytes[i] != 0xff)
+        break;
     }
 
-    GST_INFO_OBJECT (self, "Stopped");
+    if ((mask = g_inet_address_mask_new (address, prefix, NULL)))
+      g_ptr_array_add (iface->masks, mask);
+  }
+}
+
+/* Reads multicast capable interfaces and addresses assigned to them */
+static void
+_read_interfaces (ClapperControlHubMdns *self)
+{
+  struct ifaddrs *ifaddrs, *ifa;
+
+  if (getifaddrs (&ifaddrs) != 0) {
+    GST_ERROR_OBJECT (self, "Could not read network interfaces");
+    return;
+  }
+
+  for (ifa = ifaddrs; ifa != NULL; ifa = ifa->ifa_next) {
+    ClapperControlHubMdnsInterface *iface;
+    gint family;
+
+    if (!ifa->ifa_addr || !(ifa->ifa_flags & IFF_UP)
+        || (ifa->ifa_flags & IFF_LOOPBACK) || !(ifa->ifa_flags & IFF_MULTICAST))
+      continue;
+
+    family = ifa->ifa_addr->sa_family;
+    if (family != AF_INET && family != AF_INET6)
+      continue;
+
+    if (!(iface = _find_interface (self->interfaces, ifa->ifa_name))) {
+      iface = _interface_new (ifa->ifa_name, if_nametoindex (ifa->ifa_name));
+      g_ptr_array_add (self->interfaces, iface);
+    }
+
+    if (family == AF_INET) {
+      struct sockaddr_in *sin = (struct sockaddr_in *) ifa->ifa_addr;
+      struct sockaddr_in *mask = (struct sockaddr_in *) ifa->ifa_netmask;
+
+      if (!iface->has_ipv4) {
+        iface->ipv4 = sin->sin_addr;
+        iface->has_ipv4 = TRUE;
+      }
+      _interface_add_address (iface, (const guint8 *) &sin->sin_addr,
+          (mask) ? (const guint8 *) &mask->sin_addr : NULL, G_SOCKET_FAMILY_IPV4);
+    } else {
+      struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) ifa->ifa_addr;
+      struct sockaddr_in6 *mask6 = (struct sockaddr_in6 *) ifa->ifa_netmask;
+
+      iface->has_ipv6 = TRUE;
+      _interface_add_address (iface, (const guint8 *) &sin6->sin6_addr,
+          (mask6) ? (const guint8 *) &mask6->sin6_addr : NULL, G_SOCKET_FAMILY_IPV6);
+    }
+  }
+
+  freeifaddrs (ifaddrs);
+}
+#else
+/* Returns local address that system sends MDNS traffic from */
+static GInetAddress *
+_get_route_address (GSocketFamily family)
+{
+  GSocket *socket;
+  GInetAddress *group, *result = NULL;
+  GSocketAddress *address, *local;
+
+  if (!(socket = g_socket_new (family, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, NULL)))
+    return NULL;
+
+  group = g_inet_address_new_from_string ((family == G_SOCKET_FAMILY_IPV4)
+      ? MDNS_GROUP_IPV4 : MDNS_GROUP_IPV6);
+  address = g_inet_socket_address_new (group, MDNS_PORT);
+
+  /* Connecting UDP socket sends nothing, it only selects route */
+  if (g_socket_connect (socket, address, NULL, NULL)
+      && (local = g_socket_get_local_address (socket, NULL))) {
+    GInetAddress *inet = g_inet_socket_address_get_address (G_INET_SOCKET_ADDRESS (local));
+
+    if (!g_inet_address_get_is_any (inet) && !g_inet_address_get_is_loopback (inet))
+      result = g_object_ref (inet);
+
+    g_object_unref (local);
+  }
+
+  g_object_unref (address);
+  g_object_unref (group);
+  g_socket_close (socket, NULL);
+  g_object_unref (socket);
+
+  return result;
+}
+
+/* Uses default interface with addresses that MDNS is routed through */
+static void
+_read_interfaces (ClapperControlHubMdns *self)
+{
+  ClapperControlHubMdnsInterface *iface = _interface_new (NULL, 0);
+  GInetAddress *address;
+
+  if ((address = _get_route_address (G_SOCKET_FAMILY_IPV4))) {
+    g_ptr_array_add (iface->addresses, address);
+    iface->has_ipv4 = TRUE;
+  }
+  if ((address = _get_route_address (G_SOCKET_FAMILY_IPV6))) {
+    g_ptr_array_add (iface->addresses, address);
+    iface->has_ipv6 = TRUE;
+  }
+
+  if (iface->addresses->len > 0)
+    g_ptr_array_add (self->interfaces, iface);
+  else
+    _interface_free (iface);
+}
+#endif
+
+static void
+_refresh_interfaces (ClapperControlHubMdns *self)
+{
+  _leave_groups (self);
+  g_ptr_array_set_size (self->interfaces, 0);
+
+  _read_interfaces (self);
+  _join_groups (self);
+}
+
+static gboolean
+_network_changed_cb (ClapperControlHubMdns *self)
+{
+  if (self->running) {
+    GST_DEBUG_OBJECT (self, "Network changed");
+
+    _refresh_interfaces (self);
+    _update_packets (self);
   }
 
   return G_SOURCE_REMOVE;
 }
 
+static void
+_network_changed_signal_cb (GNetworkMonitor *monitor, gboolean available, ClapperControlHubMdns *self)
+{
+  /* Signal might be emitted from another thread */
+  g_main_context_invoke_full (self->context, G_PRIORITY_DEFAULT,
+      (GSourceFunc) _network_changed_cb, gst_object_ref (self), (GDestroyNotify) gst_object_unref);
+}
+
+static GSocket *
+_create_socket (ClapperControlHubMdns *self, GSocketFamily family, GSource **source)
+{
+  GSocket *socket;
+  GInetAddress *any;
+  GSocketAddress *address;
+  GError *error = NULL;
+  gboolean bound;
+
+  if (!(socket = g_socket_new (family, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error)))
+    goto finish;
+
+  g_socket_set_blocking (socket, FALSE);
+  g_socket_set_multicast_ttl (socket, 255);
+  g_socket_set_multicast_loopback (socket, TRUE);
+
+  if (family == G_SOCKET_FAMILY_IPV6)
+    g_socket_set_option (socket, IPPROTO_IPV6, IPV6_V6ONLY, 1, NULL);
+
+  any = g_inet_address_new_any (family);
+  address = g_inet_socket_address_new (any, MDNS_PORT);
+
+  /* Allow reuse, as other responder (e.g. Avahi) might be running */
+  bound = g_socket_bind (socket, address, TRUE, &error);
+
+  g_object_unref (address);
+  g_object_unref (any);
+
+  if (!bound) {
+    g_clear_object (&socket);
+    goto finish;
+  }
+
+  *source = g_socket_create_source (socket, G_IO_IN, NULL);
+  g_source_set_callback (*source, (GSourceFunc) _socket_readable_cb, self, NULL);
+  g_source_attach (*source, self->context);
+
+finish:
+  if (error) {
+    GST_WARNING_OBJECT (self, "Could not create %s socket: %s",
+        (family == G_SOCKET_FAMILY_IPV4) ? "IPv4" : "IPv6", error->message);
+    g_error_free (error);
+  }
+
+  return socket;
+}
+
+static void
+_clear_socket (GSocket **socket, GSource **source)
+{
+  if (*source) {
+    g_source_destroy (*source);
+    g_clear_pointer (source, g_source_unref);
+  }
+  if (*socket) {
+    g_socket_close (*socket, NULL);
+    g_clear_object (socket);
+  }
+}
+
+static void
+_post_error_str (ClapperControlHubMdns *self, const gchar *err_str)
+{
+  GstObject *server;
+
+  if (G_LIKELY ((server = gst_object_get_parent (GST_OBJECT_CAST (self))) != NULL)) {
+    GError *error = g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED, "%s", err_str);
+
+    clapper_control_hub_server_report_error (CLAPPER_CONTROL_HUB_SERVER_CAST (server), error);
+
+    g_error_free (error);
+    gst_object_unref (server);
+  }
+}
+
 ClapperControlHubMdns *
-clapper_control_hub_mdns_new (void)
+clapper_control_hub_mdns_new (GMainContext *context)
 {
   ClapperControlHubMdns *mdns;
-  gchar name[24];
 
-  g_snprintf (name, sizeof (name), "controlhub%i", g_atomic_int_add (&_cch_id, 1));
-  mdns = g_object_new (CLAPPER_TYPE_CONTROL_HUB_MDNS, "name", name, NULL);
+  mdns = g_object_new (CLAPPER_TYPE_CONTROL_HUB_MDNS, NULL);
+  mdns->context = context;
 
   return gst_object_ref_sink (mdns);
 }
 
+/*
+ * Starts responding to queries, must be called from within
+ * context that was passed when creating this object.
+ */
 void
 clapper_control_hub_mdns_start (ClapperControlHubMdns *self, gint port)
 {
-  GMainContext *context = clapper_threaded_object_get_context (CLAPPER_THREADED_OBJECT_CAST (self));
+  if (self->running) {
+    if (self->port != port) {
+      self->port = port;
+      _update_packets (self);
+    }
+    return;
+  }
+
+  GST_DEBUG_OBJECT (self, "Starting");
+
+  self->socket4 = _create_socket (self, G_SOCKET_FAMILY_IPV4, &self->source4);
+  self->socket6 = _create_socket (self, G_SOCKET_FAMILY_IPV6, &self->source6);
+
+  if (!self->socket4 && !self->socket6) {
+    GST_ERROR_OBJECT (self, "Could not start MDNS");
+    _post_error_str (self, "Could not create MDNS sockets");
+
+    return;
+  }
+
+  self->port = port;
+  self->running = TRUE;
 
-  g_atomic_int_set (&self->port, port);
-  g_atomic_int_set (&self->run, 1);
+  _refresh_interfaces (self);
 
-  g_main_context_invoke (context, (GSourceFunc) _serve_in_thread_func, self);
+  if (!self->monitor) {
+    self->monitor = g_object_ref (g_network_monitor_get_default ());
+    self->monitor_handler_id = g_signal_connect (self->monitor, "network-changed",
+        G_CALLBACK (_network_changed_signal_cb), self);
+  }
+
+  _update_packets (self);
+
+  GST_INFO_OBJECT (self, "Serving");
 }
 
 void
 clapper_control_hub_mdns_stop (ClapperControlHubMdns *self)
 {
-  g_atomic_int_set (&self->run, 0);
+  if (!self->running)
+    return;
+
+  _clear_announce (self);
+
+  /* Tell others to remove our records from their caches */
+  if (self->services->len > 0)
+    _send_multicast_all (self, 0);
+
+  if (self->monitor) {
+    g_signal_handler_disconnect (self->monitor, self->monitor_handler_id);
+    self->monitor_handler_id = 0;
+    g_clear_object (&self->monitor);
+  }
+
+  _leave_groups (self);
+  _clear_socket (&self->socket4, &self->source4);
+  _clear_socket (&self->socket6, &self->source6);
+
+  g_ptr_array_set_size (self->interfaces, 0);
+  self->running = FALSE;
+
+  GST_INFO_OBJECT (self, "Stopped");
 }
 
 static void
-clapper_control_hub_mdns_thread_stop (ClapperThreadedObject *threaded_object)
+_service_fill_txt_records (ClapperControlHubMdns *self, ClapperControlHubMdnsService *service)
 {
-  ClapperControlHubMdns *self = CLAPPER_CONTROL_HUB_MDNS_CAST (threaded_object);
+  GStrvBuilder *builder;
+  const gchar *prgname;
+  gchar *id_txt, *app_txt, *path_txt;
 
-  if (self->initialized) {
-    GST_TRACE_OBJECT (self, "Destroy");
-    mdns_destroy (self->ctx);
+  if (!(prgname = g_get_prgname ()))
+    prgname = "unknown";
+
+  builder = g_strv_builder_new ();
+
+  id_txt = g_strdup_printf ("id=%s-%s-controlhub%u", self->host_name, prgname, service->index);
+  app_txt = g_strdup_printf ("app=%s", prgname);
+  path_txt = g_strdup_printf ("path=%s", service->path);
+
+  g_strv_builder_add (builder, path_txt);
+  g_strv_builder_add (builder, id_txt);
+  g_strv_builder_add (builder, "chver=" CONTROL_HUB_VERSION_S);
+  g_strv_builder_add (builder, "cver=" CLAPPER_VERSION_S);
+  g_strv_builder_add (builder, app_txt);
+
+  /* Clients must pair before sending commands */
+  if (service->auth_required)
+    g_strv_builder_add (builder, "auth=1");
+
+  g_strfreev (service->txt_records);
+  service->txt_records = g_strv_builder_end (builder);
+  g_strv_builder_unref (builder);
+
+  g_free (id_txt);
+  g_free (app_txt);
+  g_free (path_txt);
+}
+
+static ClapperControlHubMdnsService *
+_find_service (ClapperControlHubMdns *self, guint index, guint *position)
+{
+  guint i;
+
+  for (i = 0; i < self->services->len; ++i) {
+    ClapperControlHubMdnsService *service = g_ptr_array_index (self->services, i);
+
+    if (service->index == index) {
+      if (position)
+        *position = i;
+
+      return service;
+    }
   }
 
-  /* Always free, might be set even
-   * if initialization fails */
-  g_free (self->domain_name);
-  g_free (self->service_link);
-  g_strfreev (self->txt_records);
+  return NULL;
+}
+
+/*
+ * Adds service of a player published under given path.
+ * Can be called while responder is already running.
+ */
+void
+clapper_control_hub_mdns_add_service (ClapperControlHubMdns *self, guint index,
+    const gchar *path, gboolean auth_required)
+{
+  ClapperControlHubMdnsService *service;
+  const gchar *prgname;
+
+  if (!(prgname = g_get_prgname ()))
+    prgname = "unknown";
+
+  service = g_new0 (ClapperControlHubMdnsService, 1);
+  service->index = index;
+  service->instance = g_strdup_printf ("%s %s controlhub%u",
+      self->host_name, prgname, index);
+  service->full_name = g_strdup_printf ("%s.%s", service->instance, SERVICE_TYPE);
+  service->path = g_strdup (path);
+  service->auth_required = auth_required;
+
+  _service_fill_txt_records (self, service);
+
+  GST_DEBUG_OBJECT (self, "Adding service: \"%s\"", service->full_name);
+
+  g_ptr_array_add (self->services, service);
+  _update_packets (self);
+}
+
+void
+clapper_control_hub_mdns_set_service_auth (ClapperControlHubMdns *self, guint index, gboolean auth_required)
+{
+  ClapperControlHubMdnsService *service;
+
+  if (!(service = _find_service (self, index, NULL))
+      || service->auth_required == auth_required)
+    return;
+
+  GST_DEBUG_OBJECT (self, "Service \"%s\" requires auth: %s",
+      service->full_name, (auth_required) ? "yes" : "no");
+
+  service->auth_required = auth_required;
+  _service_fill_txt_records (self, service);
+
+  _update_packets (self);
+}
+
+void
+clapper_control_hub_mdns_remove_service (ClapperControlHubMdns *self, guint index)
+{
+  ClapperControlHubMdnsService *service;
+  guint position;
+
+  if (!(service = _find_service (self, index, &position)))
+    return;
+
+  GST_DEBUG_OBJECT (self, "Removing service: \"%s\"", service->full_name);
+
+  if (self->running) {
+    GPtrArray *removed = g_ptr_array_new ();
+    GBytes *goodbye;
+    guint i;
+
+    g_ptr_array_add (removed, service);
+    goodbye = _build_packet (self, removed, NULL, 0, NULL, 0);
+
+    for (i = 0; i < self->interfaces->len; ++i)
+      _send_multicast (self, g_ptr_array_index (self->interfaces, i), goodbye);
+
+    g_bytes_unref (goodbye);
+    g_ptr_array_unref (removed);
+  }
+
+  g_ptr_array_remove_index (self->services, position);
+  _update_packets (self);
 }
 
 static void
 clapper_control_hub_mdns_init (ClapperControlHubMdns *self)
 {
+  self->host_name = g_strdup (g_get_host_name ());
+  self->interfaces = g_ptr_array_new_with_free_func ((GDestroyNotify) _interface_free);
+  self->services = g_ptr_array_new_with_free_func ((GDestroyNotify) _service_free);
 }
 
 static void
@@ -309,6 +1247,10 @@ clapper_control_hub_mdns_finalize (GObject *object)
 
   GST_TRACE_OBJECT (self, "Finalize");
 
+  g_free (self->host_name);
+  g_ptr_array_unref (self->interfaces);
+  g_ptr_array_unref (self->services);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -316,13 +1258,10 @@ static void
 clapper_control_hub_mdns_class_init (ClapperControlHubMdnsClass *klass)
 {
   GObjectClass *gobject_class = (GObjectClass *) klass;
-  ClapperThreadedObjectClass *threaded_object = (ClapperThreadedObjectClass *) klass;
 
   GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubmdns",
       GST_DEBUG_FG_RED, "Clapper Control Hub MDNS");
 
   gobject_class->dispose = clapper_control_hub_mdns_dispose;
   gobject_class->finalize = clapper_control_hub_mdns_finalize;
-
-  threaded_object->thread_stop = clapper_control_hub_mdns_thread_stop;
 }
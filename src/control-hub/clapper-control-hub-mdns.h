@@ -20,8 +20,8 @@
 
 #include <glib.h>
 #include <glib-object.h>
-#include <clapper/clapper.h>
-#include <microdns/microdns.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
 
 G_BEGIN_DECLS
 
@@ -29,26 +29,38 @@ G_BEGIN_DECLS
 #define CLAPPER_CONTROL_HUB_MDNS_CAST(obj) ((ClapperControlHubMdns *)(obj))
 
 G_GNUC_INTERNAL
-G_DECLARE_FINAL_TYPE (ClapperControlHubMdns, clapper_control_hub_mdns, CLAPPER, CONTROL_HUB_MDNS, ClapperThreadedObject)
+G_DECLARE_FINAL_TYPE (ClapperControlHubMdns, clapper_control_hub_mdns, CLAPPER, CONTROL_HUB_MDNS, GstObject)
 
 struct _ClapperControlHubMdns
 {
-  ClapperThreadedObject parent;
+  GstObject parent;
 
-  struct mdns_ctx *ctx;
-  gboolean initialized;
+  GMainContext *context;
+  gboolean running;
+  gint port;
 
-  gchar *domain_name;
-  gchar *service_link;
-  gchar **txt_records;
+  /* One per address family */
+  GSocket *socket4;
+  GSocket *socket6;
+  GSource *source4;
+  GSource *source6;
 
-  /* Atomic */
-  gint run;
-  gint port;
+  /* Multicast capable network interfaces, each with
+   * its own addresses and answer packet */
+  GPtrArray *interfaces;
+
+  gchar *host_name;
+  GPtrArray *services;
+
+  GSource *announce_source;
+  guint n_announces;
+
+  GNetworkMonitor *monitor;
+  gulong monitor_handler_id;
 };
 
 G_GNUC_INTERNAL
-ClapperControlHubMdns * clapper_control_hub_mdns_new (void);
+ClapperControlHubMdns * clapper_control_hub_mdns_new (GMainContext *context);
 
 G_GNUC_INTERNAL
 void clapper_control_hub_mdns_start (ClapperControlHubMdns *mdns, gint port);
@@ -56,4 +68,13 @@ void clapper_control_hub_mdns_start (ClapperControlHubMdns *mdns, gint port);
 G_GNUC_INTERNAL
 void clapper_control_hub_mdns_stop (ClapperControlHubMdns *mdns);
 
+G_GNUC_INTERNAL
+void clapper_control_hub_mdns_add_service (ClapperControlHubMdns *mdns, guint index, const gchar *path, gboolean auth_required);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_mdns_set_service_auth (ClapperControlHubMdns *mdns, guint index, gboolean auth_required);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_mdns_remove_service (ClapperControlHubMdns *mdns, guint index);
+
 G_END_DECLS
@@ -0,0 +1,536 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Minimal MessagePack support for binary WebSocket clients.
+ *
+ * Events are still built as JSON and transcoded here (once per event,
+ * not per client). This only needs to handle JSON that hub itself
+ * produces: objects, arrays, strings, numbers and booleans.
+ */
+
+#include <string.h>
+
+#include "clapper-control-hub-msgpack.h"
+
+#define MAX_DEPTH 16
+
+static inline void
+_write_be (GByteArray *out, guint8 marker, guint64 val, guint n_bytes)
+{
+  guint8 buf[9];
+  guint i;
+
+  buf[0] = marker;
+  for (i = n_bytes; i > 0; --i, val >>= 8)
+    buf[i] = (guint8) (val & 0xff);
+
+  g_byte_array_append (out, buf, n_bytes + 1);
+}
+
+static void
+_write_uint (GByteArray *out, guint64 val)
+{
+  if (val < 0x80) {
+    guint8 byte = (guint8) val;
+    g_byte_array_append (out, &byte, 1);
+  } else if (val <= G_MAXUINT8) {
+    _write_be (out, 0xcc, val, 1);
+  } else if (val <= G_MAXUINT16) {
+    _write_be (out, 0xcd, val, 2);
+  } else if (val <= G_MAXUINT32) {
+    _write_be (out, 0xce, val, 4);
+  } else {
+    _write_be (out, 0xcf, val, 8);
+  }
+}
+
+static void
+_write_double (GByteArray *out, gdouble val)
+{
+  union { gdouble d; guint64 u; } conv;
+
+  conv.d = val;
+  _write_be (out, 0xcb, conv.u, 8);
+}
+
+static void
+_write_str_header (GByteArray *out, gsize len)
+{
+  if (len < 32) {
+    guint8 byte = 0xa0 | (guint8) len;
+    g_byte_array_append (out, &byte, 1);
+  } else if (len <= G_MAXUINT8) {
+    _write_be (out, 0xd9, len, 1);
+  } else if (len <= G_MAXUINT16) {
+    _write_be (out, 0xda, len, 2);
+  } else {
+    _write_be (out, 0xdb, len, 4);
+  }
+}
+
+/* Replaces 5 bytes placeholder at @start with the shortest
+ * possible container header now that amount of entries is known */
+static void
+_finish_container (GByteArray *out, guint start, guint n_entries, gboolean is_map)
+{
+  guint8 header[5];
+  guint header_len;
+
+  if (n_entries < 16) {
+    header[0] = ((is_map) ? 0x80 : 0x90) | (guint8) n_entries;
+    header_len = 1;
+  } else if (n_entries <= G_MAXUINT16) {
+    header[0] = (is_map) ? 0xde : 0xdc;
+    header[1] = (guint8) (n_entries >> 8);
+    header[2] = (guint8) n_entries;
+    header_len = 3;
+  } else {
+    header[0] = (is_map) ? 0xdf : 0xdd;
+    header[1] = (guint8) (n_entries >> 24);
+    header[2] = (guint8) (n_entries >> 16);
+    header[3] = (guint8) (n_entries >> 8);
+    header[4] = (guint8) n_entries;
+    header_len = 5;
+  }
+
+  if (header_len < 5) {
+    memmove (out->data + start + header_len, out->data + start + 5,
+        out->len - start - 5);
+    g_byte_array_set_size (out, out->len - (5 - header_len));
+  }
+
+  memcpy (out->data + start, header, header_len);
+}
+
+static gboolean _transcode_value (const gchar **ptr, GByteArray *out, guint depth);
+
+/* Reads 4 hex digits of "\uXXXX" escape */
+static gboolean
+_read_hex4 (const gchar *src, gunichar *val)
+{
+  guint i;
+
+  *val = 0;
+
+  for (i = 0; i < 4; ++i) {
+    gint digit;
+
+    if ((digit = g_ascii_xdigit_value (src[i])) < 0)
+      return FALSE;
+
+    *val = (*val << 4) | digit;
+  }
+
+  return TRUE;
+}
+
+/* Decodes JSON string escapes between @src and @end into @decoded,
+ * "\uXXXX" (with surrogate pairs) is converted into UTF-8 */
+static gboolean
+_unescape_string (const gchar *src, const gchar *end, GByteArray *decoded)
+{
+  while (src < end) {
+    const gchar *start = src;
+    gchar utf8[6];
+    gunichar uc;
+    guint8 byte;
+
+    while (src < end && *src != '\\')
+      ++src;
+
+    g_byte_array_append (decoded, (const guint8 *) start, src - start);
+
+    if (src == end)
+      break;
+
+    switch (src[1]) {
+      case '"':
+      case '\\':
+      case '/':
+        byte = src[1];
+        break;
+      case 'b':
+        byte = '\b';
+        break;
+      case 'f':
+        byte = '\f';
+        break;
+      case 'n':
+        byte = '\n';
+        break;
+      case 'r':
+        byte = '\r';
+        break;
+      case 't':
+        byte = '\t';
+        break;
+      case 'u':
+        if (end - src < 6 || !_read_hex4 (src + 2, &uc))
+          return FALSE;
+
+        src += 6;
+
+        if (uc >= 0xd800 && uc <= 0xdbff) {
+          gunichar low;
+
+          /* High surrogate must be followed by low one */
+          if (end - src >= 6 && src[0] == '\\' && src[1] == 'u'
+              && _read_hex4 (src + 2, &low) && low >= 0xdc00 && low <= 0xdfff) {
+            uc = 0x10000 + ((uc - 0xd800) << 10) + (low - 0xdc00);
+            src += 6;
+          } else {
+            uc = 0xfffd;
+          }
+        } else if (uc >= 0xdc00 && uc <= 0xdfff) {
+          uc = 0xfffd;
+        }
+
+        g_byte_array_append (decoded, (const guint8 *) utf8, g_unichar_to_utf8 (uc, utf8));
+        continue;
+      default:
+        return FALSE;
+    }
+
+    g_byte_array_append (decoded, &byte, 1);
+    src += 2;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+_transcode_string (const gchar **ptr, GByteArray *out)
+{
+  const gchar *src = *ptr + 1; // Skip opening quote
+  const gchar *end;
+  gboolean has_escapes = FALSE;
+
+  for (end = src; *end != '"'; ++end) {
+    if (*end == '\0')
+      return FALSE;
+    if (*end == '\\') {
+      if (*(++end) == '\0')
+        return FALSE;
+      has_escapes = TRUE;
+    }
+  }
+
+  if (!has_escapes) {
+    _write_str_header (out, end - src);
+    g_byte_array_append (out, (const guint8 *) src, end - src);
+  } else {
+    /* Decoded string is never longer than escaped one */
+    GByteArray *decoded = g_byte_array_sized_new (end - src);
+    gboolean success;
+
+    if ((success = _unescape_string (src, end, decoded))) {
+      _write_str_header (out, decoded->len);
+      g_byte_array_append (out, decoded->data, decoded->len);
+    }
+    g_byte_array_unref (decoded);
+
+    if (!success)
+      return FALSE;
+  }
+
+  *ptr = end + 1;
+
+  return TRUE;
+}
+
+static gboolean
+_transcode_number (const gchar **ptr, GByteArray *out)
+{
+  const gchar *src = *ptr;
+  gchar *endptr = NULL;
+  gboolean decimal = FALSE;
+  const gchar *tmp;
+
+  for (tmp = (*src == '-') ? src + 1 : src; g_ascii_isdigit (*tmp) || *tmp == '.'; ++tmp) {
+    if (*tmp == '.')
+      decimal = TRUE;
+  }
+
+  if (decimal || *src == '-') {
+    _write_double (out, g_ascii_strtod (src, &endptr));
+  } else {
+    _write_uint (out, g_ascii_strtoull (src, &endptr, 10));
+  }
+
+  if (endptr == src)
+    return FALSE;
+
+  *ptr = endptr;
+
+  return TRUE;
+}
+
+static gboolean
+_transcode_container (const gchar **ptr, GByteArray *out, guint depth)
+{
+  const gchar *src = *ptr;
+  const gchar closing = (*src == '{') ? '}' : ']';
+  const gboolean is_map = (closing == '}');
+  guint start = out->len, n_entries = 0;
+  guint8 placeholder[5] = { 0, };
+
+  if (depth > MAX_DEPTH)
+    return FALSE;
+
+  g_byte_array_append (out, placeholder, sizeof (placeholder));
+  ++src;
+
+  while (*src != closing) {
+    if (n_entries > 0) {
+      if (*src != ',')
+        return FALSE;
+      ++src;
+    }
+    if (is_map) {
+      if (*src != '"' || !_transcode_string (&src, out) || *src != ':')
+        return FALSE;
+      ++src;
+    }
+    if (!_transcode_value (&src, out, depth + 1))
+      return FALSE;
+
+    ++n_entries;
+  }
+
+  _finish_container (out, start, n_entries, is_map);
+  *ptr = src + 1;
+
+  return TRUE;
+}
+
+static gboolean
+_transcode_value (const gchar **ptr, GByteArray *out, guint depth)
+{
+  const gchar *src = *ptr;
+  guint8 byte;
+
+  switch (*src) {
+    case '{':
+    case '[':
+      return _transcode_container (ptr, out, depth);
+    case '"':
+      return _transcode_string (ptr, out);
+    case 't':
+      if (strncmp (src, "true", 4) != 0)
+        return FALSE;
+      byte = 0xc3;
+      *ptr += 4;
+      break;
+    case 'f':
+      if (strncmp (src, "false", 5) != 0)
+        return FALSE;
+      byte = 0xc2;
+      *ptr += 5;
+      break;
+    case 'n':
+      if (strncmp (src, "null", 4) != 0)
+        return FALSE;
+      byte = 0xc0;
+      *ptr += 4;
+      break;
+    default:
+      return _transcode_number (ptr, out);
+  }
+
+  g_byte_array_append (out, &byte, 1);
+
+  return TRUE;
+}
+
+/*
+ * Transcodes hub JSON message into MessagePack. Returns %NULL
+ * when given JSON could not be handled.
+ */
+GBytes *
+clapper_control_hub_msgpack_from_json (const gchar *json)
+{
+  GByteArray *out = g_byte_array_sized_new (strlen (json));
+  const gchar *ptr = json;
+
+  if (!_transcode_value (&ptr, out, 0) || *ptr != '\0') {
+    g_byte_array_unref (out);
+    return NULL;
+  }
+
+  return g_byte_array_free_to_bytes (out);
+}
+
+static gboolean
+_read_be (const guint8 **ptr, const guint8 *end, guint n_bytes, guint64 *val)
+{
+  guint i;
+
+  if ((gsize) (end - *ptr) < n_bytes)
+    return FALSE;
+
+  for (*val = 0, i = 0; i < n_bytes; ++i)
+    *val = (*val << 8) | (*ptr)[i];
+
+  *ptr += n_bytes;
+
+  return TRUE;
+}
+
+/* Reads single scalar value and appends its text form to @text */
+static gboolean
+_read_action_value (const guint8 **ptr, const guint8 *end, GString *text)
+{
+  guint8 marker;
+  guint64 val;
+
+  if (*ptr >= end)
+    return FALSE;
+
+  marker = *(*ptr)++;
+
+  /* Strings */
+  if ((marker & 0xe0) == 0xa0 || (marker >= 0xd9 && marker <= 0xdb)) {
+    if ((marker & 0xe0) == 0xa0)
+      val = marker & 0x1f;
+    else if (!_read_be (ptr, end, 1 << (marker - 0xd9), &val))
+      return FALSE;
+
+    if ((guint64) (end - *ptr) < val || memchr (*ptr, '\0', val))
+      return FALSE;
+
+    g_string_append_len (text, (const gchar *) *ptr, val);
+    *ptr += val;
+
+    return TRUE;
+  }
+
+  /* Positive fixint and unsigned integers */
+  if (marker < 0x80 || (marker >= 0xcc && marker <= 0xcf)) {
+    if (marker < 0x80)
+      val = marker;
+    else if (!_read_be (ptr, end, 1 << (marker - 0xcc), &val))
+      return FALSE;
+
+    g_string_append_printf (text, "%" G_GUINT64_FORMAT, val);
+    return TRUE;
+  }
+
+  /* Negative fixint and signed integers */
+  if (marker >= 0xe0 || (marker >= 0xd0 && marker <= 0xd3)) {
+    gint64 sval;
+
+    if (marker >= 0xe0) {
+      sval = (gint8) marker;
+    } else {
+      guint n_bytes = 1 << (marker - 0xd0);
+
+      if (!_read_be (ptr, end, n_bytes, &val))
+        return FALSE;
+
+      /* Sign extend from the read size */
+      if (n_bytes < 8 && (val & (G_GUINT64_CONSTANT (1) << (n_bytes * 8 - 1))))
+        val |= ~G_GUINT64_CONSTANT (0) << (n_bytes * 8);
+
+      sval = (gint64) val;
+    }
+
+    g_string_append_printf (text, "%" G_GINT64_FORMAT, sval);
+    return TRUE;
+  }
+
+  /* Floats */
+  if (marker == 0xca || marker == 0xcb) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    gdouble dval;
+
+    if (marker == 0xca) {
+      union { gfloat f; guint32 u; } conv;
+
+      if (!_read_be (ptr, end, 4, &val))
+        return FALSE;
+      conv.u = (guint32) val;
+      dval = conv.f;
+    } else {
+      union { gdouble d; guint64 u; } conv;
+
+      if (!_read_be (ptr, end, 8, &val))
+        return FALSE;
+      conv.u = val;
+      dval = conv.d;
+    }
+
+    g_string_append (text, g_ascii_formatd (buf, sizeof (buf), "%.3f", dval));
+    return TRUE;
+  }
+
+  /* Booleans */
+  if (marker == 0xc2 || marker == 0xc3) {
+    g_string_append (text, (marker == 0xc3) ? "true" : "false");
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*
+ * Converts MessagePack action into its text form. Action is either
+ * a string with text action or an array with action name followed
+ * by its arguments, e.g. ["seek", 12.5]. Returns %NULL on error.
+ */
+gchar *
+clapper_control_hub_msgpack_to_action (const guint8 *data, gsize size)
+{
+  const guint8 *ptr = data, *end = data + size;
+  GString *text;
+  guint64 n_values = 1, i;
+
+  if (size == 0)
+    return NULL;
+
+  if ((*ptr & 0xf0) == 0x90) {
+    n_values = *ptr++ & 0x0f;
+  } else if (*ptr == 0xdc || *ptr == 0xdd) {
+    guint8 marker = *ptr++;
+
+    if (!_read_be (&ptr, end, (marker == 0xdc) ? 2 : 4, &n_values))
+      return NULL;
+  }
+
+  if (n_values == 0)
+    return NULL;
+
+  text = g_string_new (NULL);
+
+  for (i = 0; i < n_values; ++i) {
+    if (i > 0)
+      g_string_append_c (text, ' ');
+
+    if (!_read_action_value (&ptr, end, text)) {
+      g_string_free (text, TRUE);
+      return NULL;
+    }
+  }
+
+  if (ptr != end) {
+    g_string_free (text, TRUE);
+    return NULL;
+  }
+
+  return g_string_free (text, FALSE);
+}
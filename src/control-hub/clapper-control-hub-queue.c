@@ -0,0 +1,187 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Asynchronous alteration of player queue by remote clients.
+ *
+ * Queue must be altered from main thread. Reactable "sync" functions
+ * do a blocking round trip to it for every single change, which would
+ * stall the calling server thread shared by all hubs meanwhile. Here
+ * changes are scheduled on main thread without waiting for them and
+ * whole batch of appended items is handled within one callback.
+ * Callbacks are dispatched in order they were scheduled, so changes
+ * are always applied in order they were requested.
+ */
+
+#include "clapper-control-hub-queue.h"
+
+#define GST_CAT_DEFAULT clapper_control_hub_queue_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+typedef enum
+{
+  QUEUE_OP_APPEND,
+  QUEUE_OP_INSERT,
+  QUEUE_OP_REMOVE,
+  QUEUE_OP_CLEAR,
+} ClapperControlHubQueueOp;
+
+typedef struct
+{
+  ClapperControlHubQueueOp op;
+  ClapperQueue *queue;
+  GPtrArray *items;
+  ClapperMediaItem *after_item;
+
+  GSourceFunc done_func;
+  gpointer done_data;
+  GDestroyNotify done_destroy;
+} ClapperControlHubQueueBatch;
+
+void
+clapper_control_hub_queue_debug_init (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubqueue",
+      GST_DEBUG_FG_CYAN, "Clapper Control Hub Queue");
+}
+
+static void
+_batch_free (ClapperControlHubQueueBatch *batch)
+{
+  gst_object_unref (batch->queue);
+  if (batch->items)
+    g_ptr_array_unref (batch->items);
+  gst_clear_object (&batch->after_item);
+
+  if (batch->done_destroy)
+    batch->done_destroy (batch->done_data);
+
+  g_free (batch);
+}
+
+static gboolean
+_alter_on_main_cb (ClapperControlHubQueueBatch *batch)
+{
+  guint i, index;
+
+  switch (batch->op) {
+    case QUEUE_OP_APPEND:
+      GST_DEBUG_OBJECT (batch->queue, "Appending batch of %u items", batch->items->len);
+
+      for (i = 0; i < batch->items->len; ++i)
+        clapper_queue_add_item (batch->queue, g_ptr_array_index (batch->items, i));
+      break;
+    case QUEUE_OP_INSERT:
+      /* Same as reactable, append when item to insert after is gone */
+      if (clapper_queue_find_item (batch->queue, batch->after_item, &index)) {
+        GST_DEBUG_OBJECT (batch->queue, "Inserting item at: %u", index + 1);
+        clapper_queue_insert_item (batch->queue, g_ptr_array_index (batch->items, 0), index + 1);
+      } else {
+        GST_DEBUG_OBJECT (batch->queue, "Item to insert after is gone, appending");
+        clapper_queue_add_item (batch->queue, g_ptr_array_index (batch->items, 0));
+      }
+      break;
+    case QUEUE_OP_REMOVE:
+      GST_DEBUG_OBJECT (batch->queue, "Removing item");
+      clapper_queue_remove_item (batch->queue, g_ptr_array_index (batch->items, 0));
+      break;
+    case QUEUE_OP_CLEAR:
+      GST_DEBUG_OBJECT (batch->queue, "Clearing queue");
+      clapper_queue_clear (batch->queue);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+
+  if (batch->done_func)
+    batch->done_func (batch->done_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_schedule (ClapperControlHubQueueOp op, ClapperQueue *queue, GPtrArray *items,
+    ClapperMediaItem *after_item, GSourceFunc done_func, gpointer done_data, GDestroyNotify done_destroy)
+{
+  ClapperControlHubQueueBatch *batch = g_new (ClapperControlHubQueueBatch, 1);
+
+  batch->op = op;
+  batch->queue = gst_object_ref (queue);
+  batch->items = items;
+  batch->after_item = (after_item) ? gst_object_ref (after_item) : NULL;
+  batch->done_func = done_func;
+  batch->done_data = done_data;
+  batch->done_destroy = done_destroy;
+
+  g_main_context_invoke_full (g_main_context_default (), G_PRIORITY_DEFAULT,
+      (GSourceFunc) _alter_on_main_cb, batch, (GDestroyNotify) _batch_free);
+}
+
+static GPtrArray *
+_single_item_array (ClapperMediaItem *item)
+{
+  GPtrArray *items = g_ptr_array_new_full (1, (GDestroyNotify) gst_object_unref);
+
+  g_ptr_array_add (items, gst_object_ref (item));
+
+  return items;
+}
+
+/*
+ * Schedules appending of @items into @queue. Optional @done_func is
+ * called from main thread once they are added. It is also called when
+ * @items is empty, so it can be used to find out when all previously
+ * scheduled changes were handled.
+ */
+void
+clapper_control_hub_queue_append_items (ClapperQueue *queue, GPtrArray *items,
+    GSourceFunc done_func, gpointer done_data, GDestroyNotify done_destroy)
+{
+  _schedule (QUEUE_OP_APPEND, queue, g_ptr_array_ref (items), NULL,
+      done_func, done_data, done_destroy);
+}
+
+/* Schedules appending of a single @item into @queue */
+void
+clapper_control_hub_queue_append_item (ClapperQueue *queue, ClapperMediaItem *item)
+{
+  _schedule (QUEUE_OP_APPEND, queue, _single_item_array (item), NULL, NULL, NULL, NULL);
+}
+
+/* Schedules inserting of @item after @after_item into @queue */
+void
+clapper_control_hub_queue_insert_item (ClapperQueue *queue, ClapperMediaItem *item,
+    ClapperMediaItem *after_item)
+{
+  _schedule (QUEUE_OP_INSERT, queue, _single_item_array (item), after_item, NULL, NULL, NULL);
+}
+
+/* Schedules removal of @item from @queue */
+void
+clapper_control_hub_queue_remove_item (ClapperQueue *queue, ClapperMediaItem *item)
+{
+  _schedule (QUEUE_OP_REMOVE, queue, _single_item_array (item), NULL, NULL, NULL, NULL);
+}
+
+/* Schedules removal of all items from @queue */
+void
+clapper_control_hub_queue_clear (ClapperQueue *queue)
+{
+  _schedule (QUEUE_OP_CLEAR, queue, NULL, NULL, NULL, NULL, NULL);
+}
@@ -0,0 +1,43 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <clapper/clapper.h>
+
+G_BEGIN_DECLS
+
+void clapper_control_hub_queue_debug_init (void);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_queue_append_items (ClapperQueue *queue, GPtrArray *items, GSourceFunc done_func, gpointer done_data, GDestroyNotify done_destroy);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_queue_append_item (ClapperQueue *queue, ClapperMediaItem *item);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_queue_insert_item (ClapperQueue *queue, ClapperMediaItem *item, ClapperMediaItem *after_item);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_queue_remove_item (ClapperQueue *queue, ClapperMediaItem *item);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_queue_clear (ClapperQueue *queue);
+
+G_END_DECLS
@@ -0,0 +1,125 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Scrubbing happens when remote client sends seeks faster than
+ * "scrub-interval" (e.g. while user drags a slider). In such case
+ * only the latest requested position is used and seeking is done
+ * at most once per interval using fast (key unit) seeks. When
+ * client stops sending seeks, one final accurate seek is done.
+ */
+
+#include "clapper-control-hub-scrub.h"
+
+#define GST_CAT_DEFAULT clapper_control_hub_scrub_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+void
+clapper_control_hub_scrub_debug_init (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubscrub",
+      GST_DEBUG_FG_CYAN, "Clapper Control Hub Scrub");
+}
+
+static gboolean
+_scrub_tick_cb (ClapperControlHubScrub *scrub)
+{
+  ClapperPlayer *player;
+  gboolean finished = !scrub->pending;
+
+  if ((player = clapper_reactable_get_player (CLAPPER_REACTABLE_CAST (scrub->hub)))) {
+    if (finished) {
+      GST_DEBUG_OBJECT (scrub->hub, "Scrubbing finished at: %.3lf", scrub->target);
+      clapper_player_seek_custom (player, scrub->target, CLAPPER_PLAYER_SEEK_METHOD_ACCURATE);
+    } else {
+      GST_LOG_OBJECT (scrub->hub, "Scrubbing to: %.3lf", scrub->target);
+      clapper_player_seek_custom (player, scrub->target, CLAPPER_PLAYER_SEEK_METHOD_FAST);
+    }
+    gst_object_unref (player);
+  }
+
+  scrub->last_seek_time = g_get_monotonic_time ();
+  scrub->pending = FALSE;
+
+  if (finished) {
+    g_clear_pointer (&scrub->source, g_source_unref);
+    return G_SOURCE_REMOVE;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+void
+clapper_control_hub_scrub_init (ClapperControlHubScrub *scrub, ClapperControlHub *hub)
+{
+  scrub->hub = hub;
+  scrub->source = NULL;
+  scrub->last_seek_time = 0;
+  scrub->target = 0;
+  scrub->pending = FALSE;
+}
+
+/*
+ * Seeks to requested position, coalescing seeks
+ * that arrive faster than scrub interval.
+ */
+void
+clapper_control_hub_scrub_seek (ClapperControlHubScrub *scrub, ClapperPlayer *player, gdouble position)
+{
+  ClapperControlHub *hub = scrub->hub;
+  gint64 now;
+
+  scrub->target = position;
+
+  /* Already scrubbing, latest position will be used on next tick */
+  if (scrub->source) {
+    scrub->pending = TRUE;
+    return;
+  }
+
+  now = g_get_monotonic_time ();
+
+  /* Single seek or scrubbing disabled */
+  if (hub->scrub_interval == 0
+      || now - scrub->last_seek_time >= (gint64) hub->scrub_interval * G_TIME_SPAN_MILLISECOND) {
+    scrub->last_seek_time = now;
+    clapper_player_seek (player, position);
+    return;
+  }
+
+  GST_DEBUG_OBJECT (hub, "Scrubbing started");
+
+  scrub->last_seek_time = now;
+  scrub->pending = FALSE;
+  clapper_player_seek_custom (player, position, CLAPPER_PLAYER_SEEK_METHOD_FAST);
+
+  scrub->source = g_timeout_source_new (hub->scrub_interval);
+  g_source_set_callback (scrub->source, (GSourceFunc) _scrub_tick_cb, scrub, NULL);
+  g_source_attach (scrub->source, hub->context);
+}
+
+void
+clapper_control_hub_scrub_clear (ClapperControlHubScrub *scrub)
+{
+  if (scrub->source) {
+    g_source_destroy (scrub->source);
+    g_clear_pointer (&scrub->source, g_source_unref);
+  }
+
+  scrub->pending = FALSE;
+}
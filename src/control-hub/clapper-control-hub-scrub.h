@@ -0,0 +1,49 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <clapper/clapper.h>
+
+#include "clapper-control-hub.h"
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  ClapperControlHub *hub;
+  GSource *source;
+
+  gint64 last_seek_time;
+  gdouble target;
+  gboolean pending;
+} ClapperControlHubScrub;
+
+void clapper_control_hub_scrub_debug_init (void);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_scrub_init (ClapperControlHubScrub *scrub, ClapperControlHub *hub);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_scrub_seek (ClapperControlHubScrub *scrub, ClapperPlayer *player, gdouble position);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_scrub_clear (ClapperControlHubScrub *scrub);
+
+G_END_DECLS
@@ -0,0 +1,544 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Process-wide server shared by all control hub instances. It runs
+ * on its own thread and each hub is published under its own route
+ * ("/player/<index>"), so apps with multiple players end up with
+ * a single listening socket and MDNS responder.
+ */
+
+#include <gst/gst.h>
+
+#include "clapper-control-hub-server.h"
+#include "clapper-control-hub-import.h"
+#include "clapper-control-hub-ws.h"
+
+#define ROUTE_PREFIX "/player/"
+
+#define GST_CAT_DEFAULT clapper_control_hub_server_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+#define parent_class clapper_control_hub_server_parent_class
+G_DEFINE_TYPE (ClapperControlHubServer, clapper_control_hub_server, CLAPPER_TYPE_THREADED_OBJECT);
+
+typedef struct
+{
+  guint index;
+  gchar *path;
+  gchar *ws_path;
+  gboolean auth_required;
+
+  SoupServerCallback callback;
+  SoupServerWebsocketCallback ws_callback;
+  ClapperControlHubServerErrorFunc error_func;
+  gpointer user_data;
+} ClapperControlHubServerRoute;
+
+typedef struct
+{
+  GSourceFunc func;
+  gpointer data;
+
+  GMutex lock;
+  GCond cond;
+  gboolean done;
+} ClapperControlHubServerSyncCall;
+
+/* Clients not requesting any protocol use JSON */
+static const gchar *const ws_protocols[] = {
+  CLAPPER_CONTROL_HUB_WS_PROTOCOL_JSON,
+  CLAPPER_CONTROL_HUB_WS_PROTOCOL_MSGPACK,
+  NULL
+};
+
+G_LOCK_DEFINE_STATIC (shared_lock);
+static ClapperControlHubServer *_shared_server = NULL;
+static guint _n_users = 0;
+
+static void
+_route_free (ClapperControlHubServerRoute *route)
+{
+  g_free (route->path);
+  g_free (route->ws_path);
+
+  g_free (route);
+}
+
+static ClapperControlHubServerRoute *
+_find_route (ClapperControlHubServer *self, guint index, guint *position)
+{
+  guint i;
+
+  for (i = 0; i < self->routes->len; ++i) {
+    ClapperControlHubServerRoute *route = g_ptr_array_index (self->routes, i);
+
+    if (route->index == index) {
+      if (position)
+        *position = i;
+
+      return route;
+    }
+  }
+
+  return NULL;
+}
+
+static void
+_route_request_cb (SoupServer *soup_server, SoupServerMessage *msg,
+    const gchar *path, GHashTable *query, ClapperControlHubServerRoute *route)
+{
+  const gchar *subpath = path + strlen (route->path);
+
+  /* Route path itself is the same as "/" of a single player */
+  if (*subpath == '\0')
+    subpath = "/";
+
+  route->callback (soup_server, msg, subpath, query, route->user_data);
+}
+
+static void
+_route_ws_connection_cb (SoupServer *soup_server, SoupServerMessage *msg,
+    const gchar *path, SoupWebsocketConnection *connection, ClapperControlHubServerRoute *route)
+{
+  route->ws_callback (soup_server, msg, path, connection, route->user_data);
+}
+
+static void
+_players_request (ClapperControlHubServer *self, SoupServerMessage *msg)
+{
+  GString *json = g_string_new ("{\"players\":[");
+  gsize len;
+  guint i;
+
+  for (i = 0; i < self->routes->len; ++i) {
+    ClapperControlHubServerRoute *route = g_ptr_array_index (self->routes, i);
+
+    if (i > 0)
+      g_string_append_c (json, ',');
+
+    g_string_append_printf (json, "{\"index\":%u,\"path\":\"%s\"}", route->index, route->path);
+  }
+
+  g_string_append (json, "]}");
+
+  len = json->len;
+  soup_server_message_set_response (msg, "application/json",
+      SOUP_MEMORY_TAKE, g_string_free (json, FALSE), len);
+  soup_server_message_set_status (msg, SOUP_STATUS_OK, NULL);
+}
+
+/* Runs from "got-headers" of each request. Queue import is the only
+ * request with a body, so anything above its limit is refused before
+ * libsoup starts reading (and buffering) the body. */
+static void
+_early_request_cb (SoupServer *soup_server, SoupServerMessage *msg,
+    const gchar *path, GHashTable *query, ClapperControlHubServer *self)
+{
+  SoupMessageHeaders *headers = soup_server_message_get_request_headers (msg);
+
+  if (soup_message_headers_get_encoding (headers) == SOUP_ENCODING_CONTENT_LENGTH
+      && soup_message_headers_get_content_length (headers) > CLAPPER_CONTROL_HUB_IMPORT_MAX_SIZE) {
+    GST_WARNING_OBJECT (self, "Refusing request with %" G_GINT64_FORMAT " bytes body",
+        soup_message_headers_get_content_length (headers));
+    soup_server_message_set_status (msg, SOUP_STATUS_REQUEST_ENTITY_TOO_LARGE, NULL);
+  }
+}
+
+static void
+_default_request_cb (SoupServer *soup_server, SoupServerMessage *msg,
+    const gchar *path, GHashTable *query, ClapperControlHubServer *self)
+{
+  ClapperControlHubServerRoute *route;
+
+  if (strcmp (path, "/players") == 0) {
+    _players_request (self, msg);
+    return;
+  }
+
+  /* Route of a player that is not published (anymore) */
+  if (g_str_has_prefix (path, ROUTE_PREFIX) || self->routes->len == 0) {
+    soup_server_message_set_status (msg, SOUP_STATUS_NOT_FOUND, NULL);
+    return;
+  }
+
+  /* Paths without route prefix are served by the first player,
+   * so clients unaware of multiple players keep working */
+  route = g_ptr_array_index (self->routes, 0);
+  route->callback (soup_server, msg, path, query, route->user_data);
+}
+
+static void
+_default_ws_connection_cb (SoupServer *soup_server, SoupServerMessage *msg,
+    const gchar *path, SoupWebsocketConnection *connection, ClapperControlHubServer *self)
+{
+  ClapperControlHubServerRoute *route;
+
+  if (G_UNLIKELY (self->routes->len == 0)) {
+    soup_websocket_connection_close (connection, SOUP_WEBSOCKET_CLOSE_GOING_AWAY, NULL);
+    return;
+  }
+
+  route = g_ptr_array_index (self->routes, 0);
+  route->ws_callback (soup_server, msg, path, connection, route->user_data);
+}
+
+static inline gint
+_find_current_port (ClapperControlHubServer *self)
+{
+  GSList *uris_list, *list;
+  gint found_port = 0;
+
+  uris_list = soup_server_get_uris (self->soup_server);
+
+  for (list = uris_list; list != NULL; list = g_slist_next (list)) {
+    GUri *uri = list->data;
+    gint current_port = g_uri_get_port (uri);
+
+    if (current_port > 0) {
+      found_port = current_port;
+      break;
+    }
+  }
+
+  g_slist_free_full (uris_list, (GDestroyNotify) g_uri_unref);
+
+  if (G_UNLIKELY (found_port == 0))
+    GST_ERROR_OBJECT (self, "Could not determine server current port");
+
+  return found_port;
+}
+
+static gboolean
+_start_listening (ClapperControlHubServer *self, GError **error)
+{
+  if (!soup_server_listen_all (self->soup_server, 0, 0, error))
+    return FALSE;
+
+  self->port = _find_current_port (self);
+  GST_INFO_OBJECT (self, "Server started on port: %i", self->port);
+
+  if (G_LIKELY (self->port > 0)) {
+    /* Lazy create MDNS, so we do not open its
+     * sockets when no player is published */
+    if (!self->mdns) {
+      self->mdns = clapper_control_hub_mdns_new (self->context);
+      gst_object_set_parent (GST_OBJECT_CAST (self->mdns), GST_OBJECT_CAST (self));
+    }
+
+    clapper_control_hub_mdns_start (self->mdns, self->port);
+  }
+
+  return TRUE;
+}
+
+static void
+_stop_listening (ClapperControlHubServer *self)
+{
+  if (self->mdns)
+    clapper_control_hub_mdns_stop (self->mdns);
+
+  soup_server_disconnect (self->soup_server);
+  self->port = 0;
+
+  GST_INFO_OBJECT (self, "Server stopped");
+}
+
+static gboolean
+_sync_call_cb (ClapperControlHubServerSyncCall *call)
+{
+  call->func (call->data);
+
+  g_mutex_lock (&call->lock);
+  call->done = TRUE;
+  g_cond_signal (&call->cond);
+  g_mutex_unlock (&call->lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_report_error_cb (GError *error)
+{
+  guint i;
+
+  /* Server might be released meanwhile, so keep it locked,
+   * this way its last reference is never dropped here */
+  G_LOCK (shared_lock);
+
+  if (G_LIKELY (_shared_server != NULL)) {
+    for (i = 0; i < _shared_server->routes->len; ++i) {
+      ClapperControlHubServerRoute *route = g_ptr_array_index (_shared_server->routes, i);
+      route->error_func (error, route->user_data);
+    }
+  }
+
+  G_UNLOCK (shared_lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Returns server shared within process, creating it if needed.
+ * Can be called from any thread. Each call must be paired with
+ * clapper_control_hub_server_release().
+ */
+ClapperControlHubServer *
+clapper_control_hub_server_obtain (void)
+{
+  ClapperControlHubServer *server;
+
+  G_LOCK (shared_lock);
+
+  if (!_shared_server) {
+    _shared_server = g_object_new (CLAPPER_TYPE_CONTROL_HUB_SERVER, NULL);
+    gst_object_ref_sink (_shared_server);
+  }
+  server = _shared_server;
+  _n_users++;
+
+  G_UNLOCK (shared_lock);
+
+  return server;
+}
+
+/*
+ * Can be called from any thread other than server one. Server
+ * (and its thread) is destroyed when its last user releases it.
+ */
+void
+clapper_control_hub_server_release (ClapperControlHubServer *server)
+{
+  ClapperControlHubServer *last = NULL;
+
+  G_LOCK (shared_lock);
+
+  if (--_n_users == 0)
+    last = g_steal_pointer (&_shared_server);
+
+  G_UNLOCK (shared_lock);
+
+  if (last)
+    gst_object_unref (last);
+}
+
+/*
+ * Runs function within server thread and waits until it finishes.
+ * Calls queued from the same thread before this one are always
+ * processed first, as they have the same priority.
+ */
+void
+clapper_control_hub_server_invoke_sync (ClapperControlHubServer *self, GSourceFunc func, gpointer data)
+{
+  ClapperControlHubServerSyncCall call = { func, data, };
+
+  if (g_main_context_is_owner (self->context)) {
+    func (data);
+    return;
+  }
+
+  g_mutex_init (&call.lock);
+  g_cond_init (&call.cond);
+
+  g_main_context_invoke (self->context, (GSourceFunc) _sync_call_cb, &call);
+
+  g_mutex_lock (&call.lock);
+  while (!call.done)
+    g_cond_wait (&call.cond, &call.lock);
+  g_mutex_unlock (&call.lock);
+
+  g_mutex_clear (&call.lock);
+  g_cond_clear (&call.cond);
+}
+
+/*
+ * Makes player available under its route. Server starts listening
+ * together with publishing the first one. Error functions are called
+ * for issues not related to any particular route (e.g. from MDNS).
+ */
+gboolean
+clapper_control_hub_server_publish (ClapperControlHubServer *self, guint index,
+    gboolean auth_required, SoupServerCallback callback, SoupServerWebsocketCallback ws_callback,
+    ClapperControlHubServerErrorFunc error_func, gpointer user_data, GError **error)
+{
+  ClapperControlHubServerRoute *route;
+  guint i;
+
+  g_return_val_if_fail (_find_route (self, index, NULL) == NULL, FALSE);
+
+  if (self->routes->len == 0 && !_start_listening (self, error))
+    return FALSE;
+
+  route = g_new0 (ClapperControlHubServerRoute, 1);
+  route->index = index;
+  route->path = g_strdup_printf (ROUTE_PREFIX "%u", index);
+  route->ws_path = g_strdup_printf (ROUTE_PREFIX "%u/websocket", index);
+  route->auth_required = auth_required;
+  route->callback = callback;
+  route->ws_callback = ws_callback;
+  route->error_func = error_func;
+  route->user_data = user_data;
+
+  soup_server_add_handler (self->soup_server, route->path,
+      (SoupServerCallback) _route_request_cb, route, NULL);
+  soup_server_add_websocket_handler (self->soup_server, route->ws_path, NULL, (gchar **) ws_protocols,
+      (SoupServerWebsocketCallback) _route_ws_connection_cb, route, NULL);
+
+  /* Keep sorted, so the first published player is always the default one */
+  for (i = 0; i < self->routes->len; ++i) {
+    if (((ClapperControlHubServerRoute *) g_ptr_array_index (self->routes, i))->index > index)
+      break;
+  }
+  g_ptr_array_insert (self->routes, i, route);
+
+  if (self->mdns)
+    clapper_control_hub_mdns_add_service (self->mdns, index, route->path, route->auth_required);
+
+  GST_INFO_OBJECT (self, "Published route: %s", route->path);
+
+  return TRUE;
+}
+
+void
+clapper_control_hub_server_unpublish (ClapperControlHubServer *self, guint index)
+{
+  ClapperControlHubServerRoute *route;
+  guint position;
+
+  if (!(route = _find_route (self, index, &position)))
+    return;
+
+  GST_INFO_OBJECT (self, "Unpublishing route: %s", route->path);
+
+  if (self->mdns)
+    clapper_control_hub_mdns_remove_service (self->mdns, index);
+
+  soup_server_remove_handler (self->soup_server, route->ws_path);
+  soup_server_remove_handler (self->soup_server, route->path);
+  g_ptr_array_remove_index (self->routes, position);
+
+  if (self->routes->len == 0)
+    _stop_listening (self);
+}
+
+/*
+ * Updates whether clients of published player must pair
+ * first, so it can be advertised to them before connecting.
+ */
+void
+clapper_control_hub_server_set_auth_required (ClapperControlHubServer *self, guint index, gboolean auth_required)
+{
+  ClapperControlHubServerRoute *route;
+
+  if (!(route = _find_route (self, index, NULL)))
+    return;
+
+  route->auth_required = auth_required;
+
+  if (self->mdns)
+    clapper_control_hub_mdns_set_service_auth (self->mdns, index, auth_required);
+}
+
+/*
+ * Reports error to all published players.
+ * Can be called from any thread.
+ */
+void
+clapper_control_hub_server_report_error (ClapperControlHubServer *self, const GError *error)
+{
+  g_main_context_invoke_full (self->context, G_PRIORITY_DEFAULT,
+      (GSourceFunc) _report_error_cb, g_error_copy (error), (GDestroyNotify) g_error_free);
+}
+
+static void
+clapper_control_hub_server_thread_start (ClapperThreadedObject *threaded_object)
+{
+  ClapperControlHubServer *self = CLAPPER_CONTROL_HUB_SERVER_CAST (threaded_object);
+
+  GST_DEBUG_OBJECT (self, "Creating server");
+
+  self->soup_server = soup_server_new ("server-header", "ClapperControlHub", NULL);
+  soup_server_add_early_handler (self->soup_server, NULL,
+      (SoupServerCallback) _early_request_cb, self, NULL);
+  soup_server_add_handler (self->soup_server, "/",
+      (SoupServerCallback) _default_request_cb, self, NULL);
+  soup_server_add_websocket_handler (self->soup_server, "/websocket", NULL, (gchar **) ws_protocols,
+      (SoupServerWebsocketCallback) _default_ws_connection_cb, self, NULL);
+}
+
+static void
+clapper_control_hub_server_thread_stop (ClapperThreadedObject *threaded_object)
+{
+  ClapperControlHubServer *self = CLAPPER_CONTROL_HUB_SERVER_CAST (threaded_object);
+
+  /* All players should be unpublished by now */
+  if (G_UNLIKELY (self->routes->len > 0)) {
+    g_ptr_array_set_size (self->routes, 0);
+    _stop_listening (self);
+  }
+
+  if (self->mdns) {
+    gst_object_unparent (GST_OBJECT_CAST (self->mdns));
+    gst_clear_object (&self->mdns);
+  }
+  g_clear_object (&self->soup_server);
+}
+
+static void
+clapper_control_hub_server_init (ClapperControlHubServer *self)
+{
+  self->routes = g_ptr_array_new_with_free_func ((GDestroyNotify) _route_free);
+}
+
+static void
+clapper_control_hub_server_constructed (GObject *object)
+{
+  ClapperControlHubServer *self = CLAPPER_CONTROL_HUB_SERVER_CAST (object);
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  self->context = clapper_threaded_object_get_context (CLAPPER_THREADED_OBJECT_CAST (self));
+}
+
+static void
+clapper_control_hub_server_finalize (GObject *object)
+{
+  ClapperControlHubServer *self = CLAPPER_CONTROL_HUB_SERVER_CAST (object);
+
+  GST_TRACE_OBJECT (self, "Finalize");
+
+  g_ptr_array_unref (self->routes);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+clapper_control_hub_server_class_init (ClapperControlHubServerClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  ClapperThreadedObjectClass *threaded_object = (ClapperThreadedObjectClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubserver",
+      GST_DEBUG_FG_RED, "Clapper Control Hub Server");
+
+  gobject_class->constructed = clapper_control_hub_server_constructed;
+  gobject_class->finalize = clapper_control_hub_server_finalize;
+
+  threaded_object->thread_start = clapper_control_hub_server_thread_start;
+  threaded_object->thread_stop = clapper_control_hub_server_thread_stop;
+}
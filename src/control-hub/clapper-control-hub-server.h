@@ -0,0 +1,77 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+#include <clapper/clapper.h>
+#include <libsoup/soup.h>
+
+#include "clapper-control-hub-mdns.h"
+
+G_BEGIN_DECLS
+
+#define CLAPPER_TYPE_CONTROL_HUB_SERVER (clapper_control_hub_server_get_type())
+#define CLAPPER_CONTROL_HUB_SERVER_CAST(obj) ((ClapperControlHubServer *)(obj))
+
+G_GNUC_INTERNAL
+G_DECLARE_FINAL_TYPE (ClapperControlHubServer, clapper_control_hub_server, CLAPPER, CONTROL_HUB_SERVER, ClapperThreadedObject)
+
+typedef void (* ClapperControlHubServerErrorFunc) (const GError *error, gpointer user_data);
+
+/*
+ * Everything below, unless stated otherwise, must
+ * be used only from within server thread context.
+ */
+struct _ClapperControlHubServer
+{
+  ClapperThreadedObject parent;
+
+  GMainContext *context;
+  SoupServer *soup_server;
+  gint port;
+
+  /* Published routes sorted by index */
+  GPtrArray *routes;
+
+  ClapperControlHubMdns *mdns;
+};
+
+G_GNUC_INTERNAL
+ClapperControlHubServer * clapper_control_hub_server_obtain (void);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_server_release (ClapperControlHubServer *server);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_server_invoke_sync (ClapperControlHubServer *server, GSourceFunc func, gpointer data);
+
+G_GNUC_INTERNAL
+gboolean clapper_control_hub_server_publish (ClapperControlHubServer *server, guint index, gboolean auth_required, SoupServerCallback callback, SoupServerWebsocketCallback ws_callback, ClapperControlHubServerErrorFunc error_func, gpointer user_data, GError **error);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_server_unpublish (ClapperControlHubServer *server, guint index);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_server_set_auth_required (ClapperControlHubServer *server, guint index, gboolean auth_required);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_server_report_error (ClapperControlHubServer *server, const GError *error);
+
+G_END_DECLS
@@ -0,0 +1,356 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "clapper-control-hub-sse.h"
+#include "clapper-control-hub-broadcast.h"
+#include "clapper-control-hub-json.h"
+#include "clapper-control-hub-ws.h"
+
+/* Comment sent to idle clients, so proxies do not drop connection */
+#define KEEPALIVE_INTERVAL 15
+#define KEEPALIVE_COMMENT ": keepalive\n\n"
+
+#define GST_CAT_DEFAULT clapper_control_hub_sse_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+struct _ClapperControlHubSseClient
+{
+  ClapperControlHub *hub;
+  SoupServerMessage *msg;
+
+  /* Amount of appended data that libsoup did not write yet */
+  gsize queued_bytes;
+
+  /* Same as with WebSocket clients, events are dropped once over
+   * high-water mark and a fresh snapshot is sent after catching up */
+  gboolean needs_snapshot;
+
+  /* Nothing was sent since last keepalive tick */
+  gboolean idle;
+
+  GSource *catch_up_source;
+  GSource *stall_source;
+};
+
+void
+clapper_control_hub_sse_debug_init (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhubsse",
+      GST_DEBUG_FG_YELLOW, "Clapper Control Hub Server-Sent Events");
+}
+
+static void
+_sse_client_clear_sources (ClapperControlHubSseClient *client)
+{
+  if (client->catch_up_source) {
+    g_source_destroy (client->catch_up_source);
+    g_clear_pointer (&client->catch_up_source, g_source_unref);
+  }
+  if (client->stall_source) {
+    g_source_destroy (client->stall_source);
+    g_clear_pointer (&client->stall_source, g_source_unref);
+  }
+}
+
+void
+clapper_control_hub_sse_client_free (ClapperControlHubSseClient *client)
+{
+  _sse_client_clear_sources (client);
+
+  g_signal_handlers_disconnect_by_data (client->msg, client);
+  g_object_unref (client->msg);
+
+  g_free (client);
+}
+
+static void
+_sse_client_append (ClapperControlHubSseClient *client, gchar *data)
+{
+  gsize len = strlen (data);
+
+  client->queued_bytes += len;
+  client->idle = FALSE;
+
+  soup_message_body_append (soup_server_message_get_response_body (client->msg),
+      SOUP_MEMORY_TAKE, data, len);
+  soup_server_message_unpause (client->msg);
+}
+
+/* Event ID is its sequence number, so browsers send it back
+ * in "Last-Event-ID" header when reconnecting */
+static inline void
+_sse_client_append_event (ClapperControlHubSseClient *client, guint64 seq, const gchar *text)
+{
+  _sse_client_append (client, g_strdup_printf ("id: %" G_GUINT64_FORMAT "\ndata: %s\n\n", seq, text));
+}
+
+/* Without ID, so it does not alter "Last-Event-ID" */
+static void
+_sse_client_append_clock (ClapperControlHubSseClient *client)
+{
+  gchar text[CLAPPER_CONTROL_HUB_JSON_EVENT_SIZE];
+
+  clapper_control_hub_json_fill_clock_message (text, g_get_monotonic_time () / 1000);
+  _sse_client_append (client, g_strdup_printf ("data: %s\n\n", text));
+}
+
+static void
+_sse_client_send_snapshot (ClapperControlHubSseClient *client)
+{
+  ClapperControlHub *hub = client->hub;
+
+  /* Snapshot must not include changes that were not sent yet */
+  clapper_control_hub_broadcast_flush (hub);
+
+  if (!hub->snapshot)
+    hub->snapshot = clapper_control_hub_json_build_default (hub, TRUE);
+
+  /* Snapshot covers all events sent so far */
+  _sse_client_append_event (client, hub->seq, hub->snapshot);
+
+  /* Snapshot is cached, so current server time is sent separately */
+  _sse_client_append_clock (client);
+}
+
+/* Ends event stream, server might be still running */
+static void
+_sse_client_close (ClapperControlHubSseClient *client)
+{
+  soup_message_body_complete (soup_server_message_get_response_body (client->msg));
+  soup_server_message_unpause (client->msg);
+}
+
+static gboolean
+_sse_client_caught_up_cb (ClapperControlHubSseClient *client)
+{
+  GST_DEBUG_OBJECT (client->hub, "SSE client %p caught up", client->msg);
+
+  g_clear_pointer (&client->catch_up_source, g_source_unref);
+  _sse_client_clear_sources (client);
+
+  /* Keep flag set while sending, so pending events
+   * flushed before snapshot are not sent to this client */
+  _sse_client_send_snapshot (client);
+  client->needs_snapshot = FALSE;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_sse_wrote_body_data_cb (SoupServerMessage *msg, guint chunk_size, ClapperControlHubSseClient *client)
+{
+  client->queued_bytes -= MIN (chunk_size, client->queued_bytes);
+
+  /* Snapshot is sent from a separate callback, not while libsoup is writing */
+  if (client->queued_bytes == 0 && client->needs_snapshot && !client->catch_up_source) {
+    client->catch_up_source = g_idle_source_new ();
+    g_source_set_callback (client->catch_up_source,
+        (GSourceFunc) _sse_client_caught_up_cb, client, NULL);
+    g_source_attach (client->catch_up_source, client->hub->context);
+  }
+}
+
+static void
+_sse_keepalive_stop (ClapperControlHub *hub)
+{
+  if (hub->sse_keepalive_source) {
+    g_source_destroy (hub->sse_keepalive_source);
+    g_clear_pointer (&hub->sse_keepalive_source, g_source_unref);
+  }
+}
+
+static gboolean
+_sse_client_stalled_cb (ClapperControlHubSseClient *client)
+{
+  ClapperControlHub *hub = client->hub;
+
+  GST_WARNING_OBJECT (hub, "SSE client %p stalled, disconnecting", client->msg);
+
+  g_clear_pointer (&client->stall_source, g_source_unref);
+
+  /* Removing from array disconnects "finished" signal handler */
+  _sse_client_close (client);
+  g_ptr_array_remove (hub->sse_clients, client);
+
+  if (hub->sse_clients->len == 0)
+    _sse_keepalive_stop (hub);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called once client went past high-water mark */
+static void
+_sse_client_throttle (ClapperControlHubSseClient *client)
+{
+  ClapperControlHub *hub = client->hub;
+
+  GST_INFO_OBJECT (hub, "SSE client %p queue over limit (%" G_GSIZE_FORMAT
+      " bytes), dropping events until it catches up", client->msg, client->queued_bytes);
+
+  client->needs_snapshot = TRUE;
+
+  if (!client->stall_source && hub->client_stall_timeout > 0) {
+    client->stall_source = g_timeout_source_new_seconds (hub->client_stall_timeout);
+    g_source_set_callback (client->stall_source,
+        (GSourceFunc) _sse_client_stalled_cb, client, NULL);
+    g_source_attach (client->stall_source, hub->context);
+  }
+}
+
+static gboolean
+_sse_keepalive_cb (ClapperControlHub *hub)
+{
+  guint i;
+
+  for (i = 0; i < hub->sse_clients->len; ++i) {
+    ClapperControlHubSseClient *client = g_ptr_array_index (hub->sse_clients, i);
+
+    /* Throttled clients are not idle, they are behind */
+    if (client->idle && !client->needs_snapshot)
+      _sse_client_append (client, g_strdup (KEEPALIVE_COMMENT));
+
+    client->idle = TRUE;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+_sse_finished_cb (SoupServerMessage *msg, ClapperControlHubSseClient *client)
+{
+  ClapperControlHub *hub = client->hub;
+
+  GST_INFO_OBJECT (hub, "SSE connection closed: %p", msg);
+
+  g_ptr_array_remove (hub->sse_clients, client);
+
+  if (hub->sse_clients->len == 0)
+    _sse_keepalive_stop (hub);
+}
+
+static gboolean
+_sse_parse_last_event_id (SoupServerMessage *msg, guint64 *last_seq)
+{
+  const gchar *id_str;
+  gchar *endptr = NULL;
+
+  if (!(id_str = soup_message_headers_get_one (
+      soup_server_message_get_request_headers (msg), "Last-Event-ID")))
+    return FALSE;
+
+  *last_seq = g_ascii_strtoull (id_str, &endptr, 10);
+
+  return (endptr != id_str && *endptr == '\0');
+}
+
+void
+clapper_control_hub_sse_request_cb (SoupServer *server, SoupServerMessage *msg,
+    const gchar *path, GHashTable *query, ClapperControlHub *hub)
+{
+  ClapperControlHubSseClient *client;
+  SoupMessageHeaders *headers;
+  guint64 last_seq = 0;
+
+  if (soup_server_message_get_method (msg) != SOUP_METHOD_GET) {
+    soup_server_message_set_status (msg, SOUP_STATUS_METHOD_NOT_ALLOWED, NULL);
+    return;
+  }
+
+  GST_INFO_OBJECT (hub, "New SSE connection: %p", msg);
+
+  /* Same as with WebSocket, existing clients must
+   * receive pending changes before snapshot is sent */
+  clapper_control_hub_broadcast_flush (hub);
+
+  headers = soup_server_message_get_response_headers (msg);
+  soup_message_headers_set_encoding (headers, SOUP_ENCODING_CHUNKED);
+  soup_message_headers_set_content_type (headers, "text/event-stream", NULL);
+  soup_message_headers_replace (headers, "Cache-Control", "no-cache");
+
+  /* Sent events do not need to be kept around */
+  soup_message_body_set_accumulate (soup_server_message_get_response_body (msg), FALSE);
+
+  soup_server_message_set_status (msg, SOUP_STATUS_OK, NULL);
+
+  client = g_new0 (ClapperControlHubSseClient, 1);
+  client->hub = hub;
+  client->msg = g_object_ref (msg);
+
+  g_signal_connect (msg, "wrote-body-data", G_CALLBACK (_sse_wrote_body_data_cb), client);
+  g_signal_connect (msg, "finished", G_CALLBACK (_sse_finished_cb), client);
+  g_ptr_array_add (hub->sse_clients, client);
+
+  if (!hub->sse_keepalive_source) {
+    hub->sse_keepalive_source = g_timeout_source_new_seconds (KEEPALIVE_INTERVAL);
+    g_source_set_callback (hub->sse_keepalive_source,
+        (GSourceFunc) _sse_keepalive_cb, hub, NULL);
+    g_source_attach (hub->sse_keepalive_source, hub->context);
+  }
+
+  /* Reconnecting client gets only events it missed when possible */
+  if (_sse_parse_last_event_id (msg, &last_seq)
+      && clapper_control_hub_ws_history_can_resume (hub, last_seq)) {
+    guint64 seq;
+
+    GST_DEBUG_OBJECT (hub, "Resuming SSE client %p, missed events: %"
+        G_GUINT64_FORMAT, msg, hub->seq - last_seq);
+
+    for (seq = last_seq + 1; seq <= hub->seq; ++seq)
+      _sse_client_append_event (client, seq, clapper_control_hub_ws_history_get (hub, seq));
+  } else {
+    _sse_client_send_snapshot (client);
+  }
+}
+
+void
+clapper_control_hub_sse_send (ClapperControlHub *hub, guint64 seq, const gchar *text)
+{
+  guint i;
+
+  for (i = 0; i < hub->sse_clients->len; ++i) {
+    ClapperControlHubSseClient *client = g_ptr_array_index (hub->sse_clients, i);
+
+    /* Snapshot sent after client catches up will carry current state */
+    if (client->needs_snapshot)
+      continue;
+
+    if (hub->client_queue_limit > 0
+        && client->queued_bytes > hub->client_queue_limit) {
+      _sse_client_throttle (client);
+      continue;
+    }
+
+    _sse_client_append_event (client, seq, text);
+  }
+}
+
+void
+clapper_control_hub_sse_clear (ClapperControlHub *hub)
+{
+  guint i;
+
+  _sse_keepalive_stop (hub);
+
+  for (i = 0; i < hub->sse_clients->len; ++i)
+    _sse_client_close (g_ptr_array_index (hub->sse_clients, i));
+
+  if (hub->sse_clients->len > 0)
+    g_ptr_array_remove_range (hub->sse_clients, 0, hub->sse_clients->len);
+}
@@ -0,0 +1,42 @@
+/* Clapper Enhancer Control Hub
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include "clapper-control-hub.h"
+
+G_BEGIN_DECLS
+
+typedef struct _ClapperControlHubSseClient ClapperControlHubSseClient;
+
+void clapper_control_hub_sse_debug_init (void);
+
+void clapper_control_hub_sse_client_free (ClapperControlHubSseClient *client);
+
+void clapper_control_hub_sse_request_cb (SoupServer *server, SoupServerMessage *msg, const gchar *path, GHashTable *query, ClapperControlHub *hub);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_sse_send (ClapperControlHub *hub, guint64 seq, const gchar *text);
+
+G_GNUC_INTERNAL
+void clapper_control_hub_sse_clear (ClapperControlHub *hub);
+
+G_END_DECLS
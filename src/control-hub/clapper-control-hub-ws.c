@@ -20,9 +20,21 @@
 
 #include "clapper-control-hub.h"
 #include "clapper-control-hub-actions.h"
+#include "clapper-control-hub-auth.h"
+#include "clapper-control-hub-broadcast.h"
 #include "clapper-control-hub-json.h"
+#include "clapper-control-hub-msgpack.h"
+#include "clapper-control-hub-queue.h"
+#include "clapper-control-hub-scrub.h"
+#include "clapper-control-hub-sse.h"
 #include "clapper-control-hub-ws.h"
 
+/* Amount of recent event frames kept for resuming clients */
+#define HISTORY_SIZE 128
+
+#define MAX_BATCH_ACTIONS 1000
+#define MAX_REQUEST_ID_LENGTH 64
+
 #define GST_CAT_DEFAULT clapper_control_hub_ws_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
@@ -33,37 +45,455 @@ clapper_control_hub_ws_debug_init (void)
       GST_DEBUG_FG_YELLOW, "Clapper Control Hub WebSocket");
 }
 
+struct _ClapperControlHubWsClient
+{
+  ClapperControlHub *hub;
+  SoupWebsocketConnection *connection;
+  GSocket *socket;
+
+  /* Client negotiated MessagePack subprotocol */
+  gboolean binary;
+
+  /* Cleared until client pairs when token is set,
+   * nonce is what client was challenged with and
+   * session is the one it is resuming (if any) */
+  gboolean authenticated;
+  gchar *nonce;
+  gchar *session;
+  gchar *remote_host;
+
+  /* Amount of data sent since client was last seen with everything
+   * written out, which is what libsoup might keep buffered for it */
+  gsize queued_bytes;
+
+  /* Client went past high-water mark, events are dropped
+   * until it catches up and receives a fresh snapshot */
+  gboolean needs_snapshot;
+
+  GSource *drain_source;
+  GSource *stall_source;
+
+  ClapperControlHubScrub scrub;
+};
+
+static ClapperControlHubWsClient *
+_ws_client_new (ClapperControlHub *hub, SoupWebsocketConnection *connection,
+    GSocket *socket, const gchar *remote_host)
+{
+  ClapperControlHubWsClient *client = g_new0 (ClapperControlHubWsClient, 1);
+
+  client->hub = hub;
+  client->connection = g_object_ref (connection);
+  client->remote_host = g_strdup (remote_host);
+  client->binary = (g_strcmp0 (soup_websocket_connection_get_protocol (connection),
+      CLAPPER_CONTROL_HUB_WS_PROTOCOL_MSGPACK) == 0);
+
+  client->authenticated = (hub->pairing_token == NULL);
+
+  if (socket)
+    client->socket = g_object_ref (socket);
+
+  clapper_control_hub_scrub_init (&client->scrub, hub);
+
+  return client;
+}
+
 static void
-_ws_message_cb (SoupWebsocketConnection *connection, gint type, GBytes *message, ClapperControlHub *hub)
+_ws_client_clear_sources (ClapperControlHubWsClient *client)
 {
-  ClapperPlayer *player;
-  ClapperControlHubAction action;
-  const gchar *text;
+  if (client->drain_source) {
+    g_source_destroy (client->drain_source);
+    g_clear_pointer (&client->drain_source, g_source_unref);
+  }
+  if (client->stall_source) {
+    g_source_destroy (client->stall_source);
+    g_clear_pointer (&client->stall_source, g_source_unref);
+  }
+}
+
+void
+clapper_control_hub_ws_client_free (ClapperControlHubWsClient *client)
+{
+  _ws_client_clear_sources (client);
+  clapper_control_hub_scrub_clear (&client->scrub);
+
+  g_object_unref (client->connection);
+  g_clear_object (&client->socket);
+  g_free (client->nonce);
+  g_free (client->session);
+  g_free (client->remote_host);
+
+  g_free (client);
+}
+
+static void _ws_client_watch_drain (ClapperControlHubWsClient *client);
+
+/*
+ * Sends JSON frame in client format. For binary clients frame is
+ * transcoded once and stored in @binary_frame for reuse with others.
+ * Returns size of data that was sent.
+ */
+static gsize
+_ws_client_send_frame (ClapperControlHubWsClient *client, const gchar *frame, GBytes **binary_frame)
+{
+  gsize size;
+
+  if (!client->binary) {
+    soup_websocket_connection_send_text (client->connection, frame);
+    size = strlen (frame);
+  } else if (*binary_frame || (*binary_frame = clapper_control_hub_msgpack_from_json (frame))) {
+    soup_websocket_connection_send_message (client->connection,
+        SOUP_WEBSOCKET_DATA_BINARY, *binary_frame);
+    size = g_bytes_get_size (*binary_frame);
+  } else {
+    GST_ERROR_OBJECT (client->hub, "Could not transcode frame: \"%s\"", frame);
+    return 0;
+  }
+
+  /* Without a socket there is no way to tell, assume it keeps up */
+  if (G_UNLIKELY (client->socket == NULL) || client->hub->client_queue_limit == 0)
+    return size;
+
+  client->queued_bytes += size;
+
+  /* Only check once enough data piles up, so sending
+   * small events does not keep re-arming the watch */
+  if (!client->drain_source && client->queued_bytes >= client->hub->client_queue_limit / 4)
+    _ws_client_watch_drain (client);
+
+  return size;
+}
+
+void
+clapper_control_hub_ws_history_init (ClapperControlHub *hub)
+{
+  hub->history = g_ptr_array_new_with_free_func ((GDestroyNotify) g_free);
+  g_ptr_array_set_size (hub->history, HISTORY_SIZE);
+
+  /* Start from current time, so sequence numbers that clients
+   * remember from previous player run are never matched */
+  hub->seq = (guint64) g_get_real_time ();
+  hub->history_first = hub->seq + 1;
+}
+
+/*
+ * Makes events sent so far unavailable for resuming. Used when
+ * state changed without clients being notified about it.
+ */
+void
+clapper_control_hub_ws_history_reset (ClapperControlHub *hub)
+{
+  if (hub->history_first <= hub->seq) {
+    guint i;
+
+    for (i = 0; i < HISTORY_SIZE; ++i)
+      g_clear_pointer (&g_ptr_array_index (hub->history, i), g_free);
+  }
+
+  hub->history_first = ++hub->seq + 1;
+}
+
+static void
+_ws_history_push (ClapperControlHub *hub, gchar *frame)
+{
+  gpointer *entry = &g_ptr_array_index (hub->history, hub->seq % HISTORY_SIZE);
+
+  g_free (*entry);
+  *entry = frame;
+
+  if (hub->seq - hub->history_first >= HISTORY_SIZE)
+    hub->history_first = hub->seq - HISTORY_SIZE + 1;
+}
+
+/*
+ * Checks if all events sent after @last_seq are still in history,
+ * so client that saw events up to it can resume from there.
+ */
+gboolean
+clapper_control_hub_ws_history_can_resume (ClapperControlHub *hub, guint64 last_seq)
+{
+  return (last_seq <= hub->seq && last_seq + 1 >= hub->history_first);
+}
+
+/*
+ * Gets event frame with given sequence number. It must be within
+ * range checked with clapper_control_hub_ws_history_can_resume().
+ */
+const gchar *
+clapper_control_hub_ws_history_get (ClapperControlHub *hub, guint64 seq)
+{
+  return g_ptr_array_index (hub->history, seq % HISTORY_SIZE);
+}
+
+/* Sends events client missed since @last_seq, returns %FALSE
+ * if they are not all available anymore */
+static gboolean
+_ws_client_resume (ClapperControlHubWsClient *client, guint64 last_seq)
+{
+  ClapperControlHub *hub = client->hub;
+  guint64 seq;
+
+  if (!clapper_control_hub_ws_history_can_resume (hub, last_seq))
+    return FALSE;
+
+  GST_DEBUG_OBJECT (hub, "Resuming WebSocket client %p, missed events: %"
+      G_GUINT64_FORMAT, client->connection, hub->seq - last_seq);
+
+  for (seq = last_seq + 1; seq <= hub->seq; ++seq) {
+    GBytes *binary_frame = NULL;
+
+    _ws_client_send_frame (client,
+        clapper_control_hub_ws_history_get (hub, seq), &binary_frame);
+
+    if (binary_frame)
+      g_bytes_unref (binary_frame);
+  }
+
+  return TRUE;
+}
 
-  if (G_UNLIKELY (type != SOUP_WEBSOCKET_DATA_TEXT)) {
-    GST_WARNING_OBJECT (hub, "Received WS message with non-text data!");
+static void
+_ws_client_send_clock (ClapperControlHubWsClient *client)
+{
+  GBytes *binary_frame = NULL;
+  gchar frame[CLAPPER_CONTROL_HUB_JSON_EVENT_SIZE];
+
+  clapper_control_hub_json_fill_clock_message (frame, g_get_monotonic_time () / 1000);
+  _ws_client_send_frame (client, frame, &binary_frame);
+
+  if (binary_frame)
+    g_bytes_unref (binary_frame);
+}
+
+static void
+_ws_client_send_snapshot (ClapperControlHubWsClient *client)
+{
+  ClapperControlHub *hub = client->hub;
+
+  /* Snapshot must not include changes that were not sent yet */
+  clapper_control_hub_broadcast_flush (hub);
+
+  /* Reused until state changes */
+  if (!hub->snapshot)
+    hub->snapshot = clapper_control_hub_json_build_default (hub, TRUE);
+
+  _ws_client_send_frame (client, hub->snapshot, &hub->snapshot_binary);
+
+  /* Snapshot is cached, so current server time is sent separately */
+  _ws_client_send_clock (client);
+}
+
+static void
+_ws_client_send_challenge (ClapperControlHubWsClient *client)
+{
+  GBytes *binary_frame = NULL;
+  gchar *challenge;
+
+  g_free (client->nonce);
+
+  if (!(client->nonce = clapper_control_hub_auth_new_nonce ())) {
+    soup_websocket_connection_close (client->connection,
+        SOUP_WEBSOCKET_CLOSE_SERVER_ERROR, "Pairing unavailable");
     return;
   }
 
-  text = g_bytes_get_data (message, NULL);
+  challenge = g_strdup_printf ("{\"event\":\"auth_challenge\",\"nonce\":\"%s\",\"resume\":%s}",
+      client->nonce, (client->session) ? "true" : "false");
+  _ws_client_send_frame (client, challenge, &binary_frame);
+
+  if (binary_frame)
+    g_bytes_unref (binary_frame);
 
-  if (G_UNLIKELY (text == NULL || *text == '\0')) {
-    GST_WARNING_OBJECT (hub, "Received WS message without any text!");
+  g_free (challenge);
+}
+
+/*
+ * Handles "auth" action of client that did not pair yet. Client gets
+ * only one attempt per connection and failures are limited per host,
+ * so guessing is not possible.
+ */
+static void
+_ws_client_authenticate (ClapperControlHubWsClient *client, const gchar *text)
+{
+  ClapperControlHub *hub = client->hub;
+  GBytes *binary_frame = NULL;
+  gchar *session = NULL, *reply;
+
+  /* "auth" + whitespace = 5 */
+  if (client->nonce && g_str_has_prefix (text, "auth ")) {
+    gchar *response = g_strstrip (g_strdup (text + 5));
+
+    session = clapper_control_hub_auth_verify (hub, client->remote_host,
+        client->nonce, client->session, response);
+    g_free (response);
+  } else {
+    GST_WARNING_OBJECT (hub, "Ignoring WS message from client that did not pair yet");
     return;
   }
 
+  g_clear_pointer (&client->nonce, g_free);
+  g_clear_pointer (&client->session, g_free);
+
+  if ((client->authenticated = (session != NULL))) {
+    reply = g_strdup_printf ("{\"event\":\"auth_result\",\"success\":true,\"session\":\"%s\"}", session);
+  } else {
+    reply = g_strdup ("{\"event\":\"auth_result\",\"success\":false}");
+  }
+
+  _ws_client_send_frame (client, reply, &binary_frame);
+
+  if (!client->authenticated) {
+    soup_websocket_connection_close (client->connection,
+        SOUP_WEBSOCKET_CLOSE_POLICY_VIOLATION, "Pairing failed");
+  }
+
+  if (binary_frame)
+    g_bytes_unref (binary_frame);
+
+  g_free (reply);
+  g_free (session);
+}
+
+static GHashTable *
+_ws_parse_query (SoupServerMessage *msg)
+{
+  const gchar *query;
+
+  if (!(query = g_uri_get_query (soup_server_message_get_uri (msg))))
+    return NULL;
+
+  return g_uri_parse_params (query, -1, "&", G_URI_PARAMS_NONE, NULL);
+}
+
+static gboolean
+_ws_parse_last_seq (GHashTable *params, guint64 *last_seq)
+{
+  const gchar *seq_str;
+  gchar *endptr = NULL;
+
+  if (!params || !(seq_str = g_hash_table_lookup (params, "seq")))
+    return FALSE;
+
+  *last_seq = g_ascii_strtoull (seq_str, &endptr, 10);
+
+  return (endptr != seq_str && *endptr == '\0');
+}
+
+static gboolean
+_ws_client_drained_cb (GSocket *socket, GIOCondition condition, ClapperControlHubWsClient *client)
+{
+  GST_LOG_OBJECT (client->hub, "WebSocket client %p drained %" G_GSIZE_FORMAT " bytes",
+      client->connection, client->queued_bytes);
+
+  g_clear_pointer (&client->drain_source, g_source_unref);
+  _ws_client_clear_sources (client);
+
+  client->queued_bytes = 0;
+
+  if (client->needs_snapshot) {
+    GST_DEBUG_OBJECT (client->hub, "WebSocket client %p caught up", client->connection);
+
+    /* Keep flag set while sending, so pending events
+     * flushed before snapshot are not sent to this client */
+    if (soup_websocket_connection_get_state (client->connection) == SOUP_WEBSOCKET_STATE_OPEN)
+      _ws_client_send_snapshot (client);
+
+    client->needs_snapshot = FALSE;
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Watches for client socket becoming writable. Priority is lower than
+ * libsoup output handling, which keeps writing its own queue while socket
+ * accepts data, so once this is dispatched all data sent so far was
+ * handed over to the kernel and nothing is waiting within libsoup.
+ */
+static void
+_ws_client_watch_drain (ClapperControlHubWsClient *client)
+{
+  client->drain_source = g_socket_create_source (client->socket, G_IO_OUT, NULL);
+  g_source_set_priority (client->drain_source, G_PRIORITY_LOW);
+  g_source_set_callback (client->drain_source,
+      (GSourceFunc) _ws_client_drained_cb, client, NULL);
+  g_source_attach (client->drain_source, client->hub->context);
+}
+
+static gboolean
+_ws_client_stalled_cb (ClapperControlHubWsClient *client)
+{
+  GST_WARNING_OBJECT (client->hub, "WebSocket client %p stalled, disconnecting",
+      client->connection);
+
+  g_clear_pointer (&client->stall_source, g_source_unref);
+
+  /* Connection will be removed from "closed" signal handler */
+  soup_websocket_connection_close (client->connection,
+      SOUP_WEBSOCKET_CLOSE_POLICY_VIOLATION, "Client too slow");
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called once client went past high-water mark */
+static void
+_ws_client_throttle (ClapperControlHubWsClient *client)
+{
+  ClapperControlHub *hub = client->hub;
+
+  GST_INFO_OBJECT (hub, "WebSocket client %p queue over limit (%" G_GSIZE_FORMAT
+      " bytes), dropping events until it catches up", client->connection, client->queued_bytes);
+
+  client->needs_snapshot = TRUE;
+
+  /* Usually already armed, unless limit was lowered meanwhile */
+  if (!client->drain_source)
+    _ws_client_watch_drain (client);
+
+  if (!client->stall_source && hub->client_stall_timeout > 0) {
+    client->stall_source = g_timeout_source_new_seconds (hub->client_stall_timeout);
+    g_source_set_callback (client->stall_source,
+        (GSourceFunc) _ws_client_stalled_cb, client, NULL);
+    g_source_attach (client->stall_source, hub->context);
+  }
+}
+
+static gboolean
+_ws_client_find_func (ClapperControlHubWsClient *client, SoupWebsocketConnection *connection)
+{
+  return (client->connection == connection);
+}
+
+static ClapperMediaItem *
+_ws_find_item (ClapperControlHub *hub, guint id)
+{
+  guint i;
+
+  for (i = 0; i < hub->items->len; ++i) {
+    ClapperMediaItem *item = (ClapperMediaItem *) g_ptr_array_index (hub->items, i);
+
+    if (id == clapper_media_item_get_id (item))
+      return item;
+  }
+
+  return NULL;
+}
+
+/* Performs single action, returns %TRUE if it was valid and applied */
+static gboolean
+_ws_handle_action (ClapperControlHub *hub, ClapperControlHubWsClient *client,
+    ClapperPlayer *player, const gchar *text)
+{
+  ClapperControlHubAction action;
+  gboolean success = TRUE;
+
   action = clapper_control_hub_actions_get_action (text);
 
   if (action == CLAPPER_CONTROL_HUB_ACTION_INVALID) {
     GST_WARNING_OBJECT (hub, "Ignoring WS message with invalid action text");
-    return;
+    return FALSE;
   }
 
-  player = clapper_reactable_get_player (CLAPPER_REACTABLE_CAST (hub));
-
-  if (G_UNLIKELY (player == NULL))
-    return;
-
   switch (action) {
     case CLAPPER_CONTROL_HUB_ACTION_TOGGLE_PLAY:
       switch (hub->state) {
@@ -75,6 +505,7 @@ _ws_message_cb (SoupWebsocketConnection *connection, gint type, GBytes *message,
           clapper_player_pause (player);
           break;
         default:
+          success = FALSE;
           break;
       }
       break;
@@ -89,142 +520,451 @@ _ws_message_cb (SoupWebsocketConnection *connection, gint type, GBytes *message,
       break;
     case CLAPPER_CONTROL_HUB_ACTION_SEEK:{
       gdouble position;
-      if (clapper_control_hub_actions_parse_seek (text, &position))
-        clapper_player_seek (player, position);
+      if ((success = clapper_control_hub_actions_parse_seek (text, &position))) {
+        if (client)
+          clapper_control_hub_scrub_seek (&client->scrub, player, position);
+        else
+          clapper_player_seek (player, position);
+      }
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_SET_SPEED:{
       gdouble speed;
-      if (clapper_control_hub_actions_parse_set_speed (text, &speed))
+      if ((success = clapper_control_hub_actions_parse_set_speed (text, &speed)))
         clapper_player_set_speed (player, speed);
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_SET_VOLUME:{
       gdouble volume;
-      if (clapper_control_hub_actions_parse_set_volume (text, &volume))
+      if ((success = clapper_control_hub_actions_parse_set_volume (text, &volume)))
         clapper_player_set_volume (player, volume);
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_SET_MUTE:{
       gboolean mute;
-      if (clapper_control_hub_actions_parse_set_mute (text, &mute))
+      if ((success = clapper_control_hub_actions_parse_set_mute (text, &mute)))
         clapper_player_set_mute (player, mute);
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_SET_PROGRESSION:{
       ClapperQueueProgressionMode mode;
-      if (clapper_control_hub_actions_parse_set_progression (text, &mode))
+      if ((success = clapper_control_hub_actions_parse_set_progression (text, &mode)))
         clapper_queue_set_progression_mode (clapper_player_get_queue (player), mode);
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_ADD:{
       const gchar *uri;
-      if (hub->queue_controllable && clapper_control_hub_actions_parse_add (text, &uri)) {
+      if ((success = (hub->queue_controllable && clapper_control_hub_actions_parse_add (text, &uri)))) {
         ClapperMediaItem *item = clapper_media_item_new (uri);
-        clapper_reactable_queue_append_sync (CLAPPER_REACTABLE_CAST (hub), item);
+        clapper_control_hub_queue_append_item (clapper_player_get_queue (player), item);
         gst_object_unref (item);
       }
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_INSERT:{
-      gchar *uri;
+      const gchar *uri;
+      gsize uri_len;
       guint after_id;
-      if (hub->queue_controllable && clapper_control_hub_actions_parse_insert (text, &uri, &after_id)) {
-        ClapperMediaItem *after_item = NULL;
-        guint i;
-        for (i = 0; i < hub->items->len; ++i) {
-          ClapperMediaItem *tmp_after_item = (ClapperMediaItem *) g_ptr_array_index (hub->items, i);
-          if (after_id == clapper_media_item_get_id (tmp_after_item)) {
-            after_item = tmp_after_item;
-            break;
-          }
-        }
-        if (after_item) {
-          ClapperMediaItem *item = clapper_media_item_new (uri);
-          clapper_reactable_queue_insert_sync (CLAPPER_REACTABLE_CAST (hub), item, after_item);
+      if ((success = (hub->queue_controllable
+          && clapper_control_hub_actions_parse_insert (text, &uri, &uri_len, &after_id)))) {
+        ClapperMediaItem *after_item = _ws_find_item (hub, after_id);
+        if ((success = (after_item != NULL))) {
+          gchar *uri_str = g_strndup (uri, uri_len);
+          ClapperMediaItem *item = clapper_media_item_new (uri_str);
+          clapper_control_hub_queue_insert_item (clapper_player_get_queue (player), item, after_item);
           gst_object_unref (item);
+          g_free (uri_str);
         }
-        g_free (uri);
       }
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_SELECT:{
       guint id;
-      if (hub->queue_controllable && clapper_control_hub_actions_parse_select (text, &id)) {
-        guint i;
-        for (i = 0; i < hub->items->len; ++i) {
-          ClapperMediaItem *item = (ClapperMediaItem *) g_ptr_array_index (hub->items, i);
-          if (id == clapper_media_item_get_id (item)) {
-            clapper_queue_select_item (clapper_player_get_queue (player), item);
-            break;
-          }
-        }
+      if ((success = (hub->queue_controllable && clapper_control_hub_actions_parse_select (text, &id)))) {
+        ClapperMediaItem *item = _ws_find_item (hub, id);
+        if ((success = (item != NULL)))
+          clapper_queue_select_item (clapper_player_get_queue (player), item);
       }
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_REMOVE:{
       guint id;
-      if (hub->queue_controllable && clapper_control_hub_actions_parse_remove (text, &id)) {
-        guint i;
-        for (i = 0; i < hub->items->len; ++i) {
-          ClapperMediaItem *item = (ClapperMediaItem *) g_ptr_array_index (hub->items, i);
-          if (id == clapper_media_item_get_id (item)) {
-            clapper_reactable_queue_remove_sync (CLAPPER_REACTABLE_CAST (hub), item);
-            break;
-          }
-        }
+      if ((success = (hub->queue_controllable && clapper_control_hub_actions_parse_remove (text, &id)))) {
+        ClapperMediaItem *item = _ws_find_item (hub, id);
+        if ((success = (item != NULL)))
+          clapper_control_hub_queue_remove_item (clapper_player_get_queue (player), item);
       }
       break;
     }
     case CLAPPER_CONTROL_HUB_ACTION_CLEAR:
-      if (hub->queue_controllable)
-        clapper_reactable_queue_clear_sync (CLAPPER_REACTABLE_CAST (hub));
+      if ((success = hub->queue_controllable))
+        clapper_control_hub_queue_clear (clapper_player_get_queue (player));
       break;
     default:
       g_assert_not_reached ();
       break;
   }
 
+  return success;
+}
+
+static inline gboolean
+_ws_request_id_is_valid (const gchar *id)
+{
+  guint i;
+
+  /* Request ID is echoed back as JSON string without escaping */
+  for (i = 0; id[i] != '\0'; ++i) {
+    if (!g_ascii_isalnum (id[i]) && id[i] != '-' && id[i] != '_')
+      return FALSE;
+  }
+
+  return (i > 0 && i <= MAX_REQUEST_ID_LENGTH);
+}
+
+/*
+ * Appends consecutive "add" actions starting at @actions into the queue
+ * in one go. Returns amount of actions handled (zero if first is not an
+ * "add" one). Results of handled actions are written into @results.
+ */
+static guint
+_ws_handle_add_actions (ClapperControlHub *hub, ClapperPlayer *player,
+    gchar **actions, GString *results)
+{
+  GPtrArray *items = NULL;
+  guint n_handled = 0;
+
+  for (; actions[n_handled] != NULL; ++n_handled) {
+    const gchar *uri;
+    gboolean success;
+
+    if (clapper_control_hub_actions_get_action (actions[n_handled]) != CLAPPER_CONTROL_HUB_ACTION_ADD)
+      break;
+
+    if ((success = (hub->queue_controllable
+        && clapper_control_hub_actions_parse_add (actions[n_handled], &uri)))) {
+      if (!items)
+        items = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_object_unref);
+
+      g_ptr_array_add (items, clapper_media_item_new (uri));
+    }
+
+    if (results)
+      g_string_append (results, (success) ? ",true" : ",false");
+  }
+
+  if (items) {
+    GST_DEBUG_OBJECT (hub, "Appending %u items from batch", items->len);
+
+    clapper_control_hub_queue_append_items (clapper_player_get_queue (player),
+        items, NULL, NULL, NULL);
+    g_ptr_array_unref (items);
+  }
+
+  return n_handled;
+}
+
+/*
+ * Handles "batch" frame, where first line is "batch" optionally followed
+ * by request ID and each next line is a single action. When ID is given,
+ * results of all actions are sent back to the requesting client.
+ */
+static void
+_ws_handle_batch (ClapperControlHub *hub, ClapperControlHubWsClient *client,
+    ClapperPlayer *player, const gchar *text)
+{
+  gchar **lines, **actions;
+  const gchar *id = NULL;
+  GString *results = NULL;
+  guint i, n_actions = 0;
+
+  /* Frame size is limited by libsoup, so splitting all lines is fine.
+   * Limiting split count would glue remaining lines into the last one. */
+  lines = g_strsplit (text, "\n", -1);
+
+  /* "batch" + whitespace = 6 */
+  if (g_strchomp (lines[0])[5] == ' ') {
+    id = lines[0] + 6;
+
+    if (!_ws_request_id_is_valid (id)) {
+      GST_WARNING_OBJECT (hub, "Ignoring WS batch with invalid request ID");
+      goto finish;
+    }
+  }
+
+  actions = lines + 1;
+
+  /* Skip empty lines (e.g. trailing newline) */
+  for (i = 0; actions[i] != NULL; ++i) {
+    if (*g_strchomp (actions[i]) == '\0') {
+      g_free (actions[i]);
+      continue;
+    }
+    actions[n_actions++] = actions[i];
+  }
+  actions[n_actions] = NULL;
+
+  if (n_actions > MAX_BATCH_ACTIONS) {
+    GST_WARNING_OBJECT (hub, "Ignoring WS batch with too many actions");
+    goto finish;
+  }
+
+  GST_DEBUG_OBJECT (hub, "Handling WS batch of %u actions", n_actions);
+
+  if (id)
+    results = g_string_new (NULL);
+
+  i = 0;
+  while (actions[i] != NULL) {
+    guint n_added;
+
+    if ((n_added = _ws_handle_add_actions (hub, player, actions + i, results)) > 0) {
+      i += n_added;
+    } else {
+      gboolean success = _ws_handle_action (hub, client, player, actions[i++]);
+
+      if (results)
+        g_string_append (results, (success) ? ",true" : ",false");
+    }
+  }
+
+  if (results && client
+      && soup_websocket_connection_get_state (client->connection) == SOUP_WEBSOCKET_STATE_OPEN) {
+    GBytes *binary_frame = NULL;
+    gchar *reply;
+
+    /* Skip leading comma */
+    reply = g_strdup_printf ("{\"event\":\"batch_result\",\"id\":\"%s\",\"results\":[%s]}",
+        id, (results->len > 0) ? results->str + 1 : "");
+    _ws_client_send_frame (client, reply, &binary_frame);
+
+    if (binary_frame)
+      g_bytes_unref (binary_frame);
+
+    g_free (reply);
+  }
+
+finish:
+  if (results)
+    g_string_free (results, TRUE);
+
+  g_strfreev (lines);
+}
+
+static void
+_ws_handle_message (ClapperControlHub *hub, SoupWebsocketConnection *connection, const gchar *text)
+{
+  ClapperPlayer *player = clapper_reactable_get_player (CLAPPER_REACTABLE_CAST (hub));
+  ClapperControlHubWsClient *client = NULL;
+  guint index;
+
+  if (G_UNLIKELY (player == NULL))
+    return;
+
+  if (g_ptr_array_find_with_equal_func (hub->ws_connections, connection,
+      (GEqualFunc) _ws_client_find_func, &index))
+    client = g_ptr_array_index (hub->ws_connections, index);
+
+  /* Pairing is done once per connection, so after
+   * that this is the only cost of it per message */
+  if (G_UNLIKELY (client == NULL || !client->authenticated)) {
+    if (client)
+      _ws_client_authenticate (client, text);
+    goto finish;
+  }
+
+  if (g_str_has_prefix (text, "batch") && (text[5] == '\n' || text[5] == ' '))
+    _ws_handle_batch (hub, client, player, text);
+  else
+    _ws_handle_action (hub, client, player, text);
+
+finish:
   gst_object_unref (player);
 }
 
+static void
+_ws_message_cb (SoupWebsocketConnection *connection, gint type, GBytes *message, ClapperControlHub *hub)
+{
+  if (type == SOUP_WEBSOCKET_DATA_BINARY) {
+    const guint8 *data;
+    gchar *text;
+    gsize size;
+
+    if (g_strcmp0 (soup_websocket_connection_get_protocol (connection),
+        CLAPPER_CONTROL_HUB_WS_PROTOCOL_MSGPACK) != 0) {
+      GST_WARNING_OBJECT (hub, "Received binary WS message without binary protocol!");
+      return;
+    }
+
+    data = g_bytes_get_data (message, &size);
+
+    if (!(text = clapper_control_hub_msgpack_to_action (data, size))) {
+      GST_WARNING_OBJECT (hub, "Ignoring WS message with invalid binary data");
+      return;
+    }
+
+    _ws_handle_message (hub, connection, text);
+    g_free (text);
+  } else {
+    const gchar *text = g_bytes_get_data (message, NULL);
+
+    if (G_UNLIKELY (text == NULL || *text == '\0')) {
+      GST_WARNING_OBJECT (hub, "Received WS message without any text!");
+      return;
+    }
+
+    _ws_handle_message (hub, connection, text);
+  }
+}
+
 static void
 _ws_connection_closed_cb (SoupWebsocketConnection *connection, ClapperControlHub *hub)
 {
+  guint index;
+
   GST_INFO_OBJECT (hub, "WebSocket connection closed: %p", connection);
-  g_ptr_array_remove (hub->ws_connections, connection);
+
+  if (g_ptr_array_find_with_equal_func (hub->ws_connections, connection,
+      (GEqualFunc) _ws_client_find_func, &index))
+    g_ptr_array_remove_index (hub->ws_connections, index);
+}
+
+/*
+ * Closes connections of all clients, e.g. when hub stops serving
+ * while shared server keeps running for other players.
+ */
+void
+clapper_control_hub_ws_close_all (ClapperControlHub *hub)
+{
+  guint i;
+
+  for (i = 0; i < hub->ws_connections->len; ++i) {
+    ClapperControlHubWsClient *client = g_ptr_array_index (hub->ws_connections, i);
+
+    g_signal_handlers_disconnect_by_data (client->connection, hub);
+
+    if (soup_websocket_connection_get_state (client->connection) == SOUP_WEBSOCKET_STATE_OPEN)
+      soup_websocket_connection_close (client->connection, SOUP_WEBSOCKET_CLOSE_GOING_AWAY, NULL);
+  }
+
+  if (hub->ws_connections->len > 0)
+    g_ptr_array_remove_range (hub->ws_connections, 0, hub->ws_connections->len);
 }
 
 void
 clapper_control_hub_ws_connection_cb (SoupServer *server, SoupServerMessage *msg,
     const gchar *path, SoupWebsocketConnection *connection, ClapperControlHub *hub)
 {
+  ClapperControlHubWsClient *client;
+
   GST_INFO_OBJECT (hub, "New WebSocket connection: %p", connection);
 
+  /* Snapshot will include all pending changes, so existing
+   * clients must receive them before new one is added */
+  clapper_control_hub_broadcast_flush (hub);
+
   g_signal_connect (connection, "message", G_CALLBACK (_ws_message_cb), hub);
   g_signal_connect (connection, "closed", G_CALLBACK (_ws_connection_closed_cb), hub);
-  g_ptr_array_add (hub->ws_connections, g_object_ref (connection));
+  client = _ws_client_new (hub, connection, soup_server_message_get_socket (msg),
+      soup_server_message_get_remote_host (msg));
+  g_ptr_array_add (hub->ws_connections, client);
 
   if (G_LIKELY (soup_websocket_connection_get_state (connection) == SOUP_WEBSOCKET_STATE_OPEN)) {
-    gchar *init_data = clapper_control_hub_json_build_default (hub, TRUE);
-    soup_websocket_connection_send_text (connection, init_data);
-    g_free (init_data);
+    GHashTable *params = _ws_parse_query (msg);
+    guint64 last_seq;
+
+    /* Paired clients can resume their session by answering
+     * challenge with its key instead of pairing token */
+    if (!client->authenticated) {
+      const gchar *session = (params) ? g_hash_table_lookup (params, "session") : NULL;
+
+      if (!clapper_control_hub_auth_allow_attempt (hub, client->remote_host)) {
+        soup_websocket_connection_close (connection,
+            SOUP_WEBSOCKET_CLOSE_POLICY_VIOLATION, "Too many attempts");
+        goto finish;
+      }
+
+      if (session && clapper_control_hub_auth_has_session (hub, session))
+        client->session = g_strdup (session);
+
+      _ws_client_send_challenge (client);
+
+      if (soup_websocket_connection_get_state (connection) != SOUP_WEBSOCKET_STATE_OPEN)
+        goto finish;
+    }
+
+    /* Reconnecting clients send sequence number of the last
+     * event they received and get only these they missed */
+    if (!_ws_parse_last_seq (params, &last_seq) || !_ws_client_resume (client, last_seq))
+      _ws_client_send_snapshot (client);
+
+finish:
+    if (params)
+      g_hash_table_unref (params);
+  }
+}
+
+/*
+ * Applies changed pairing token to connected clients.
+ * They all have to pair again (or are let in when disabled).
+ */
+void
+clapper_control_hub_ws_reset_auth (ClapperControlHub *hub)
+{
+  guint i;
+
+  for (i = 0; i < hub->ws_connections->len; ++i) {
+    ClapperControlHubWsClient *client = g_ptr_array_index (hub->ws_connections, i);
+
+    g_clear_pointer (&client->nonce, g_free);
+    g_clear_pointer (&client->session, g_free);
+
+    if (!(client->authenticated = (hub->pairing_token == NULL))
+        && soup_websocket_connection_get_state (client->connection) == SOUP_WEBSOCKET_STATE_OPEN)
+      _ws_client_send_challenge (client);
   }
 }
 
+/*
+ * Sends event to all clients. Each event frame gets
+ * the next sequence number and is stored in history.
+ */
 void
 clapper_control_hub_ws_send (ClapperControlHub *hub, const gchar *text)
 {
+  GBytes *binary_frame = NULL;
+  gchar *frame;
   guint i;
 
-  GST_LOG_OBJECT (hub, "Sending WS message to clients: \"%s\"", text);
+  g_return_if_fail (text[0] == '{');
+
+  frame = g_strdup_printf ("{\"seq\":%" G_GUINT64_FORMAT ",%s", ++hub->seq, text + 1);
+
+  _ws_history_push (hub, frame);
+
+  GST_LOG_OBJECT (hub, "Sending WS message to clients: \"%s\"", frame);
 
   for (i = 0; i < hub->ws_connections->len; ++i) {
-    SoupWebsocketConnection *connection = g_ptr_array_index (hub->ws_connections, i);
+    ClapperControlHubWsClient *client = g_ptr_array_index (hub->ws_connections, i);
 
-    if (soup_websocket_connection_get_state (connection) != SOUP_WEBSOCKET_STATE_OPEN)
+    if (soup_websocket_connection_get_state (client->connection) != SOUP_WEBSOCKET_STATE_OPEN)
       continue;
 
-    soup_websocket_connection_send_text (connection, text);
+    /* Snapshot sent after client catches up will carry current state */
+    if (client->needs_snapshot)
+      continue;
+
+    if (hub->client_queue_limit > 0
+        && client->queued_bytes > hub->client_queue_limit) {
+      _ws_client_throttle (client);
+      continue;
+    }
+
+    _ws_client_send_frame (client, frame, &binary_frame);
   }
+
+  if (binary_frame)
+    g_bytes_unref (binary_frame);
+
+  clapper_control_hub_sse_send (hub, hub->seq, frame);
 }
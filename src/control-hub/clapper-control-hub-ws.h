@@ -25,8 +25,29 @@
 
 G_BEGIN_DECLS
 
+#define CLAPPER_CONTROL_HUB_WS_PROTOCOL_JSON "clapper-json"
+#define CLAPPER_CONTROL_HUB_WS_PROTOCOL_MSGPACK "clapper-msgpack"
+
+typedef struct _ClapperControlHubWsClient ClapperControlHubWsClient;
+
 void clapper_control_hub_ws_debug_init (void);
 
+void clapper_control_hub_ws_client_free (ClapperControlHubWsClient *client);
+
+void clapper_control_hub_ws_history_init (ClapperControlHub *hub);
+
+void clapper_control_hub_ws_history_reset (ClapperControlHub *hub);
+
+G_GNUC_INTERNAL
+gboolean clapper_control_hub_ws_history_can_resume (ClapperControlHub *hub, guint64 last_seq);
+
+G_GNUC_INTERNAL
+const gchar * clapper_control_hub_ws_history_get (ClapperControlHub *hub, guint64 seq);
+
+void clapper_control_hub_ws_close_all (ClapperControlHub *hub);
+
+void clapper_control_hub_ws_reset_auth (ClapperControlHub *hub);
+
 void clapper_control_hub_ws_connection_cb (SoupServer *server, SoupServerMessage *msg, const gchar *path, SoupWebsocketConnection *connection, ClapperControlHub *hub);
 
 void clapper_control_hub_ws_send (ClapperControlHub *hub, const gchar *text);
@@ -27,13 +27,36 @@
 #include <libpeas.h>
 
 #include "clapper-control-hub.h"
+#include "clapper-control-hub-auth.h"
+#include "clapper-control-hub-broadcast.h"
+#include "clapper-control-hub-http.h"
+#include "clapper-control-hub-import.h"
 #include "clapper-control-hub-json.h"
+#include "clapper-control-hub-queue.h"
+#include "clapper-control-hub-scrub.h"
+#include "clapper-control-hub-sse.h"
 #include "clapper-control-hub-ws.h"
 
 #define DEFAULT_ACTIVE FALSE
 #define DEFAULT_QUEUE_CONTROLLABLE FALSE
+#define DEFAULT_BROADCAST_INTERVAL 0
+#define DEFAULT_CLIENT_QUEUE_LIMIT (256 * 1024)
+#define DEFAULT_CLIENT_STALL_TIMEOUT 30
+#define DEFAULT_SNAPSHOT_WINDOW 0
+#define DEFAULT_SCRUB_INTERVAL 100
+#define DEFAULT_POSITION_RESYNC_INTERVAL 10
 
-#define WS_EVENT_SIZE 128
+#define QUEUE_PAGE_DEFAULT_LIMIT 100
+#define QUEUE_PAGE_MAX_LIMIT 1000
+
+/* Largest size of art image that can be requested */
+#define ART_MAX_SIZE 4096
+
+#define WS_EVENT_SIZE CLAPPER_CONTROL_HUB_JSON_EVENT_SIZE
+
+/* Difference in seconds between reported and interpolated
+ * position above which clients need to be notified */
+#define POSITION_DRIFT_THRESHOLD 0.5
 
 #define GST_CAT_DEFAULT clapper_control_hub_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
@@ -45,263 +68,301 @@ enum
   PROP_0,
   PROP_ACTIVE,
   PROP_QUEUE_CONTROLLABLE,
+  PROP_BROADCAST_INTERVAL,
+  PROP_CLIENT_QUEUE_LIMIT,
+  PROP_CLIENT_STALL_TIMEOUT,
+  PROP_SNAPSHOT_WINDOW,
+  PROP_SCRUB_INTERVAL,
+  PROP_POSITION_RESYNC_INTERVAL,
+  PROP_PAIRING_TOKEN,
   PROP_LAST
 };
 
 static GParamSpec *param_specs[PROP_LAST] = { NULL, };
 
+/* Unique within process, used in player route path */
+static gint _hub_index = 0;
+
 static void
 _clear_stored_queue (ClapperControlHub *self)
 {
   if (self->items->len > 0)
     g_ptr_array_remove_range (self->items, 0, self->items->len);
+  clapper_control_hub_json_invalidate_item (self, NULL);
 
   gst_clear_object (&self->played_item);
   self->played_index = CLAPPER_QUEUE_INVALID_POSITION;
 }
 
+static inline gboolean
+_has_clients (ClapperControlHub *self)
+{
+  return (self->running
+      && (self->ws_connections->len > 0 || self->sse_clients->len > 0));
+}
+
 static void
-clapper_control_hub_state_changed (ClapperReactable *reactable, ClapperPlayerState state)
+_clear_responses (ClapperControlHub *self)
+{
+  guint i;
+
+  for (i = 0; i < CLAPPER_CONTROL_HUB_HTTP_N_ENCODINGS; ++i)
+    g_clear_pointer (&self->responses[i], g_bytes_unref);
+}
+
+/* Called whenever anything included in state snapshot changes */
+static void
+_invalidate_state (ClapperControlHub *self)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
+  self->state_version++;
+
+  g_clear_pointer (&self->snapshot, g_free);
+  g_clear_pointer (&self->snapshot_binary, g_bytes_unref);
+  _clear_responses (self);
+
+  /* Clients are not notified about this change, so
+   * they will not be able to resume from history */
+  if (!_has_clients (self))
+    clapper_control_hub_ws_history_reset (self);
+}
 
+/*
+ * Sets position from which clients interpolate. Position event
+ * carries speed too, so this is also needed when speed changes.
+ */
+static void
+_anchor_position (ClapperControlHub *self, gdouble position, gint64 time)
+{
+  self->position = position;
+  self->position_time = time;
+  _invalidate_state (self);
+
+  if (_has_clients (self))
+    clapper_control_hub_broadcast_property (self, CLAPPER_CONTROL_HUB_PROPERTY_POSITION);
+}
+
+static void
+_handle_state_changed (ClapperControlHub *self, ClapperPlayerState state, gint64 now)
+{
   GST_DEBUG_OBJECT (self, "Playback state changed to: %u", state);
   self->state = state;
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
-    gchar data[WS_EVENT_SIZE];
-    clapper_control_hub_json_fill_state_changed_message (data, self->state);
-    clapper_control_hub_ws_send (self, data);
-  }
+  if (_has_clients (self))
+    clapper_control_hub_broadcast_property (self, CLAPPER_CONTROL_HUB_PROPERTY_STATE);
+
+  /* Clients start or stop interpolating now, so give them exact position
+   * from which they should continue. Position does not advance while not
+   * playing, so when playback starts, last reported one is current now. */
+  if (state == CLAPPER_PLAYER_STATE_PLAYING)
+    self->reported_time = now;
+
+  _anchor_position (self, self->reported_position, self->reported_time);
+}
+
+/* Position at given time, as calculated by clients */
+static gdouble
+_get_interpolated_position (ClapperControlHub *self, gint64 now)
+{
+  if (self->state != CLAPPER_PLAYER_STATE_PLAYING)
+    return self->position;
+
+  return self->position + self->speed * (now - self->position_time) / G_USEC_PER_SEC;
 }
 
 static void
-clapper_control_hub_position_changed (ClapperReactable *reactable, gdouble position)
+_handle_position_changed (ClapperControlHub *self, gdouble position, gint64 now)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
+  gboolean resync;
 
-  /* Limit to seconds */
-  if ((gint) self->position == (gint) position)
-    return;
+  self->reported_position = position;
+  self->reported_time = now;
 
-  GST_LOG_OBJECT (self, "Position changed to: %.3lf", position);
-  self->position = position;
+  /* Clients interpolate position on their own, so only send it
+   * on discontinuity (e.g. seek) or periodically to avoid drift */
+  resync = (self->position_resync_interval > 0
+      && now - self->position_time >= (gint64) self->position_resync_interval * G_USEC_PER_SEC);
 
-  if (self->running && self->ws_connections->len > 0) {
-    gchar data[WS_EVENT_SIZE];
-    clapper_control_hub_json_fill_position_changed_message (data, self->position);
-    clapper_control_hub_ws_send (self, data);
-  }
+  if (!resync && ABS (_get_interpolated_position (self, now) - position) < POSITION_DRIFT_THRESHOLD)
+    return;
+
+  GST_LOG_OBJECT (self, "Position changed to: %.3lf%s", position, (resync) ? " (resync)" : "");
+  _anchor_position (self, position, now);
 }
 
 static void
-clapper_control_hub_speed_changed (ClapperReactable *reactable, gdouble speed)
+_handle_speed_changed (ClapperControlHub *self, gdouble speed, gint64 now)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
+  gdouble position;
 
   GST_LOG_OBJECT (self, "Speed changed to: %.2lf", speed);
+
+  /* Interpolate up to now with previous speed */
+  position = _get_interpolated_position (self, now);
   self->speed = speed;
 
-  if (self->running && self->ws_connections->len > 0) {
-    gchar data[WS_EVENT_SIZE];
-    clapper_control_hub_json_fill_speed_changed_message (data, self->speed);
-    clapper_control_hub_ws_send (self, data);
-  }
+  if (_has_clients (self))
+    clapper_control_hub_broadcast_property (self, CLAPPER_CONTROL_HUB_PROPERTY_SPEED);
+
+  _anchor_position (self, position, now);
 }
 
 static void
-clapper_control_hub_volume_changed (ClapperReactable *reactable, gdouble volume)
+_handle_volume_changed (ClapperControlHub *self, gdouble volume)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
-
   GST_LOG_OBJECT (self, "Volume changed to: %.2lf", volume);
   self->volume = volume;
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
-    gchar data[WS_EVENT_SIZE];
-    clapper_control_hub_json_fill_volume_changed_message (data, self->volume);
-    clapper_control_hub_ws_send (self, data);
-  }
+  if (_has_clients (self))
+    clapper_control_hub_broadcast_property (self, CLAPPER_CONTROL_HUB_PROPERTY_VOLUME);
 }
 
 static void
-clapper_control_hub_mute_changed (ClapperReactable *reactable, gboolean mute)
+_handle_mute_changed (ClapperControlHub *self, gboolean mute)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
-
   GST_LOG_OBJECT (self, "Mute changed to: %s", (mute) ? "enabled" : "disabled");
   self->mute = mute;
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
-    gchar data[WS_EVENT_SIZE];
-    clapper_control_hub_json_fill_mute_changed_message (data, self->mute);
-    clapper_control_hub_ws_send (self, data);
-  }
+  if (_has_clients (self))
+    clapper_control_hub_broadcast_property (self, CLAPPER_CONTROL_HUB_PROPERTY_MUTE);
 }
 
 static void
-clapper_control_hub_played_item_changed (ClapperReactable *reactable, ClapperMediaItem *item)
+_handle_played_item_changed (ClapperControlHub *self, ClapperMediaItem *item)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
-
   GST_DEBUG_OBJECT (self, "Played item changed to: %" GST_PTR_FORMAT, item);
 
   gst_object_replace ((GstObject **) &self->played_item, GST_OBJECT_CAST (item));
   if (!g_ptr_array_find (self->items, self->played_item, &self->played_index))
     self->played_index = CLAPPER_QUEUE_INVALID_POSITION;
 
-  if (self->running && self->ws_connections->len > 0) {
-    gchar data[WS_EVENT_SIZE];
-    clapper_control_hub_json_fill_played_index_changed_message (data, self->played_index);
-    clapper_control_hub_ws_send (self, data);
-  }
+  _invalidate_state (self);
+
+  if (_has_clients (self))
+    clapper_control_hub_broadcast_property (self, CLAPPER_CONTROL_HUB_PROPERTY_PLAYED_INDEX);
 }
 
-static void
-clapper_control_hub_item_updated (ClapperReactable *reactable, ClapperMediaItem *item, ClapperReactableItemUpdatedFlags flags)
+/* Gets image that represents item, or preview image if there is none */
+static GstSample *
+_get_item_art_sample (ClapperMediaItem *item)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
+  GstTagList *tags = clapper_media_item_get_tags (item);
+  GstSample *sample = NULL;
+
+  if (!gst_tag_list_get_sample (tags, GST_TAG_IMAGE, &sample))
+    gst_tag_list_get_sample (tags, GST_TAG_PREVIEW_IMAGE, &sample);
+  gst_tag_list_unref (tags);
+
+  return sample;
+}
 
+static void
+_handle_item_updated (ClapperControlHub *self, ClapperMediaItem *item, ClapperReactableItemUpdatedFlags flags)
+{
   /* Ignore updates with flags this enhancer does not care about */
   flags &= ~(CLAPPER_REACTABLE_ITEM_UPDATED_REDIRECT_URI | CLAPPER_REACTABLE_ITEM_UPDATED_CACHE_LOCATION);
   if (flags == 0)
     return;
 
-  if (self->running && self->ws_connections->len > 0) {
+  if (flags & CLAPPER_REACTABLE_ITEM_UPDATED_TITLE)
+    clapper_control_hub_json_invalidate_item (self, item);
+  if (flags & CLAPPER_REACTABLE_ITEM_UPDATED_TAGS) {
+    GstSample *sample = _get_item_art_sample (item);
+
+    clapper_control_hub_art_invalidate (self->art_cache, clapper_media_item_get_id (item), sample);
+
+    if (sample)
+      gst_sample_unref (sample);
+  }
+
+  _invalidate_state (self);
+
+  if (_has_clients (self)) {
     gchar data[WS_EVENT_SIZE];
     clapper_control_hub_json_fill_item_updated_message (data, clapper_media_item_get_id (item), flags);
-    clapper_control_hub_ws_send (self, data);
+    clapper_control_hub_broadcast_event (self, data);
   }
 }
 
 static void
-clapper_control_hub_queue_item_added (ClapperReactable *reactable, ClapperMediaItem *item, guint index)
+_handle_queue_item_added (ClapperControlHub *self, ClapperMediaItem *item, guint index)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
-
   GST_DEBUG_OBJECT (self, "Queue %" GST_PTR_FORMAT " added, position: %u", item, index);
   g_ptr_array_insert (self->items, index, gst_object_ref (item));
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
+  if (_has_clients (self)) {
     gchar data[WS_EVENT_SIZE];
     clapper_control_hub_json_fill_item_added_message (data, clapper_media_item_get_id (item), index);
-    clapper_control_hub_ws_send (self, data);
+    clapper_control_hub_broadcast_event (self, data);
   }
 }
 
 static void
-clapper_control_hub_queue_item_removed (ClapperReactable *reactable, ClapperMediaItem *item, guint index)
+_handle_queue_item_removed (ClapperControlHub *self, ClapperMediaItem *item, guint index)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
-
   GST_DEBUG_OBJECT (self, "Queue %" GST_PTR_FORMAT " removed, position: %u", item, index);
 
   if (item == self->played_item) {
     gst_clear_object (&self->played_item);
     self->played_index = CLAPPER_QUEUE_INVALID_POSITION;
   }
+  clapper_control_hub_json_invalidate_item (self, item);
   g_ptr_array_remove_index (self->items, index);
+  clapper_control_hub_art_invalidate (self->art_cache, clapper_media_item_get_id (item), NULL);
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
+  if (_has_clients (self)) {
     gchar data[WS_EVENT_SIZE];
     clapper_control_hub_json_fill_item_removed_message (data, clapper_media_item_get_id (item), index);
-    clapper_control_hub_ws_send (self, data);
+    clapper_control_hub_broadcast_event (self, data);
   }
 }
 
 static void
-clapper_control_hub_queue_item_repositioned (ClapperReactable *reactable, guint before, guint after)
+_handle_queue_item_repositioned (ClapperControlHub *self, guint before, guint after)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
   ClapperMediaItem *item;
 
   GST_DEBUG_OBJECT (self, "Queue item repositioned: %u -> %u", before, after);
 
   item = (ClapperMediaItem *) g_ptr_array_steal_index (self->items, before);
   g_ptr_array_insert (self->items, after, item);
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
+  if (_has_clients (self)) {
     gchar data[WS_EVENT_SIZE];
     clapper_control_hub_json_fill_item_repositioned_message (data, before, after);
-    clapper_control_hub_ws_send (self, data);
+    clapper_control_hub_broadcast_event (self, data);
   }
 }
 
 static void
-clapper_control_hub_queue_cleared (ClapperReactable *reactable)
+_handle_queue_cleared (ClapperControlHub *self)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
-
   GST_DEBUG_OBJECT (self, "Queue cleared");
   _clear_stored_queue (self);
+  clapper_control_hub_art_clear (self->art_cache);
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
+  if (_has_clients (self)) {
     gchar data[WS_EVENT_SIZE];
     clapper_control_hub_json_fill_queue_cleared_message (data);
-    clapper_control_hub_ws_send (self, data);
+    clapper_control_hub_broadcast_event (self, data);
   }
 }
 
 static void
-clapper_control_hub_queue_progression_changed (ClapperReactable *reactable, ClapperQueueProgressionMode mode)
+_handle_queue_progression_changed (ClapperControlHub *self, ClapperQueueProgressionMode mode)
 {
-  ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (reactable);
-
   GST_DEBUG_OBJECT (self, "Queue progression changed to: %u", mode);
   self->progression = mode;
+  _invalidate_state (self);
 
-  if (self->running && self->ws_connections->len > 0) {
-    gchar data[WS_EVENT_SIZE];
-    clapper_control_hub_json_fill_progression_changed_message (data, self->progression);
-    clapper_control_hub_ws_send (self, data);
-  }
-}
-
-static void
-clapper_control_hub_reactable_iface_init (ClapperReactableInterface *iface)
-{
-  iface->state_changed = clapper_control_hub_state_changed;
-  iface->position_changed = clapper_control_hub_position_changed;
-  iface->speed_changed = clapper_control_hub_speed_changed;
-  iface->volume_changed = clapper_control_hub_volume_changed;
-  iface->mute_changed = clapper_control_hub_mute_changed;
-  iface->played_item_changed = clapper_control_hub_played_item_changed;
-  iface->item_updated = clapper_control_hub_item_updated;
-  iface->queue_item_added = clapper_control_hub_queue_item_added;
-  iface->queue_item_removed = clapper_control_hub_queue_item_removed;
-  iface->queue_item_repositioned = clapper_control_hub_queue_item_repositioned;
-  iface->queue_cleared = clapper_control_hub_queue_cleared;
-  iface->queue_progression_changed = clapper_control_hub_queue_progression_changed;
-}
-
-#define parent_class clapper_control_hub_parent_class
-G_DEFINE_TYPE_WITH_CODE (ClapperControlHub, clapper_control_hub, GST_TYPE_OBJECT,
-    G_IMPLEMENT_INTERFACE (CLAPPER_TYPE_REACTABLE, clapper_control_hub_reactable_iface_init));
-
-static inline gint
-_find_current_port (ClapperControlHub *self)
-{
-  GSList *uris_list, *list;
-  gint found_port = 0;
-
-  uris_list = soup_server_get_uris (self->server);
-
-  for (list = uris_list; list != NULL; list = g_slist_next (list)) {
-    GUri *uri = list->data;
-    gint current_port = g_uri_get_port (uri);
-
-    if (current_port > 0) {
-      found_port = current_port;
-      break;
-    }
-  }
-
-  g_slist_free_full (uris_list, (GDestroyNotify) g_uri_unref);
-
-  if (G_UNLIKELY (found_port == 0))
-    GST_ERROR_OBJECT (self, "Could not determine server current port");
-
-  return found_port;
+  if (_has_clients (self))
+    clapper_control_hub_broadcast_property (self, CLAPPER_CONTROL_HUB_PROPERTY_PROGRESSION);
 }
 
 static ClapperMediaItem *
@@ -320,17 +381,23 @@ _get_item_by_id (ClapperControlHub *self, guint id)
 }
 
 static gboolean
-_query_parse_item_id (GHashTable *query, guint *id)
+_query_parse_uint (GHashTable *query, const gchar *key, guint *value)
 {
-  const char *id_str;
+  const char *val_str;
   gchar *endptr = NULL;
+  guint64 val;
+
+  if (!query || !(val_str = g_hash_table_lookup (query, key)))
+    return FALSE;
+
+  val = g_ascii_strtoull (val_str, &endptr, 10);
 
-  if (!query || !(id_str = g_hash_table_lookup (query, "id")))
+  if (!endptr || *endptr != '\0' || endptr == val_str || val > G_MAXUINT)
     return FALSE;
 
-  *id = (guint) g_ascii_strtoull (id_str, &endptr, 10);
+  *value = (guint) val;
 
-  return (endptr && *endptr == '\0');
+  return TRUE;
 }
 
 static gboolean
@@ -353,7 +420,7 @@ _item_info_request_cb (SoupServer *server, SoupServerMessage *msg,
   guint id;
   gboolean with_timeline;
 
-  if (!_query_parse_item_id (query, &id)) {
+  if (!_query_parse_uint (query, "id", &id)) {
     soup_server_message_set_status (msg, SOUP_STATUS_BAD_REQUEST, NULL);
     return;
   }
@@ -369,9 +436,7 @@ _item_info_request_cb (SoupServer *server, SoupServerMessage *msg,
     return;
   }
 
-  soup_server_message_set_status (msg, SOUP_STATUS_OK, NULL);
-  soup_server_message_set_response (msg, "application/json",
-      SOUP_MEMORY_TAKE, data, strlen (data));
+  clapper_control_hub_http_set_response_take (msg, "application/json", data);
 }
 
 static void
@@ -383,7 +448,7 @@ _item_tags_request_cb (SoupServer *server, SoupServerMessage *msg,
   gchar *data;
   guint id;
 
-  if (!_query_parse_item_id (query, &id)) {
+  if (!_query_parse_uint (query, "id", &id)) {
     soup_server_message_set_status (msg, SOUP_STATUS_BAD_REQUEST, NULL);
     return;
   }
@@ -401,68 +466,199 @@ _item_tags_request_cb (SoupServer *server, SoupServerMessage *msg,
     return;
   }
 
-  soup_server_message_set_status (msg, SOUP_STATUS_OK, NULL);
-  soup_server_message_set_response (msg, "application/octet-stream",
-      SOUP_MEMORY_TAKE, data, strlen (data));
+  clapper_control_hub_http_set_response_take (msg, "text/plain; charset=utf-8", data);
 }
 
 static void
-_default_request_cb (SoupServer *server, SoupServerMessage *msg,
+_item_art_request_cb (SoupServer *server, SoupServerMessage *msg,
+    const gchar *path, GHashTable *query, ClapperControlHub *self)
+{
+  ClapperMediaItem *item;
+  GstSample *sample;
+  guint id, size = 0;
+
+  if (!_query_parse_uint (query, "id", &id)
+      || (g_hash_table_contains (query, "size")
+      && (!_query_parse_uint (query, "size", &size) || size > ART_MAX_SIZE))) {
+    soup_server_message_set_status (msg, SOUP_STATUS_BAD_REQUEST, NULL);
+    return;
+  }
+  if (!(item = _get_item_by_id (self, id))) {
+    soup_server_message_set_status (msg, SOUP_STATUS_NOT_FOUND, NULL);
+    return;
+  }
+
+  if (!(sample = _get_item_art_sample (item))) {
+    soup_server_message_set_status (msg, SOUP_STATUS_NOT_FOUND, NULL);
+    return;
+  }
+
+  clapper_control_hub_art_serve (self->art_cache, msg, id, sample, size);
+  gst_sample_unref (sample);
+}
+
+/* Checks "Authorization: Clapper <credentials>" header of requests
+ * that alter player, signed with key of session paired over WebSocket */
+static gboolean
+_request_is_authorized (ClapperControlHub *self, SoupServerMessage *msg)
+{
+  const gchar *auth;
+
+  if (self->pairing_token == NULL)
+    return TRUE;
+
+  auth = soup_message_headers_get_one (
+      soup_server_message_get_request_headers (msg), "Authorization");
+
+  /* "Clapper" + whitespace = 8 */
+  return (auth && g_ascii_strncasecmp (auth, "Clapper ", 8) == 0
+      && clapper_control_hub_auth_check_request (self,
+          soup_server_message_get_remote_host (msg),
+          soup_server_message_get_method (msg),
+          g_uri_get_path (soup_server_message_get_uri (msg)), auth + 8));
+}
+
+static void
+_queue_request_cb (SoupServer *server, SoupServerMessage *msg,
     const gchar *path, GHashTable *query, ClapperControlHub *self)
 {
   gchar *data;
+  guint offset = 0, limit = QUEUE_PAGE_DEFAULT_LIMIT;
+
+  /* Bulk import of M3U or plain URI list */
+  if (soup_server_message_get_method (msg) == SOUP_METHOD_POST) {
+    if (!self->queue_controllable) {
+      soup_server_message_set_status (msg, SOUP_STATUS_FORBIDDEN, NULL);
+    } else if (!_request_is_authorized (self, msg)) {
+      soup_server_message_set_status (msg, SOUP_STATUS_UNAUTHORIZED, NULL);
+      soup_message_headers_replace (soup_server_message_get_response_headers (msg),
+          "WWW-Authenticate", "Clapper");
+    } else {
+      clapper_control_hub_import_request (self, msg);
+    }
+    return;
+  }
 
-  if (!(data = clapper_control_hub_json_build_default (self, FALSE))) {
+  if ((query && g_hash_table_contains (query, "offset")
+      && !_query_parse_uint (query, "offset", &offset))
+      || (query && g_hash_table_contains (query, "limit")
+      && !_query_parse_uint (query, "limit", &limit))) {
+    soup_server_message_set_status (msg, SOUP_STATUS_BAD_REQUEST, NULL);
+    return;
+  }
+
+  limit = MIN (limit, QUEUE_PAGE_MAX_LIMIT);
+
+  if (!(data = clapper_control_hub_json_build_queue (self, offset, limit))) {
     soup_server_message_set_status (msg, SOUP_STATUS_SERVICE_UNAVAILABLE, NULL);
     return;
   }
 
-  soup_server_message_set_status (msg, SOUP_STATUS_OK, NULL);
-  soup_server_message_set_response (msg, "application/json",
-      SOUP_MEMORY_TAKE, data, strlen (data));
+  clapper_control_hub_http_set_response_take (msg, "application/json", data);
 }
 
 static void
-_start_serving (ClapperControlHub *self)
+_default_request_cb (SoupServer *server, SoupServerMessage *msg,
+    const gchar *path, GHashTable *query, ClapperControlHub *self)
 {
-  GError *error = NULL;
+  ClapperControlHubHttpEncoding encoding;
+  SoupMessageHeaders *headers = soup_server_message_get_response_headers (msg);
+  gchar *data, etag[32], timestamp[32];
 
-  if (self->running)
-    return;
+  /* Make sure that returned sequence number matches state */
+  clapper_control_hub_broadcast_flush (self);
 
-  if ((self->running = soup_server_listen_all (self->server,
-      0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error))) {
-    gint port = _find_current_port (self);
-    GST_INFO_OBJECT (self, "Server started on port: %i", port);
+  /* Body is cached, so current server time is sent in header, also with 304 */
+  g_snprintf (timestamp, sizeof (timestamp), "%" G_GINT64_FORMAT, g_get_monotonic_time () / 1000);
+  soup_message_headers_replace (headers, "X-Clapper-Timestamp", timestamp);
 
-    if (G_LIKELY (port > 0)) {
-      /* Lazy create MDNS, so we do not spin another
-       * thread when enhancer is disabled */
-      if (!self->mdns) {
-        self->mdns = clapper_control_hub_mdns_new ();
-        gst_object_set_parent (GST_OBJECT_CAST (self->mdns), GST_OBJECT_CAST (self));
-      }
+  /* Weak, as the same state can be sent with different encodings */
+  g_snprintf (etag, sizeof (etag), "W/\"%" G_GUINT64_FORMAT "\"", self->state_version);
+  soup_message_headers_replace (headers, "ETag", etag);
 
-      clapper_control_hub_mdns_start (self->mdns, port);
+  /* Allows clients polling state to skip unchanged responses */
+  if (g_strcmp0 (soup_message_headers_get_one (soup_server_message_get_request_headers (msg),
+      "If-None-Match"), etag) == 0) {
+    soup_server_message_set_status (msg, SOUP_STATUS_NOT_MODIFIED, NULL);
+    return;
+  }
+
+  if (!self->responses[CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY]) {
+    if (!(data = clapper_control_hub_json_build_default (self, FALSE))) {
+      soup_server_message_set_status (msg, SOUP_STATUS_SERVICE_UNAVAILABLE, NULL);
+      return;
     }
-  } else if (error) {
-    ClapperPlayer *player;
+    self->responses[CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY] = g_bytes_new_take (data, strlen (data));
+  }
 
-    GST_ERROR_OBJECT (self, "Error starting server: %s",
-        GST_STR_NULL (error->message));
+  /* Encoded responses are cached until state changes too */
+  encoding = clapper_control_hub_http_get_encoding (msg,
+      g_bytes_get_size (self->responses[CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY]));
 
-    if ((player = clapper_reactable_get_player (CLAPPER_REACTABLE_CAST (self)))) {
-      GstStructure *structure;
+  if (encoding != CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY && !self->responses[encoding]
+      && !(self->responses[encoding] = clapper_control_hub_http_compress (
+      self->responses[CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY], encoding)))
+    encoding = CLAPPER_CONTROL_HUB_HTTP_ENCODING_IDENTITY;
 
-      structure = gst_structure_new ("enhancer-error",
-          "error", G_TYPE_ERROR, error, NULL);
-      clapper_player_post_message (player,
-          gst_message_new_application (GST_OBJECT_CAST (self), structure),
-          CLAPPER_PLAYER_MESSAGE_DESTINATION_APPLICATION);
+  clapper_control_hub_http_set_response (msg, "application/json",
+      self->responses[encoding], encoding);
+}
 
-      gst_object_unref (player);
-    }
+/* Dispatches request within player route */
+static void
+_request_cb (SoupServer *server, SoupServerMessage *msg,
+    const gchar *path, GHashTable *query, ClapperControlHub *self)
+{
+  if (strcmp (path, "/art") == 0)
+    _item_art_request_cb (server, msg, path, query, self);
+  else if (strcmp (path, "/item") == 0)
+    _item_info_request_cb (server, msg, path, query, self);
+  else if (strcmp (path, "/events") == 0)
+    clapper_control_hub_sse_request_cb (server, msg, path, query, self);
+  else if (strcmp (path, "/queue") == 0)
+    _queue_request_cb (server, msg, path, query, self);
+  else if (strcmp (path, "/tags") == 0)
+    _item_tags_request_cb (server, msg, path, query, self);
+  else
+    _default_request_cb (server, msg, path, query, self);
+}
+
+static void
+_post_error (const GError *error, ClapperControlHub *self)
+{
+  ClapperPlayer *player;
+
+  if ((player = clapper_reactable_get_player (CLAPPER_REACTABLE_CAST (self)))) {
+    GstStructure *structure;
+
+    structure = gst_structure_new ("enhancer-error",
+        "error", G_TYPE_ERROR, error, NULL);
+    clapper_player_post_message (player,
+        gst_message_new_application (GST_OBJECT_CAST (self), structure),
+        CLAPPER_PLAYER_MESSAGE_DESTINATION_APPLICATION);
 
+    gst_object_unref (player);
+  }
+}
+
+static void
+_start_serving (ClapperControlHub *self)
+{
+  GError *error = NULL;
+
+  if (self->running)
+    return;
+
+  if ((self->running = clapper_control_hub_server_publish (self->server, self->index,
+      (self->pairing_token != NULL), (SoupServerCallback) _request_cb,
+      (SoupServerWebsocketCallback) clapper_control_hub_ws_connection_cb,
+      (ClapperControlHubServerErrorFunc) _post_error, self, &error))) {
+    GST_INFO_OBJECT (self, "Serving on port: %i", self->server->port);
+  } else if (error) {
+    GST_ERROR_OBJECT (self, "Error starting server: %s",
+        GST_STR_NULL (error->message));
+
+    _post_error (error, self);
     g_error_free (error);
   }
 }
@@ -473,9 +669,11 @@ _stop_serving (ClapperControlHub *self)
   if (!self->running)
     return;
 
-  clapper_control_hub_mdns_stop (self->mdns);
-  soup_server_disconnect (self->server);
-  GST_INFO_OBJECT (self, "Server stopped");
+  clapper_control_hub_server_unpublish (self->server, self->index);
+  clapper_control_hub_broadcast_clear (self);
+  clapper_control_hub_ws_close_all (self);
+  clapper_control_hub_sse_clear (self);
+  GST_INFO_OBJECT (self, "Stopped serving");
   self->running = FALSE;
 }
 
@@ -489,27 +687,333 @@ clapper_control_hub_set_active (ClapperControlHub *self, gboolean active)
   (self->active) ? _start_serving (self) : _stop_serving (self);
 }
 
+static void
+clapper_control_hub_set_broadcast_interval (ClapperControlHub *self, guint interval)
+{
+  if (self->broadcast_interval == interval)
+    return; // No change
+
+  /* Send what was collected within previous interval */
+  if (self->broadcast_source)
+    clapper_control_hub_broadcast_flush (self);
+
+  self->broadcast_interval = interval;
+}
+
+static void
+clapper_control_hub_set_pairing_token (ClapperControlHub *self, gchar *token)
+{
+  gboolean auth_required;
+
+  /* Empty string is the default in settings */
+  if (token && *token == '\0')
+    g_clear_pointer (&token, g_free);
+
+  if (g_strcmp0 (self->pairing_token, token) == 0) {
+    g_free (token);
+    return; // No change
+  }
+
+  GST_OBJECT_LOCK (self);
+  g_free (self->pairing_token);
+  self->pairing_token = token;
+  GST_OBJECT_UNLOCK (self);
+
+  auth_required = (self->pairing_token != NULL);
+  GST_INFO_OBJECT (self, "Pairing %s", (auth_required) ? "required" : "disabled");
+
+  /* Sessions were created with previous token */
+  clapper_control_hub_auth_clear (self);
+
+  if (self->running) {
+    clapper_control_hub_server_set_auth_required (self->server, self->index, auth_required);
+    clapper_control_hub_ws_reset_auth (self);
+  }
+}
+
+typedef enum
+{
+  TASK_STATE_CHANGED,
+  TASK_POSITION_CHANGED,
+  TASK_SPEED_CHANGED,
+  TASK_VOLUME_CHANGED,
+  TASK_MUTE_CHANGED,
+  TASK_PLAYED_ITEM_CHANGED,
+  TASK_ITEM_UPDATED,
+  TASK_QUEUE_ITEM_ADDED,
+  TASK_QUEUE_ITEM_REMOVED,
+  TASK_QUEUE_ITEM_REPOSITIONED,
+  TASK_QUEUE_CLEARED,
+  TASK_QUEUE_PROGRESSION_CHANGED,
+  TASK_SET_ACTIVE,
+  TASK_SET_BROADCAST_INTERVAL,
+  TASK_SET_PAIRING_TOKEN,
+  TASK_INVALIDATE_STATE
+} ClapperControlHubTaskType;
+
+/*
+ * Hub state is only ever accessed from shared server thread.
+ * Reactable callbacks and property changes arrive in player thread,
+ * so they are passed as tasks. These do not hold a reference to hub,
+ * dispose waits for all of them in clapper_control_hub_server_invoke_sync().
+ */
+typedef struct
+{
+  ClapperControlHub *hub;
+  ClapperControlHubTaskType type;
+
+  ClapperMediaItem *item;
+  gdouble value;
+  guint arg1;
+  guint arg2;
+  gchar *text;
+  gint64 time;
+} ClapperControlHubTask;
+
+static void
+_task_free (ClapperControlHubTask *task)
+{
+  gst_clear_object (&task->item);
+  g_free (task->text);
+  g_free (task);
+}
+
+static gboolean
+_run_task_cb (ClapperControlHubTask *task)
+{
+  ClapperControlHub *self = task->hub;
+
+  switch (task->type) {
+    case TASK_STATE_CHANGED:
+      _handle_state_changed (self, task->arg1, task->time);
+      break;
+    case TASK_POSITION_CHANGED:
+      _handle_position_changed (self, task->value, task->time);
+      break;
+    case TASK_SPEED_CHANGED:
+      _handle_speed_changed (self, task->value, task->time);
+      break;
+    case TASK_VOLUME_CHANGED:
+      _handle_volume_changed (self, task->value);
+      break;
+    case TASK_MUTE_CHANGED:
+      _handle_mute_changed (self, task->arg1);
+      break;
+    case TASK_PLAYED_ITEM_CHANGED:
+      _handle_played_item_changed (self, task->item);
+      break;
+    case TASK_ITEM_UPDATED:
+      _handle_item_updated (self, task->item, task->arg1);
+      break;
+    case TASK_QUEUE_ITEM_ADDED:
+      _handle_queue_item_added (self, task->item, task->arg1);
+      break;
+    case TASK_QUEUE_ITEM_REMOVED:
+      _handle_queue_item_removed (self, task->item, task->arg1);
+      break;
+    case TASK_QUEUE_ITEM_REPOSITIONED:
+      _handle_queue_item_repositioned (self, task->arg1, task->arg2);
+      break;
+    case TASK_QUEUE_CLEARED:
+      _handle_queue_cleared (self);
+      break;
+    case TASK_QUEUE_PROGRESSION_CHANGED:
+      _handle_queue_progression_changed (self, task->arg1);
+      break;
+    case TASK_SET_ACTIVE:
+      clapper_control_hub_set_active (self, task->arg1);
+      break;
+    case TASK_SET_BROADCAST_INTERVAL:
+      clapper_control_hub_set_broadcast_interval (self, task->arg1);
+      break;
+    case TASK_SET_PAIRING_TOKEN:
+      clapper_control_hub_set_pairing_token (self, g_steal_pointer (&task->text));
+      break;
+    case TASK_INVALIDATE_STATE:
+      _invalidate_state (self);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_push_text_task (ClapperControlHub *self, ClapperControlHubTaskType type, const gchar *text)
+{
+  ClapperControlHubTask *task = g_new0 (ClapperControlHubTask, 1);
+
+  task->hub = self;
+  task->type = type;
+  task->text = g_strdup (text);
+  task->time = g_get_monotonic_time ();
+
+  g_main_context_invoke_full (self->context, G_PRIORITY_DEFAULT,
+      (GSourceFunc) _run_task_cb, task, (GDestroyNotify) _task_free);
+}
+
+static void
+_push_task (ClapperControlHub *self, ClapperControlHubTaskType type,
+    ClapperMediaItem *item, gdouble value, guint arg1, guint arg2)
+{
+  ClapperControlHubTask *task = g_new0 (ClapperControlHubTask, 1);
+
+  task->hub = self;
+  task->type = type;
+  if (item)
+    task->item = gst_object_ref (item);
+  task->value = value;
+  task->arg1 = arg1;
+  task->arg2 = arg2;
+  task->time = g_get_monotonic_time ();
+
+  g_main_context_invoke_full (self->context, G_PRIORITY_DEFAULT,
+      (GSourceFunc) _run_task_cb, task, (GDestroyNotify) _task_free);
+}
+
+static void
+clapper_control_hub_state_changed (ClapperReactable *reactable, ClapperPlayerState state)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_STATE_CHANGED, NULL, 0, state, 0);
+}
+
+static void
+clapper_control_hub_position_changed (ClapperReactable *reactable, gdouble position)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_POSITION_CHANGED, NULL, position, 0, 0);
+}
+
+static void
+clapper_control_hub_speed_changed (ClapperReactable *reactable, gdouble speed)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_SPEED_CHANGED, NULL, speed, 0, 0);
+}
+
+static void
+clapper_control_hub_volume_changed (ClapperReactable *reactable, gdouble volume)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_VOLUME_CHANGED, NULL, volume, 0, 0);
+}
+
+static void
+clapper_control_hub_mute_changed (ClapperReactable *reactable, gboolean mute)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_MUTE_CHANGED, NULL, 0, mute, 0);
+}
+
+static void
+clapper_control_hub_played_item_changed (ClapperReactable *reactable, ClapperMediaItem *item)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_PLAYED_ITEM_CHANGED, item, 0, 0, 0);
+}
+
+static void
+clapper_control_hub_item_updated (ClapperReactable *reactable, ClapperMediaItem *item, ClapperReactableItemUpdatedFlags flags)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_ITEM_UPDATED, item, 0, flags, 0);
+}
+
+static void
+clapper_control_hub_queue_item_added (ClapperReactable *reactable, ClapperMediaItem *item, guint index)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_QUEUE_ITEM_ADDED, item, 0, index, 0);
+}
+
+static void
+clapper_control_hub_queue_item_removed (ClapperReactable *reactable, ClapperMediaItem *item, guint index)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_QUEUE_ITEM_REMOVED, item, 0, index, 0);
+}
+
+static void
+clapper_control_hub_queue_item_repositioned (ClapperReactable *reactable, guint before, guint after)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_QUEUE_ITEM_REPOSITIONED, NULL, 0, before, after);
+}
+
+static void
+clapper_control_hub_queue_cleared (ClapperReactable *reactable)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_QUEUE_CLEARED, NULL, 0, 0, 0);
+}
+
+static void
+clapper_control_hub_queue_progression_changed (ClapperReactable *reactable, ClapperQueueProgressionMode mode)
+{
+  _push_task (CLAPPER_CONTROL_HUB_CAST (reactable), TASK_QUEUE_PROGRESSION_CHANGED, NULL, 0, mode, 0);
+}
+
+static void
+clapper_control_hub_reactable_iface_init (ClapperReactableInterface *iface)
+{
+  iface->state_changed = clapper_control_hub_state_changed;
+  iface->position_changed = clapper_control_hub_position_changed;
+  iface->speed_changed = clapper_control_hub_speed_changed;
+  iface->volume_changed = clapper_control_hub_volume_changed;
+  iface->mute_changed = clapper_control_hub_mute_changed;
+  iface->played_item_changed = clapper_control_hub_played_item_changed;
+  iface->item_updated = clapper_control_hub_item_updated;
+  iface->queue_item_added = clapper_control_hub_queue_item_added;
+  iface->queue_item_removed = clapper_control_hub_queue_item_removed;
+  iface->queue_item_repositioned = clapper_control_hub_queue_item_repositioned;
+  iface->queue_cleared = clapper_control_hub_queue_cleared;
+  iface->queue_progression_changed = clapper_control_hub_queue_progression_changed;
+}
+
+#define parent_class clapper_control_hub_parent_class
+G_DEFINE_TYPE_WITH_CODE (ClapperControlHub, clapper_control_hub, GST_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE (CLAPPER_TYPE_REACTABLE, clapper_control_hub_reactable_iface_init));
+
 static void
 clapper_control_hub_init (ClapperControlHub *self)
 {
+  self->server = clapper_control_hub_server_obtain ();
+  self->context = self->server->context;
+  self->index = (guint) g_atomic_int_add (&_hub_index, 1);
+
   self->active = DEFAULT_ACTIVE;
   self->queue_controllable = DEFAULT_QUEUE_CONTROLLABLE;
+  self->broadcast_interval = DEFAULT_BROADCAST_INTERVAL;
+  self->client_queue_limit = DEFAULT_CLIENT_QUEUE_LIMIT;
+  self->client_stall_timeout = DEFAULT_CLIENT_STALL_TIMEOUT;
+  self->snapshot_window = DEFAULT_SNAPSHOT_WINDOW;
+  self->scrub_interval = DEFAULT_SCRUB_INTERVAL;
+  self->position_resync_interval = DEFAULT_POSITION_RESYNC_INTERVAL;
 
   /* Player non-zero defaults */
   self->speed = 1.0;
   self->volume = 1.0;
+  self->position_time = self->reported_time = g_get_monotonic_time ();
+
+  self->ws_connections = g_ptr_array_new_with_free_func ((GDestroyNotify) clapper_control_hub_ws_client_free);
+  self->sse_clients = g_ptr_array_new_with_free_func ((GDestroyNotify) clapper_control_hub_sse_client_free);
+  self->pending_events = g_ptr_array_new_with_free_func ((GDestroyNotify) g_free);
+  clapper_control_hub_ws_history_init (self);
 
-  self->server = soup_server_new ("server-header", "ClapperControlHub", NULL);
-  self->ws_connections = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+  /* Start from current time for ETags to
+   * not repeat between player runs */
+  self->state_version = (guint64) g_get_real_time ();
 
   self->items = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_object_unref);
+  self->json_titles = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  clapper_control_hub_auth_init (self);
   self->played_index = CLAPPER_QUEUE_INVALID_POSITION;
+  self->art_cache = clapper_control_hub_art_cache_new (self->context);
+  self->imports = g_ptr_array_new ();
+}
 
-  soup_server_add_handler (self->server, "/item", (SoupServerCallback) _item_info_request_cb, self, NULL);
-  soup_server_add_handler (self->server, "/tags", (SoupServerCallback) _item_tags_request_cb, self, NULL);
-  soup_server_add_handler (self->server, "/", (SoupServerCallback) _default_request_cb, self, NULL);
-  soup_server_add_websocket_handler (self->server, "/websocket", NULL, NULL,
-      (SoupServerWebsocketCallback) clapper_control_hub_ws_connection_cb, self, NULL);
+static gboolean
+_teardown_cb (ClapperControlHub *self)
+{
+  _stop_serving (self);
+  _clear_stored_queue (self);
+  clapper_control_hub_broadcast_clear (self);
+  g_clear_pointer (&self->art_cache, clapper_control_hub_art_cache_free);
+  clapper_control_hub_import_orphan_all (self);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
@@ -517,14 +1021,11 @@ clapper_control_hub_dispose (GObject *object)
 {
   ClapperControlHub *self = CLAPPER_CONTROL_HUB_CAST (object);
 
-  _stop_serving (self);
-  _clear_stored_queue (self);
-
-  if (self->mdns) {
-    gst_object_unparent (GST_OBJECT_CAST (self->mdns));
-    gst_clear_object (&self->mdns);
+  if (self->server) {
+    /* Also waits for all previously pushed tasks */
+    clapper_control_hub_server_invoke_sync (self->server, (GSourceFunc) _teardown_cb, self);
+    g_clear_pointer (&self->server, clapper_control_hub_server_release);
   }
-  g_clear_object (&self->server);
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
@@ -537,7 +1038,18 @@ clapper_control_hub_finalize (GObject *object)
   GST_TRACE_OBJECT (self, "Finalize");
 
   g_ptr_array_unref (self->ws_connections);
+  g_ptr_array_unref (self->sse_clients);
+  g_ptr_array_unref (self->pending_events);
+  g_ptr_array_unref (self->history);
+  g_free (self->snapshot);
+  if (self->snapshot_binary)
+    g_bytes_unref (self->snapshot_binary);
+  _clear_responses (self);
   g_ptr_array_unref (self->items);
+  g_hash_table_unref (self->json_titles);
+  g_ptr_array_unref (self->imports);
+  clapper_control_hub_auth_finalize (self);
+  g_free (self->pairing_token);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -550,10 +1062,33 @@ clapper_control_hub_set_property (GObject *object, guint prop_id,
 
   switch (prop_id) {
     case PROP_ACTIVE:
-      clapper_control_hub_set_active (self, g_value_get_boolean (value));
+      _push_task (self, TASK_SET_ACTIVE, NULL, 0, g_value_get_boolean (value), 0);
       break;
     case PROP_QUEUE_CONTROLLABLE:
       self->queue_controllable = g_value_get_boolean (value);
+      _push_task (self, TASK_INVALIDATE_STATE, NULL, 0, 0, 0);
+      break;
+    case PROP_BROADCAST_INTERVAL:
+      _push_task (self, TASK_SET_BROADCAST_INTERVAL, NULL, 0, g_value_get_uint (value), 0);
+      break;
+    case PROP_CLIENT_QUEUE_LIMIT:
+      self->client_queue_limit = g_value_get_uint (value);
+      break;
+    case PROP_CLIENT_STALL_TIMEOUT:
+      self->client_stall_timeout = g_value_get_uint (value);
+      break;
+    case PROP_SNAPSHOT_WINDOW:
+      self->snapshot_window = g_value_get_uint (value);
+      _push_task (self, TASK_INVALIDATE_STATE, NULL, 0, 0, 0);
+      break;
+    case PROP_SCRUB_INTERVAL:
+      self->scrub_interval = g_value_get_uint (value);
+      break;
+    case PROP_POSITION_RESYNC_INTERVAL:
+      self->position_resync_interval = g_value_get_uint (value);
+      break;
+    case PROP_PAIRING_TOKEN:
+      _push_text_task (self, TASK_SET_PAIRING_TOKEN, g_value_get_string (value));
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -574,6 +1109,29 @@ clapper_control_hub_get_property (GObject *object, guint prop_id,
     case PROP_QUEUE_CONTROLLABLE:
       g_value_set_boolean (value, self->queue_controllable);
       break;
+    case PROP_BROADCAST_INTERVAL:
+      g_value_set_uint (value, self->broadcast_interval);
+      break;
+    case PROP_CLIENT_QUEUE_LIMIT:
+      g_value_set_uint (value, self->client_queue_limit);
+      break;
+    case PROP_CLIENT_STALL_TIMEOUT:
+      g_value_set_uint (value, self->client_stall_timeout);
+      break;
+    case PROP_SNAPSHOT_WINDOW:
+      g_value_set_uint (value, self->snapshot_window);
+      break;
+    case PROP_SCRUB_INTERVAL:
+      g_value_set_uint (value, self->scrub_interval);
+      break;
+    case PROP_POSITION_RESYNC_INTERVAL:
+      g_value_set_uint (value, self->position_resync_interval);
+      break;
+    case PROP_PAIRING_TOKEN:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string (value, self->pairing_token);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -588,6 +1146,13 @@ clapper_control_hub_class_init (ClapperControlHubClass *klass)
   GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clappercontrolhub", 0,
       "Clapper Control Hub");
   clapper_control_hub_ws_debug_init ();
+  clapper_control_hub_auth_debug_init ();
+  clapper_control_hub_art_debug_init ();
+  clapper_control_hub_broadcast_debug_init ();
+  clapper_control_hub_import_debug_init ();
+  clapper_control_hub_queue_debug_init ();
+  clapper_control_hub_scrub_debug_init ();
+  clapper_control_hub_sse_debug_init ();
 
   gobject_class->get_property = clapper_control_hub_get_property;
   gobject_class->set_property = clapper_control_hub_set_property;
@@ -610,6 +1175,8 @@ clapper_control_hub_class_init (ClapperControlHubClass *klass)
    *
    * This includes ability to open new URIs, adding/removing items from
    * the queue and selecting current item for playback remotely.
+   * When enabled, clients can also import whole M3U or plain URI
+   * lists with a "POST /queue" request.
    *
    * You probably want to keep this disabled if your application
    * is supposed to manage what is played now and not the client.
@@ -618,6 +1185,136 @@ clapper_control_hub_class_init (ClapperControlHubClass *klass)
       NULL, NULL, DEFAULT_QUEUE_CONTROLLABLE,
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
 
+  /**
+   * ClapperControlHub:broadcast-interval:
+   *
+   * Time window in milliseconds within which events are collected
+   * and sent to remote clients together.
+   *
+   * Within this window only the latest value of each changed property
+   * is sent, while queue events are kept in their original order. When
+   * more than one event was collected, a single "batch" event is sent
+   * with all of them in its "events" array.
+   *
+   * Set to 0 (default) to send every event right away.
+   */
+  param_specs[PROP_BROADCAST_INTERVAL] = g_param_spec_uint ("broadcast-interval",
+      NULL, NULL, 0, 1000, DEFAULT_BROADCAST_INTERVAL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperControlHub:client-queue-limit:
+   *
+   * Amount of data in bytes that can be waiting to be sent to
+   * a single remote client before it is considered too slow.
+   *
+   * Once over the limit, further events are not sent to such
+   * client. When it catches up, it receives a fresh "snapshot"
+   * event with current state instead of all dropped ones.
+   *
+   * Set to 0 for no limit.
+   */
+  param_specs[PROP_CLIENT_QUEUE_LIMIT] = g_param_spec_uint ("client-queue-limit",
+      NULL, NULL, 0, G_MAXUINT, DEFAULT_CLIENT_QUEUE_LIMIT,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperControlHub:client-stall-timeout:
+   *
+   * Time in seconds after which remote client that went over
+   * "client-queue-limit" and did not catch up since is disconnected.
+   *
+   * Set to 0 to never disconnect slow clients.
+   */
+  param_specs[PROP_CLIENT_STALL_TIMEOUT] = g_param_spec_uint ("client-stall-timeout",
+      NULL, NULL, 0, 3600, DEFAULT_CLIENT_STALL_TIMEOUT,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperControlHub:snapshot-window:
+   *
+   * Maximal amount of queue items included in state snapshot.
+   *
+   * Snapshot always carries total "n_items" count and "offset" of
+   * the first included item. Window is centered around currently
+   * played item. Remaining items can be fetched by clients lazily
+   * from "/queue?offset=&limit=" endpoint.
+   *
+   * Set to 0 (default) to include the whole queue.
+   */
+  param_specs[PROP_SNAPSHOT_WINDOW] = g_param_spec_uint ("snapshot-window",
+      NULL, NULL, 0, G_MAXUINT, DEFAULT_SNAPSHOT_WINDOW,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperControlHub:scrub-interval:
+   *
+   * Minimal time in milliseconds between seeks requested by a single
+   * remote client before they are treated as scrubbing.
+   *
+   * While scrubbing, only the latest requested position is used and
+   * fast seeks are done at most once per interval. When client stops
+   * sending seeks, one final accurate seek is done.
+   *
+   * Set to 0 to perform every requested seek.
+   */
+  param_specs[PROP_SCRUB_INTERVAL] = g_param_spec_uint ("scrub-interval",
+      NULL, NULL, 0, 1000, DEFAULT_SCRUB_INTERVAL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperControlHub:position-resync-interval:
+   *
+   * Maximal time in seconds between position events sent while playing.
+   *
+   * Position is otherwise only sent on discontinuities such as seeking
+   * or playback state and speed changes. Each position event carries
+   * speed and a monotonic timestamp (in milliseconds) at which position
+   * was reported, so clients can interpolate it locally in between.
+   *
+   * Current server time is sent right after each snapshot within "clock"
+   * event (or "X-Clapper-Timestamp" header of "/" response), so clients
+   * can find offset between their clock and server one.
+   *
+   * Set to 0 to only send position on discontinuities.
+   */
+  param_specs[PROP_POSITION_RESYNC_INTERVAL] = g_param_spec_uint ("position-resync-interval",
+      NULL, NULL, 0, 3600, DEFAULT_POSITION_RESYNC_INTERVAL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperControlHub:pairing-token:
+   *
+   * Secret token that remote clients must know in order to control playback.
+   *
+   * When set, service is advertised as requiring auth and each WebSocket
+   * client receives a random nonce upon connecting. It then has to reply
+   * with "auth" action carrying HMAC-SHA256 of that nonce keyed with this
+   * token before any other action is accepted. Successful pairing returns
+   * a session ID. Its key is HMAC-SHA256 of "session:<nonce>" keyed with
+   * this token and is never sent.
+   *
+   * Client reconnecting with "session" query parameter is challenged
+   * with "resume" set and replies with HMAC-SHA256 of the new nonce keyed
+   * with session key instead. Session can be resumed for 24 hours and
+   * its ID is replaced with a new one each time.
+   *
+   * HTTP requests that alter player must be signed with session key
+   * ("Authorization: Clapper <id>:<timestamp>:<signature>"). Timestamp is
+   * Unix time in milliseconds, which must be within a minute of server
+   * clock and larger than in previous request of the session. Signature
+   * is HMAC-SHA256 of "<method>|<path>|<timestamp>" keyed with session key.
+   *
+   * Hosts that fail pairing repeatedly or reconnect too often
+   * are refused for a few minutes.
+   *
+   * Changing token invalidates all sessions. Set to %NULL or empty
+   * string (default) to allow any client on local network.
+   */
+  param_specs[PROP_PAIRING_TOKEN] = g_param_spec_string ("pairing-token",
+      "Pairing Token", "Secret token that remote clients must know in order to control playback", NULL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_GLOBAL | CLAPPER_ENHANCER_PARAM_LOCAL);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, param_specs);
 }
 
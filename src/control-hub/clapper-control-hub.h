@@ -24,7 +24,9 @@
 #include <clapper/clapper.h>
 #include <libsoup/soup.h>
 
-#include "clapper-control-hub-mdns.h"
+#include "clapper-control-hub-art.h"
+#include "clapper-control-hub-http.h"
+#include "clapper-control-hub-server.h"
 
 G_BEGIN_DECLS
 
@@ -39,24 +41,70 @@ struct _ClapperControlHub
   GstObject parent;
 
   gboolean running;
+  GMainContext *context;
+
+  /* Shared within process */
+  ClapperControlHubServer *server;
+  guint index;
 
-  SoupServer *server;
   GPtrArray *ws_connections;
-  ClapperControlHubMdns *mdns;
+  GPtrArray *sse_clients;
+  GSource *sse_keepalive_source;
+
+  /* Sequence number of the last sent event */
+  guint64 seq;
+  guint64 history_first;
+  GPtrArray *history;
+  guint64 state_version;
+  gchar *snapshot;
+  GBytes *snapshot_binary;
+
+  /* Cached "/" responses per encoding */
+  GBytes *responses[CLAPPER_CONTROL_HUB_HTTP_N_ENCODINGS];
+  ClapperControlHubArtCache *art_cache;
+
+  /* Bulk imports awaiting response */
+  GPtrArray *imports;
+
+  /* Events awaiting broadcast */
+  GSource *broadcast_source;
+  guint pending_properties;
+  GPtrArray *pending_events;
 
   GPtrArray *items;
+  GHashTable *json_titles;
   ClapperMediaItem *played_item;
   guint played_index;
 
   ClapperPlayerState state;
+
+  /* Position sent to clients and monotonic time at which
+   * it was reported, clients interpolate from it */
   gdouble position;
+  gint64 position_time;
+
+  /* Last position reported by player */
+  gdouble reported_position;
+  gint64 reported_time;
+
   gdouble speed;
   gdouble volume;
   gboolean mute;
   ClapperQueueProgressionMode progression;
 
+  /* Written only from server thread, under object lock */
+  gchar *pairing_token;
+  GHashTable *auth_sessions;
+  GHashTable *auth_limits;
+
   gboolean active;
   gboolean queue_controllable;
+  guint broadcast_interval;
+  guint client_queue_limit;
+  guint client_stall_timeout;
+  guint snapshot_window;
+  guint scrub_interval;
+  guint position_resync_interval;
 };
 
 G_END_DECLS
@@ -38,6 +38,10 @@
 #include <gst/gst.h>
 #include <gst/tag/tag.h>
 
+#ifdef HAVE_IMAGE_UTILS
+#include "../utils/c/image/image-utils.h"
+#endif
+
 #include "clapper-mpris-gdbus.h"
 
 #define CLAPPER_MPRIS_SECONDS_TO_USECONDS(seconds) ((gint64) (seconds * G_GINT64_CONSTANT (1000000)))
@@ -56,6 +60,14 @@
 #define CLAPPER_MPRIS_LOOP_PLAYLIST "Playlist"
 
 #define DEFAULT_QUEUE_CONTROLLABLE FALSE
+#define DEFAULT_UPDATE_LATENCY 50
+#define DEFAULT_TRACK_LIST_WINDOW 0
+#define DEFAULT_ART_MAX_SIZE 0
+
+/* Item updates that alter track metadata */
+#define CLAPPER_MPRIS_METADATA_FLAGS (CLAPPER_REACTABLE_ITEM_UPDATED_TITLE \
+    | CLAPPER_REACTABLE_ITEM_UPDATED_DURATION | CLAPPER_REACTABLE_ITEM_UPDATED_TAGS \
+    | CLAPPER_REACTABLE_ITEM_UPDATED_REDIRECT_URI)
 
 /* Compat */
 /* FIXME: 1.0: Remove and rename back to ClapperMpris in meson */
@@ -153,15 +165,53 @@ G_DECLARE_FINAL_TYPE (ClapperEnhancerMpris, clapper_enhancer_mpris, CLAPPER, ENH
 
 G_MODULE_EXPORT void peas_register_types (PeasObjectModule *module);
 
+/* Art image file shared by all tracks with the same content */
+typedef struct
+{
+  ClapperMpris *mpris;
+  gchar *hash;
+  GFile *file;
+  gchar *uri;
+  guint ref_count;
+  gboolean writing;
+  gboolean written;
+} ClapperMprisArt;
+
+typedef struct
+{
+  GstSample *sample;
+  guint max_size;
+  GBytes *bytes;
+  gchar *hash;
+} ClapperMprisArtJob;
+
 typedef struct
 {
   gchar *id;
   ClapperMediaItem *item;
   GstSample *art_sample;
   gchar *art_url;
-  gboolean art_from_data;
+
+  /* Exported image data */
+  ClapperMprisArt *art;
+  GCancellable *art_cancellable;
+
+  /* Built on demand, cleared when outdated */
+  GVariant *metadata;
+  gboolean metadata_pending;
+
+  /* Whether listed in "Tracks" on the bus */
+  gboolean exposed;
+  gboolean in_window;
 } ClapperMprisTrack;
 
+typedef enum
+{
+  CLAPPER_MPRIS_UPDATE_CURRENT_TRACK = 1 << 0,
+  CLAPPER_MPRIS_UPDATE_TRACK_LIST = 1 << 1,
+  CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS = 1 << 2
+} ClapperMprisUpdate;
+
 struct _ClapperMpris
 {
   GstObject parent;
@@ -182,6 +232,17 @@ struct _ClapperMpris
   GPtrArray *tracks;
   ClapperMprisTrack *current_track;
 
+  /* Exported art images by content hash */
+  GHashTable *arts;
+
+  /* Subset of tracks published on the bus */
+  GPtrArray *exposed_tracks;
+
+  /* Updates emitted together on flush */
+  GSource *flush_source;
+  ClapperMprisUpdate pending_updates;
+  GPtrArray *pending_tracks;
+
   ClapperQueueProgressionMode default_mode;
   ClapperQueueProgressionMode non_shuffle_mode;
 
@@ -194,6 +255,9 @@ struct _ClapperMpris
 
   gboolean queue_controllable;
   gchar *fallback_art_url;
+  guint update_latency;
+  guint track_list_window;
+  guint art_max_size;
 };
 
 enum
@@ -205,12 +269,48 @@ enum
   PROP_DESKTOP_ENTRY,
   PROP_QUEUE_CONTROLLABLE,
   PROP_FALLBACK_ART_URL,
+  PROP_UPDATE_LATENCY,
+  PROP_TRACK_LIST_WINDOW,
+  PROP_ART_MAX_SIZE,
   PROP_LAST
 };
 
 static const gchar *const empty_tracklist[] = { NULL, };
 static GParamSpec *param_specs[PROP_LAST] = { NULL, };
 
+static void clapper_mpris_refresh_track (ClapperMpris *self, ClapperMprisTrack *track);
+
+static void
+_mpris_art_free (ClapperMprisArt *art)
+{
+  g_free (art->hash);
+  g_object_unref (art->file);
+  g_free (art->uri);
+
+  g_free (art);
+}
+
+static void
+_mpris_art_remove (ClapperMpris *self, ClapperMprisArt *art)
+{
+  GST_DEBUG_OBJECT (self, "Removing art image: %s", art->hash);
+
+  if (art->written)
+    g_file_delete (art->file, NULL, NULL);
+
+  g_hash_table_remove (self->arts, art->hash);
+}
+
+/* Removes art image file once no track uses it and it is not being written */
+static void
+_mpris_art_release (ClapperMprisArt *art)
+{
+  if (--art->ref_count > 0 || art->writing)
+    return;
+
+  _mpris_art_remove (art->mpris, art);
+}
+
 static ClapperMprisTrack *
 clapper_mpris_track_new (ClapperMediaItem *item)
 {
@@ -225,7 +325,12 @@ clapper_mpris_track_new (ClapperMediaItem *item)
   track->item = gst_object_ref (item);
   track->art_sample = NULL;
   track->art_url = NULL;
-  track->art_from_data = FALSE;
+  track->art = NULL;
+  track->art_cancellable = NULL;
+  track->metadata = NULL;
+  track->metadata_pending = FALSE;
+  track->exposed = FALSE;
+  track->in_window = FALSE;
 
   GST_TRACE ("Created track: %s", track->id);
 
@@ -233,11 +338,18 @@ clapper_mpris_track_new (ClapperMediaItem *item)
 }
 
 static inline void
-_delete_art_data (ClapperMprisTrack *track)
+_track_clear_art (ClapperMprisTrack *track)
 {
-  GFile *file = g_file_new_for_uri (track->art_url);
-  g_file_delete (file, NULL, NULL);
-  g_object_unref (file);
+  /* Export in progress, its result will not be used */
+  if (track->art_cancellable) {
+    g_cancellable_cancel (track->art_cancellable);
+    g_clear_object (&track->art_cancellable);
+  }
+  if (track->art) {
+    _mpris_art_release (track->art);
+    track->art = NULL;
+  }
+  g_clear_pointer (&track->art_url, g_free);
 }
 
 static void
@@ -245,14 +357,12 @@ clapper_mpris_track_free (ClapperMprisTrack *track)
 {
   GST_TRACE ("Freeing track: %s", track->id);
 
-  /* XXX: Must call before freeing art url */
-  if (track->art_from_data)
-    _delete_art_data (track);
+  _track_clear_art (track);
 
   g_free (track->id);
   gst_object_unref (track->item);
   gst_clear_sample (&track->art_sample);
-  g_free (track->art_url);
+  g_clear_pointer (&track->metadata, g_variant_unref);
 
   g_free (track);
 }
@@ -371,19 +481,190 @@ _get_image_sample (GstTagList *tags, const gchar *tag)
   return sample;
 }
 
+#ifdef HAVE_IMAGE_UTILS
+static GBytes *
+_art_downscale (const guint8 *data, gsize data_size, guint max_size)
+{
+  GError *error = NULL;
+  GBytes *bytes = image_utils_downscale (data, data_size, max_size, NULL, &error);
+
+  if (error) {
+    GST_WARNING ("Could not downscale art image: %s", error->message);
+    g_error_free (error);
+  }
+
+  return bytes;
+}
+#endif
+
+static void
+_art_job_free (ClapperMprisArtJob *job)
+{
+  gst_sample_unref (job->sample);
+  g_clear_pointer (&job->bytes, g_bytes_unref);
+  g_free (job->hash);
+
+  g_free (job);
+}
+
+/* Prepares image data and names it after its content, so
+ * identical images from different tracks share a single file */
+static void
+_art_export_in_thread (GTask *task, ClapperMpris *self,
+    ClapperMprisArtJob *job, GCancellable *cancellable)
+{
+  GstBuffer *buffer = gst_sample_get_buffer (job->sample);
+  GstMapInfo map_info;
+
+  if (G_UNLIKELY (!buffer || !gst_buffer_map (buffer, &map_info, GST_MAP_READ))) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+        "Could not map image sample buffer for reading");
+    return;
+  }
+
+#ifdef HAVE_IMAGE_UTILS
+  if (job->max_size > 0)
+    job->bytes = _art_downscale (map_info.data, map_info.size, job->max_size);
+#endif
+  if (!job->bytes)
+    job->bytes = g_bytes_new (map_info.data, map_info.size);
+
+  gst_buffer_unmap (buffer, &map_info);
+
+  job->hash = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, job->bytes);
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+_art_write_done_cb (GFile *file, GAsyncResult *res, ClapperMprisArt *art)
+{
+  ClapperMpris *self = art->mpris;
+  GError *error = NULL;
+  guint i;
+
+  art->writing = FALSE;
+
+  if (!(art->written = g_file_replace_contents_finish (file, res, NULL, &error))) {
+    GST_ERROR_OBJECT (self, "Could not write art image file, reason: %s",
+        GST_STR_NULL (error->message));
+    g_clear_error (&error);
+  }
+
+  if (art->ref_count == 0) {
+    _mpris_art_remove (self, art);
+  } else if (art->written) {
+    GST_DEBUG_OBJECT (self, "Written art image: %s", art->uri);
+
+    for (i = 0; i < self->tracks->len; ++i) {
+      ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->tracks, i);
+
+      if (track->art == art && !track->art_url) {
+        track->art_url = g_strdup (art->uri);
+        clapper_mpris_refresh_track (self, track);
+      }
+    }
+  }
+
+  /* Ref taken when write was started */
+  gst_object_unref (self);
+}
+
+/* Returns art with given content, starting its file write if it is new */
+static ClapperMprisArt *
+_mpris_art_acquire (ClapperMpris *self, const gchar *hash, GBytes *bytes)
+{
+  ClapperMprisArt *art;
+  GFile *data_dir;
+  GError *error = NULL;
+
+  if ((art = g_hash_table_lookup (self->arts, hash))) {
+    GST_DEBUG_OBJECT (self, "Reusing art image: %s", hash);
+    art->ref_count++;
+
+    return art;
+  }
+
+  /* XXX: When item is moved between queues, item added message may arrive on
+   * 2nd bus before removed in the first one. Separate directory for each
+   * own name is thus needed, so we do not remove file after its created. */
+  data_dir = g_file_new_build_filename (g_get_user_runtime_dir (),
+      "app", self->app_id, CLAPPER_API_NAME, "enhancers", "clapper-mpris",
+      self->own_name, NULL);
+
+  if (!g_file_make_directory_with_parents (data_dir, NULL, &error)) {
+    if (error->domain != G_IO_ERROR || error->code != G_IO_ERROR_EXISTS) {
+      GST_ERROR_OBJECT (self, "Failed to create directory for data: %s", error->message);
+      g_clear_error (&error);
+      g_object_unref (data_dir);
+
+      return NULL;
+    }
+    g_clear_error (&error);
+  }
+
+  art = g_new0 (ClapperMprisArt, 1);
+  art->mpris = self;
+  art->hash = g_strdup (hash);
+
+  /* Some clients (e.g. GNOME Shell) cache generated artwork even
+   * after app is closed, so file name must change with its content */
+  art->file = g_file_get_child (data_dir, hash);
+  art->uri = g_file_get_uri (art->file);
+  art->ref_count = 1;
+  art->writing = TRUE;
+
+  g_object_unref (data_dir);
+
+  g_hash_table_insert (self->arts, art->hash, art);
+
+  GST_DEBUG_OBJECT (self, "Writing art image: %s", art->uri);
+
+  /* Must stay alive until written, so unused file can be removed */
+  gst_object_ref (self);
+  g_file_replace_contents_bytes_async (art->file, bytes, NULL, FALSE,
+      G_FILE_CREATE_NONE, NULL, (GAsyncReadyCallback) _art_write_done_cb, art);
+
+  return art;
+}
+
+static void
+_art_export_done_cb (ClapperMpris *self, GAsyncResult *res, ClapperMprisTrack *track)
+{
+  ClapperMprisArtJob *job = g_task_get_task_data (G_TASK (res));
+  GError *error = NULL;
+
+  if (!g_task_propagate_boolean (G_TASK (res), &error)) {
+    /* When cancelled, track might be already freed */
+    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      GST_ERROR_OBJECT (self, "Could not export art image, reason: %s",
+          GST_STR_NULL (error->message));
+      g_clear_object (&track->art_cancellable);
+    }
+    g_error_free (error);
+
+    return;
+  }
+
+  g_clear_object (&track->art_cancellable);
+
+  if (!(track->art = _mpris_art_acquire (self, job->hash, job->bytes)))
+    return;
+
+  /* Otherwise art url is set once file is written */
+  if (track->art->written) {
+    track->art_url = g_strdup (track->art->uri);
+    clapper_mpris_refresh_track (self, track);
+  }
+}
+
 static void
 _track_take_art_sample (ClapperMpris *self, ClapperMprisTrack *track, GstSample *sample)
 {
   GstStructure *structure;
   const gchar *media_type;
 
-  /* Delete outdated artwork data first,
-   * then free the art url */
-  if (track->art_from_data) {
-    _delete_art_data (track);
-    track->art_from_data = FALSE;
-  }
-  g_clear_pointer (&track->art_url, g_free);
+  /* Release outdated artwork data and art url first */
+  _track_clear_art (track);
 
   /* Replace stored sample */
   gst_clear_sample (&track->art_sample);
@@ -396,76 +677,23 @@ _track_take_art_sample (ClapperMpris *self, ClapperMprisTrack *track, GstSample
   media_type = gst_structure_get_name (structure);
 
   if (g_str_has_prefix (media_type, "image/")) {
-    GFile *data_dir;
-    GError *error = NULL;
+    ClapperMprisArtJob *job;
+    GTask *task;
 
     GST_DEBUG_OBJECT (self, "Sample stores image data");
 
-    /* XXX: When item is moved between queues, item added message may arrive on
-     * 2nd bus before removed in the first one. Separate directory for each
-     * own name is thus needed, so we do not remove file after its created. */
-    data_dir = g_file_new_build_filename (g_get_user_runtime_dir (),
-        "app", self->app_id, CLAPPER_API_NAME, "enhancers", "clapper-mpris",
-        self->own_name, NULL);
-
-    if (!g_file_make_directory_with_parents (data_dir, NULL, &error)) {
-      if (error->domain != G_IO_ERROR || error->code != G_IO_ERROR_EXISTS) {
-        GST_ERROR_OBJECT (self, "Failed to create directory for data: %s", error->message);
-        g_clear_object (&data_dir);
-      }
-      g_clear_error (&error);
-    }
-
-    /* When dir was present or created */
-    if (data_dir) {
-      GFile *art_file;
-      GOutputStream *ostream;
-      gchar name[22]; // 2 * uint + "_" + NULL
-
-      /* Some clients (e.g. GNOME Shell) cache generated artwork even
-       * after app is closed, so each file must have an unique name
-       * (unless it can be considered to be the exact same media item) */
-      g_snprintf (name, sizeof (name), "%u_%u", clapper_media_item_get_id (track->item),
-          g_str_hash (clapper_media_item_get_uri (track->item))); // no need to use redirect
-      art_file = g_file_get_child (data_dir, name);
-
-      if ((ostream = G_OUTPUT_STREAM (g_file_replace (art_file,
-          NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error)))) {
-        GstBuffer *buffer = gst_sample_get_buffer (track->art_sample);
-        GstMemory *mem = gst_buffer_peek_memory (buffer, 0);
-        GstMapInfo map_info;
-
-        if (G_LIKELY (mem && gst_memory_map (mem, &map_info, GST_MAP_READ))) {
-          if (g_output_stream_write_all (ostream, map_info.data, map_info.size,
-              NULL, NULL, &error)) {
-            track->art_url = g_file_get_uri (art_file);
-            if (G_LIKELY (track->art_url != NULL))
-              track->art_from_data = TRUE;
-          } else if (error) {
-            GST_ERROR_OBJECT (self, "Could write art image file, reason: %s",
-                GST_STR_NULL (error->message));
-            g_clear_error (&error);
-          }
-          gst_memory_unmap (mem, &map_info);
-        } else {
-          GST_ERROR_OBJECT (self, "Could not map image sample buffer for reading");
-        }
-
-        if (G_UNLIKELY (!g_output_stream_close (ostream, NULL, &error))) {
-          GST_ERROR_OBJECT (self, "Could not close file output stream, reason: %s",
-              GST_STR_NULL (error->message));
-          g_clear_error (&error);
-        }
-        g_object_unref (ostream);
-      } else if (error) {
-        GST_ERROR_OBJECT (self, "Could not open file for writing, reason: %s",
-            GST_STR_NULL (error->message));
-        g_clear_error (&error);
-      }
-
-      g_object_unref (art_file);
-      g_object_unref (data_dir);
-    }
+    job = g_new0 (ClapperMprisArtJob, 1);
+    job->sample = gst_sample_ref (track->art_sample);
+    job->max_size = self->art_max_size;
+
+    /* Image is processed and written in background,
+     * track metadata is refreshed once it is done */
+    track->art_cancellable = g_cancellable_new ();
+    task = g_task_new (self, track->art_cancellable,
+        (GAsyncReadyCallback) _art_export_done_cb, track);
+    g_task_set_task_data (task, job, (GDestroyNotify) _art_job_free);
+    g_task_run_in_thread (task, (GTaskThreadFunc) _art_export_in_thread);
+    g_object_unref (task);
   } else if (strcmp (media_type, "text/uri-list") == 0) {
     GstBuffer *buffer = gst_sample_get_buffer (track->art_sample);
     GstMemory *mem = gst_buffer_peek_memory (buffer, 0);
@@ -637,6 +865,25 @@ _mpris_build_track_metadata (ClapperMpris *self, ClapperMprisTrack *track)
   return variant;
 }
 
+/* Returns cached track metadata, building it only when
+ * it is not available yet or was invalidated (transfer none) */
+static GVariant *
+_mpris_get_track_metadata (ClapperMpris *self, ClapperMprisTrack *track)
+{
+  if (!track->metadata) {
+    GST_LOG_OBJECT (self, "Building metadata of track: %s", track->id);
+    track->metadata = g_variant_ref_sink (_mpris_build_track_metadata (self, track));
+  }
+
+  return track->metadata;
+}
+
+static inline void
+_mpris_invalidate_track_metadata (ClapperMprisTrack *track)
+{
+  g_clear_pointer (&track->metadata, g_variant_unref);
+}
+
 static void
 clapper_mpris_refresh_current_track (ClapperMpris *self, GVariant *variant)
 {
@@ -657,58 +904,90 @@ clapper_mpris_refresh_current_track (ClapperMpris *self, GVariant *variant)
   clapper_mpris_media_player2_player_set_maximum_rate (self->player_skeleton, (is_live) ? 1.0 : G_MAXDOUBLE);
 }
 
+/* Calculates range of tracks exposed on the bus, centered around current track */
 static void
-clapper_mpris_refresh_track (ClapperMpris *self, ClapperMprisTrack *track)
+_mpris_get_track_list_window (ClapperMpris *self, guint *start, guint *end)
 {
-  GVariant *variant = g_variant_take_ref (_mpris_build_track_metadata (self, track));
+  guint center = 0;
 
-  if (track == self->current_track)
-    clapper_mpris_refresh_current_track (self, variant);
+  if (self->track_list_window == 0) {
+    *start = 0;
+    *end = self->tracks->len;
+    return;
+  }
 
-  clapper_mpris_media_player2_track_list_emit_track_metadata_changed (self->tracks_skeleton,
-      track->id, variant);
+  if (self->current_track)
+    _mpris_find_track_by_item (self, self->current_track->item, &center);
 
-  g_variant_unref (variant);
+  *start = (center > self->track_list_window) ? center - self->track_list_window : 0;
+  *end = MIN (self->tracks->len, center + self->track_list_window + 1);
 }
 
+/*
+ * Updates "Tracks" property with tracks from current window and emits
+ * "TrackRemoved" and "TrackAdded" only for tracks that left or entered it.
+ * Relative order of tracks that stayed is kept, as repositioned ones are
+ * removed from bus when moved.
+ */
 static void
-clapper_mpris_refresh_all_tracks (ClapperMpris *self)
+clapper_mpris_refresh_track_list (ClapperMpris *self)
 {
-  guint i;
+  const gchar **tracks_ids;
+  const gchar *prev_id = CLAPPER_MPRIS_NO_TRACK;
+  guint i, start, end;
 
-  for (i = 0; i < self->tracks->len; ++i) {
+  _mpris_get_track_list_window (self, &start, &end);
+
+  GST_LOG_OBJECT (self, "Track list refresh, window: [%u, %u)", start, end);
+
+  for (i = start; i < end; ++i) {
     ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->tracks, i);
-    clapper_mpris_refresh_track (self, track);
+    track->in_window = TRUE;
   }
-}
-
-static void
-clapper_mpris_refresh_track_list (ClapperMpris *self)
-{
-  GStrvBuilder *builder;
-  gchar **tracks_ids;
-  guint i;
 
-  GST_LOG_OBJECT (self, "Track list refresh");
+  for (i = 0; i < self->exposed_tracks->len; ++i) {
+    ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->exposed_tracks, i);
 
-  /* Track list is empty */
-  if (self->tracks->len == 0) {
-    clapper_mpris_media_player2_track_list_set_tracks (self->tracks_skeleton, empty_tracklist);
-    return;
+    if (!track->in_window) {
+      track->exposed = FALSE;
+      clapper_mpris_media_player2_track_list_emit_track_removed (self->tracks_skeleton, track->id);
+    }
   }
 
-  builder = g_strv_builder_new ();
+  g_ptr_array_set_size (self->exposed_tracks, 0);
+  tracks_ids = g_new (const gchar *, end - start + 1);
 
-  for (i = 0; i < self->tracks->len; ++i) {
+  for (i = start; i < end; ++i) {
     ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->tracks, i);
-    g_strv_builder_add (builder, track->id);
+
+    /* NoTrack when track is added at first position */
+    if (!track->exposed) {
+      track->exposed = TRUE;
+      clapper_mpris_media_player2_track_list_emit_track_added (self->tracks_skeleton,
+          _mpris_get_track_metadata (self, track), prev_id);
+    }
+    track->in_window = FALSE;
+
+    g_ptr_array_add (self->exposed_tracks, track);
+    tracks_ids[i - start] = prev_id = track->id;
   }
+  tracks_ids[end - start] = NULL;
 
-  tracks_ids = g_strv_builder_end (builder);
-  g_strv_builder_unref (builder);
+  clapper_mpris_media_player2_track_list_set_tracks (self->tracks_skeleton, tracks_ids);
+  g_free (tracks_ids);
+}
+
+/* Removes track from bus right away, before it is freed or moved */
+static inline void
+_mpris_hide_track (ClapperMpris *self, ClapperMprisTrack *track)
+{
+  if (!track->exposed)
+    return;
 
-  clapper_mpris_media_player2_track_list_set_tracks (self->tracks_skeleton, (const gchar *const *) tracks_ids);
-  g_strfreev (tracks_ids);
+  g_ptr_array_remove (self->exposed_tracks, track);
+  track->exposed = FALSE;
+
+  clapper_mpris_media_player2_track_list_emit_track_removed (self->tracks_skeleton, track->id);
 }
 
 static void
@@ -731,6 +1010,127 @@ clapper_mpris_refresh_can_go_next_previous (ClapperMpris *self)
   clapper_mpris_media_player2_player_set_can_go_next (self->player_skeleton, can_next);
 }
 
+/* Emits all pending updates at once, so each interface
+ * sends a single "PropertiesChanged" for all of them */
+static void
+clapper_mpris_flush (ClapperMpris *self)
+{
+  guint i;
+
+  if (self->flush_source) {
+    g_source_destroy (self->flush_source);
+    g_clear_pointer (&self->flush_source, g_source_unref);
+  }
+
+  if (self->pending_updates == 0 && self->pending_tracks->len == 0)
+    return;
+
+  GST_LOG_OBJECT (self, "Flushing updates: %u, tracks: %u",
+      self->pending_updates, self->pending_tracks->len);
+
+  if (self->pending_updates & CLAPPER_MPRIS_UPDATE_TRACK_LIST)
+    clapper_mpris_refresh_track_list (self);
+  if (self->pending_updates & CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS)
+    clapper_mpris_refresh_can_go_next_previous (self);
+  if (self->pending_updates & CLAPPER_MPRIS_UPDATE_CURRENT_TRACK) {
+    clapper_mpris_refresh_current_track (self, (self->current_track != NULL)
+        ? _mpris_get_track_metadata (self, self->current_track) : NULL);
+  }
+
+  for (i = 0; i < self->pending_tracks->len; ++i) {
+    ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->pending_tracks, i);
+
+    track->metadata_pending = FALSE;
+
+    /* Tracks outside of window are not known to clients */
+    if (track->exposed) {
+      clapper_mpris_media_player2_track_list_emit_track_metadata_changed (self->tracks_skeleton,
+          track->id, _mpris_get_track_metadata (self, track));
+    }
+  }
+
+  g_ptr_array_set_size (self->pending_tracks, 0);
+  self->pending_updates = 0;
+
+  /* Send changed properties now instead of on another idle */
+  g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (self->player_skeleton));
+  g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (self->tracks_skeleton));
+}
+
+static gboolean
+_flush_cb (ClapperMpris *self)
+{
+  g_clear_pointer (&self->flush_source, g_source_unref);
+  clapper_mpris_flush (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Schedules flush if not scheduled already. It is never postponed
+ * afterwards, so updates are delayed by at most "update-latency". */
+static void
+_mpris_schedule_flush (ClapperMpris *self)
+{
+  if (self->flush_source)
+    return;
+
+  self->flush_source = (self->update_latency > 0)
+      ? g_timeout_source_new (self->update_latency)
+      : g_idle_source_new ();
+  g_source_set_priority (self->flush_source, G_PRIORITY_DEFAULT);
+  g_source_set_callback (self->flush_source, (GSourceFunc) _flush_cb, self, NULL);
+  g_source_attach (self->flush_source, g_main_context_get_thread_default ());
+}
+
+static inline void
+clapper_mpris_queue_update (ClapperMpris *self, ClapperMprisUpdate update)
+{
+  self->pending_updates |= update;
+  _mpris_schedule_flush (self);
+}
+
+static inline void
+_mpris_drop_pending_track (ClapperMpris *self, ClapperMprisTrack *track)
+{
+  if (track->metadata_pending) {
+    g_ptr_array_remove (self->pending_tracks, track);
+    track->metadata_pending = FALSE;
+  }
+}
+
+/* Marks track metadata as outdated. Its "TrackMetadataChanged"
+ * signal is emitted on flush, once per track. */
+static void
+clapper_mpris_refresh_track (ClapperMpris *self, ClapperMprisTrack *track)
+{
+  _mpris_invalidate_track_metadata (track);
+
+  if (track == self->current_track)
+    self->pending_updates |= CLAPPER_MPRIS_UPDATE_CURRENT_TRACK;
+
+  if (!track->metadata_pending) {
+    track->metadata_pending = TRUE;
+    g_ptr_array_add (self->pending_tracks, track);
+  }
+
+  _mpris_schedule_flush (self);
+}
+
+/* Refreshes tracks that use fallback art. Tracks with metadata
+ * not built yet will pick new fallback when they are built. */
+static void
+clapper_mpris_refresh_fallback_art_tracks (ClapperMpris *self)
+{
+  guint i;
+
+  for (i = 0; i < self->tracks->len; ++i) {
+    ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->tracks, i);
+
+    if (track->metadata && !track->art_url)
+      clapper_mpris_refresh_track (self, track);
+  }
+}
+
 static void
 clapper_mpris_state_changed (ClapperReactable *reactable, ClapperPlayerState state)
 {
@@ -798,20 +1198,20 @@ static void
 clapper_mpris_played_item_changed (ClapperReactable *reactable, ClapperMediaItem *item)
 {
   ClapperMpris *self = CLAPPER_MPRIS_CAST (reactable);
-  GVariant *variant = NULL;
   guint index = 0;
 
   GST_DEBUG_OBJECT (self, "Played item changed to: %" GST_PTR_FORMAT, item);
 
-  if (G_LIKELY (_mpris_find_track_by_item (self, item, &index))) {
-    self->current_track = (ClapperMprisTrack *) g_ptr_array_index (self->tracks, index);
-    variant = _mpris_build_track_metadata (self, self->current_track);
-  } else {
-    self->current_track = NULL;
-  }
+  self->current_track = (G_LIKELY (_mpris_find_track_by_item (self, item, &index)))
+      ? (ClapperMprisTrack *) g_ptr_array_index (self->tracks, index)
+      : NULL;
 
-  clapper_mpris_refresh_current_track (self, variant);
-  clapper_mpris_refresh_can_go_next_previous (self);
+  /* Window follows current track */
+  if (self->track_list_window > 0)
+    self->pending_updates |= CLAPPER_MPRIS_UPDATE_TRACK_LIST;
+
+  clapper_mpris_queue_update (self, CLAPPER_MPRIS_UPDATE_CURRENT_TRACK
+      | CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS);
 }
 
 static void
@@ -822,8 +1222,8 @@ clapper_mpris_item_updated (ClapperReactable *reactable, ClapperMediaItem *item,
 
   GST_LOG_OBJECT (self, "Item updated: %" GST_PTR_FORMAT ", flags: %u", item, flags);
 
-  /* Ignore if only timeline was updated */
-  if (flags == CLAPPER_REACTABLE_ITEM_UPDATED_TIMELINE)
+  /* Ignore updates that do not alter metadata (e.g. timeline) */
+  if (!(flags & CLAPPER_MPRIS_METADATA_FLAGS))
     return;
 
   if (_mpris_find_track_by_item (self, item, &index)) {
@@ -836,8 +1236,7 @@ static void
 clapper_mpris_queue_item_added (ClapperReactable *reactable, ClapperMediaItem *item, guint index)
 {
   ClapperMpris *self = CLAPPER_MPRIS_CAST (reactable);
-  ClapperMprisTrack *track, *prev_track = NULL;
-  GVariant *variant;
+  ClapperMprisTrack *track;
 
   /* Safety precaution for a case when someone adds MPRIS feature
    * in middle of altering playlist from another thread, since we
@@ -850,15 +1249,9 @@ clapper_mpris_queue_item_added (ClapperReactable *reactable, ClapperMediaItem *i
   track = clapper_mpris_track_new (item);
   g_ptr_array_insert (self->tracks, index, track);
 
-  clapper_mpris_refresh_track_list (self);
-  clapper_mpris_refresh_can_go_next_previous (self);
-
-  variant = g_variant_take_ref (_mpris_build_track_metadata (self, track));
-
-  /* NoTrack when item is added at first position in queue */
-  clapper_mpris_media_player2_track_list_emit_track_added (self->tracks_skeleton,
-      variant, (prev_track != NULL) ? prev_track->id : CLAPPER_MPRIS_NO_TRACK);
-  g_variant_unref (variant);
+  /* "TrackAdded" is emitted on flush if track is within window */
+  clapper_mpris_queue_update (self, CLAPPER_MPRIS_UPDATE_TRACK_LIST
+      | CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS);
 }
 
 static void
@@ -870,15 +1263,16 @@ clapper_mpris_queue_item_removed (ClapperReactable *reactable, ClapperMediaItem
   GST_DEBUG_OBJECT (self, "Queue item removed");
 
   track = (ClapperMprisTrack *) g_ptr_array_steal_index (self->tracks, index);
+  _mpris_drop_pending_track (self, track);
+  _mpris_hide_track (self, track);
 
   if (track == self->current_track) {
     self->current_track = NULL;
-    clapper_mpris_refresh_current_track (self, NULL);
+    self->pending_updates |= CLAPPER_MPRIS_UPDATE_CURRENT_TRACK;
   }
 
-  clapper_mpris_refresh_track_list (self);
-  clapper_mpris_refresh_can_go_next_previous (self);
-  clapper_mpris_media_player2_track_list_emit_track_removed (self->tracks_skeleton, track->id);
+  clapper_mpris_queue_update (self, CLAPPER_MPRIS_UPDATE_TRACK_LIST
+      | CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS);
 
   clapper_mpris_track_free (track);
 }
@@ -891,11 +1285,13 @@ clapper_mpris_queue_item_repositioned (ClapperReactable *reactable, guint before
 
   GST_DEBUG_OBJECT (self, "Queue item repositioned: %u -> %u", before, after);
 
+  /* Moved track is added back on flush at its new position */
   track = (ClapperMprisTrack *) g_ptr_array_steal_index (self->tracks, before);
+  _mpris_hide_track (self, track);
   g_ptr_array_insert (self->tracks, after, track);
 
-  clapper_mpris_refresh_track_list (self);
-  clapper_mpris_refresh_can_go_next_previous (self);
+  clapper_mpris_queue_update (self, CLAPPER_MPRIS_UPDATE_TRACK_LIST
+      | CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS);
 }
 
 static void
@@ -904,13 +1300,16 @@ clapper_mpris_queue_cleared (ClapperReactable *reactable)
   ClapperMpris *self = CLAPPER_MPRIS_CAST (reactable);
   guint n_items = self->tracks->len;
 
+  /* Pending and exposed tracks are about to be freed */
+  g_ptr_array_set_size (self->pending_tracks, 0);
+  g_ptr_array_set_size (self->exposed_tracks, 0);
+
   if (n_items > 0)
     g_ptr_array_remove_range (self->tracks, 0, n_items);
 
   self->current_track = NULL;
-  clapper_mpris_refresh_current_track (self, NULL);
-  clapper_mpris_refresh_can_go_next_previous (self);
-  clapper_mpris_refresh_track_list (self);
+  clapper_mpris_queue_update (self, CLAPPER_MPRIS_UPDATE_CURRENT_TRACK
+      | CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS | CLAPPER_MPRIS_UPDATE_TRACK_LIST);
 
   clapper_mpris_media_player2_track_list_emit_track_list_replaced (self->tracks_skeleton,
       empty_tracklist, CLAPPER_MPRIS_NO_TRACK);
@@ -1101,6 +1500,11 @@ clapper_mpris_get_supported_mime_types (ClapperMpris *self)
 static void
 clapper_mpris_unregister (ClapperMpris *self)
 {
+  if (self->flush_source) {
+    g_source_destroy (self->flush_source);
+    g_clear_pointer (&self->flush_source, g_source_unref);
+  }
+
   if (self->base_exported) {
     g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (self->base_skeleton));
     self->base_exported = FALSE;
@@ -1472,7 +1876,7 @@ _handle_get_tracks_metadata_cb (ClapperMprisMediaPlayer2TrackList *tracks_skelet
 
     if (_mpris_find_track_by_id (self, tracks_ids[i], &index)) {
       ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->tracks, index);
-      GVariant *variant = _mpris_build_track_metadata (self, track);
+      GVariant *variant = _mpris_get_track_metadata (self, track);
 
       if (!initialized) {
         g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
@@ -1648,16 +2052,11 @@ _name_acquired_cb (GDBusConnection *connection, const gchar *name, ClapperMpris
 
   if ((player = clapper_reactable_get_player (reactable))) {
     ClapperQueue *queue = clapper_player_get_queue (player);
-    GVariant *variant = NULL;
 
     /* Update tracks IDs after reading initial tracks from queue */
-    clapper_mpris_refresh_track_list (self);
-
-    if (self->current_track)
-      variant = _mpris_build_track_metadata (self, self->current_track);
-
-    clapper_mpris_refresh_current_track (self, variant);
-    clapper_mpris_refresh_can_go_next_previous (self);
+    self->pending_updates |= (CLAPPER_MPRIS_UPDATE_CURRENT_TRACK
+        | CLAPPER_MPRIS_UPDATE_TRACK_LIST | CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS);
+    clapper_mpris_flush (self);
 
     /* Set some initial default progressions to revert to and
      * try to update them in progression_changed call below */
@@ -1767,7 +2166,7 @@ clapper_mpris_set_queue_controllable (ClapperMpris *self, gboolean controllable)
   self->queue_controllable = controllable;
 
   clapper_mpris_media_player2_track_list_set_can_edit_tracks (self->tracks_skeleton, self->queue_controllable);
-  clapper_mpris_refresh_can_go_next_previous (self);
+  clapper_mpris_queue_update (self, CLAPPER_MPRIS_UPDATE_CAN_GO_NEXT_PREVIOUS);
 }
 
 static void
@@ -1776,7 +2175,38 @@ clapper_mpris_set_fallback_art_url (ClapperMpris *self, const gchar *art_url)
   gboolean changed = g_set_str (&self->fallback_art_url, art_url);
 
   if (changed)
-    clapper_mpris_refresh_all_tracks (self);
+    clapper_mpris_refresh_fallback_art_tracks (self);
+}
+
+static void
+clapper_mpris_set_track_list_window (ClapperMpris *self, guint window)
+{
+  if (self->track_list_window == window)
+    return;
+
+  self->track_list_window = window;
+  clapper_mpris_queue_update (self, CLAPPER_MPRIS_UPDATE_TRACK_LIST);
+}
+
+static void
+clapper_mpris_set_art_max_size (ClapperMpris *self, guint max_size)
+{
+  guint i;
+
+  if (self->art_max_size == max_size)
+    return;
+
+  self->art_max_size = max_size;
+
+  /* Export again images that were already exported with previous size */
+  for (i = 0; i < self->tracks->len; ++i) {
+    ClapperMprisTrack *track = (ClapperMprisTrack *) g_ptr_array_index (self->tracks, i);
+
+    if (track->art || track->art_cancellable) {
+      _track_take_art_sample (self, track, gst_sample_ref (track->art_sample));
+      clapper_mpris_refresh_track (self, track);
+    }
+  }
 }
 
 static void
@@ -1787,8 +2217,15 @@ clapper_mpris_init (ClapperMpris *self)
   self->tracks_skeleton = clapper_mpris_media_player2_track_list_skeleton_new ();
 
   self->tracks = g_ptr_array_new_with_free_func ((GDestroyNotify) clapper_mpris_track_free);
+  self->pending_tracks = g_ptr_array_new ();
+  self->exposed_tracks = g_ptr_array_new ();
+  self->arts = g_hash_table_new_full (g_str_hash, g_str_equal,
+      NULL, (GDestroyNotify) _mpris_art_free);
 
   self->queue_controllable = DEFAULT_QUEUE_CONTROLLABLE;
+  self->update_latency = DEFAULT_UPDATE_LATENCY;
+  self->track_list_window = DEFAULT_TRACK_LIST_WINDOW;
+  self->art_max_size = DEFAULT_ART_MAX_SIZE;
 
   g_signal_connect (self->player_skeleton, "handle-open-uri",
       G_CALLBACK (_handle_open_uri_cb), self);
@@ -1849,8 +2286,13 @@ clapper_mpris_finalize (GObject *object)
   g_object_unref (self->tracks_skeleton);
 
   self->current_track = NULL;
+  g_ptr_array_unref (self->pending_tracks);
+  g_ptr_array_unref (self->exposed_tracks);
   g_ptr_array_unref (self->tracks);
 
+  /* After tracks, as they release their arts */
+  g_hash_table_unref (self->arts);
+
   g_free (self->app_id);
   g_free (self->own_name);
   g_free (self->identity);
@@ -1892,6 +2334,15 @@ clapper_mpris_set_property (GObject *object, guint prop_id,
     case PROP_FALLBACK_ART_URL:
       clapper_mpris_set_fallback_art_url (self, g_value_get_string (value));
       break;
+    case PROP_UPDATE_LATENCY:
+      self->update_latency = g_value_get_uint (value);
+      break;
+    case PROP_TRACK_LIST_WINDOW:
+      clapper_mpris_set_track_list_window (self, g_value_get_uint (value));
+      break;
+    case PROP_ART_MAX_SIZE:
+      clapper_mpris_set_art_max_size (self, g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1923,6 +2374,15 @@ clapper_mpris_get_property (GObject *object, guint prop_id,
     case PROP_FALLBACK_ART_URL:
       g_value_set_string (value, self->fallback_art_url);
       break;
+    case PROP_UPDATE_LATENCY:
+      g_value_set_uint (value, self->update_latency);
+      break;
+    case PROP_TRACK_LIST_WINDOW:
+      g_value_set_uint (value, self->track_list_window);
+      break;
+    case PROP_ART_MAX_SIZE:
+      g_value_set_uint (value, self->art_max_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2016,6 +2476,54 @@ clapper_mpris_class_init (ClapperMprisClass *klass)
       NULL, NULL, NULL,
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
 
+  /**
+   * ClapperMpris:update-latency:
+   *
+   * Maximal time in milliseconds by which MPRIS updates can be delayed.
+   *
+   * Changes of metadata, track list and next/previous availability
+   * that happen within this time are merged and sent together,
+   * so bulk queue changes do not flood the session bus.
+   *
+   * Set to 0 to send them on the next main loop iteration.
+   */
+  param_specs[PROP_UPDATE_LATENCY] = g_param_spec_uint ("update-latency",
+      NULL, NULL, 0, 1000, DEFAULT_UPDATE_LATENCY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperMpris:track-list-window:
+   *
+   * Amount of tracks before and after current one exposed in MPRIS track list.
+   *
+   * With very large queues, exposing only tracks around currently played
+   * one keeps the amount of data sent on each queue change constant.
+   * Tracks entering and leaving the window are announced with
+   * "TrackAdded" and "TrackRemoved" signals.
+   *
+   * Set to 0 (default) to expose the whole queue.
+   */
+  param_specs[PROP_TRACK_LIST_WINDOW] = g_param_spec_uint ("track-list-window",
+      NULL, NULL, 0, 10000, DEFAULT_TRACK_LIST_WINDOW,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
+  /**
+   * ClapperMpris:art-max-size:
+   *
+   * Maximal width and height in pixels of artwork images exported
+   * from media data. Larger images are downscaled keeping aspect ratio.
+   *
+   * Only available when built with gdk-pixbuf, otherwise images
+   * are always exported in their original size.
+   *
+   * Changing it exports again artwork of all current tracks.
+   *
+   * Set to 0 (default) to disable downscaling.
+   */
+  param_specs[PROP_ART_MAX_SIZE] = g_param_spec_uint ("art-max-size",
+      NULL, NULL, 0, G_MAXUINT, DEFAULT_ART_MAX_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | CLAPPER_ENHANCER_PARAM_LOCAL);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, param_specs);
 }
 
@@ -0,0 +1,116 @@
+/* Clapper Enhancer Parser ASX
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <gmodule.h>
+#include <libpeas.h>
+#include <clapper/clapper.h>
+
+#include <gst/gst.h>
+#include <gst/tag/tag.h>
+
+#include "../utils/c/playlist/playlist-utils.h"
+
+#define GST_CAT_DEFAULT clapper_parser_asx_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+#define CLAPPER_TYPE_PARSER_ASX (clapper_parser_asx_get_type())
+#define CLAPPER_PARSER_ASX_CAST(obj) ((ClapperParserAsx *)(obj))
+G_DECLARE_FINAL_TYPE (ClapperParserAsx, clapper_parser_asx, CLAPPER, PARSER_ASX, GstObject);
+
+G_MODULE_EXPORT void peas_register_types (PeasObjectModule *module);
+
+struct _ClapperParserAsx
+{
+  GstObject parent;
+};
+
+static gboolean
+clapper_parser_asx_parse (ClapperPlaylistable *playlistable, GUri *uri, GBytes *bytes,
+    GListStore *playlist, GCancellable *cancellable, GError **error)
+{
+  ClapperParserAsx *self = CLAPPER_PARSER_ASX_CAST (playlistable);
+  PlaylistUtilsBatch *batch;
+  const gchar *data;
+  gsize data_size;
+  gboolean success;
+
+  GST_DEBUG_OBJECT (self, "Parse");
+
+  data = g_bytes_get_data (bytes, &data_size);
+  batch = playlist_utils_batch_new (uri, playlist);
+
+  success = playlist_utils_parse_asx (data, data_size,
+      (PlaylistUtilsEntryFunc) playlist_utils_batch_add_entry, batch,
+      cancellable, error);
+
+  if (success)
+    playlist_utils_batch_flush (batch);
+
+  playlist_utils_batch_free (batch);
+
+  GST_DEBUG_OBJECT (self, "Parsing %s", (success)
+      ? "succeeded"
+      : g_cancellable_is_cancelled (cancellable)
+      ? "cancelled"
+      : "failed");
+
+  return success;
+}
+
+static void
+clapper_parser_asx_playlistable_iface_init (ClapperPlaylistableInterface *iface)
+{
+  iface->parse = clapper_parser_asx_parse;
+}
+
+#define parent_class clapper_parser_asx_parent_class
+G_DEFINE_TYPE_WITH_CODE (ClapperParserAsx, clapper_parser_asx, GST_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE (CLAPPER_TYPE_PLAYLISTABLE, clapper_parser_asx_playlistable_iface_init));
+
+static void
+clapper_parser_asx_init (ClapperParserAsx *self)
+{
+}
+
+static void
+clapper_parser_asx_finalize (GObject *object)
+{
+  GST_TRACE_OBJECT (object, "Finalize");
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+clapper_parser_asx_class_init (ClapperParserAsxClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "clapperparserasx", 0,
+      "Clapper Parser ASX");
+
+  gobject_class->finalize = clapper_parser_asx_finalize;
+}
+
+void
+peas_register_types (PeasObjectModule *module)
+{
+  peas_object_module_register_extension_type (module, CLAPPER_TYPE_PLAYLISTABLE, CLAPPER_TYPE_PARSER_ASX);
+}
@@ -16,6 +16,8 @@
  * <https://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
+
 #include <glib.h>
 #include <glib-object.h>
 #include <gio/gio.h>
@@ -26,6 +28,11 @@
 #include <gst/gst.h>
 #include <gst/tag/tag.h>
 
+#include "../utils/c/playlist/playlist-utils.h"
+
+#define CACHE_MAX_ENTRY_SIZE (64 * 1024 * 1024)
+#define CACHE_MAX_TOTAL_SIZE (256 * 1024 * 1024)
+
 #define GST_CAT_DEFAULT clapper_parser_m3u_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
@@ -38,132 +45,67 @@ G_MODULE_EXPORT void peas_register_types (PeasObjectModule *module);
 struct _ClapperParserM3u
 {
   GstObject parent;
+
+  gchar *cache_dir;
 };
 
-static GstTagList *
-_parse_extinf_data (ClapperParserM3u *self, const gchar *ptr, gsize len)
+static gboolean
+clapper_parser_m3u_parse (ClapperPlaylistable *playlistable, GUri *uri, GBytes *bytes,
+    GListStore *playlist, GCancellable *cancellable, GError **error)
 {
-  GstTagList *tags = NULL;
-  gchar *line, *dur_end = NULL;
-  gdouble duration;
-
-  line = g_strndup (ptr, len);
-  GST_DEBUG_OBJECT (self, "Parsing line: %s", line);
+  ClapperParserM3u *self = CLAPPER_PARSER_M3U_CAST (playlistable);
+  PlaylistUtilsBatch *batch;
+  const gchar *data;
+  gchar *cache_key = NULL;
+  gsize data_size;
+  gboolean success = FALSE;
 
-  /* Read after length of "#EXTINF:" */
-  duration = g_ascii_strtod (line + 8, &dur_end);
+  GST_DEBUG_OBJECT (self, "Parse");
 
-  if (duration > 0) {
-    GST_DEBUG_OBJECT (self, "Found duration: %" CLAPPER_TIME_FORMAT,
-        CLAPPER_TIME_ARGS (duration));
-    tags = gst_tag_list_new (
-        GST_TAG_DURATION, (guint64) (duration * GST_SECOND), NULL);
-  }
-  if (dur_end && *dur_end != '\0') {
-    const gchar *title = dur_end + 1;
+  data = g_bytes_get_data (bytes, &data_size);
 
-    if (*title != '\0') {
-      GST_DEBUG_OBJECT (self, "Found title: %s", title);
+  /* Big playlists are often reloaded unchanged, try to skip parsing them */
+  if (data_size >= PLAYLIST_UTILS_CACHE_MIN_DATA_SIZE) {
+    cache_key = playlist_utils_cache_make_key (uri, bytes);
+    GST_DEBUG_OBJECT (self, "Playlist cache key: %s", cache_key);
 
-      if (!tags)
-        tags = gst_tag_list_new_empty ();
+    if (playlist_utils_cache_restore (self->cache_dir, cache_key, uri, playlist, cancellable)) {
+      GST_DEBUG_OBJECT (self, "Parsing skipped, restored from cache");
+      g_free (cache_key);
 
-      gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
-          GST_TAG_TITLE, title, NULL);
+      return TRUE;
     }
-  }
-
-  g_free (line);
+    if (g_cancellable_is_cancelled (cancellable)) {
+      GST_DEBUG_OBJECT (self, "Parsing cancelled");
+      g_free (cache_key);
 
-  if (tags)
-    gst_tag_list_set_scope (tags, GST_TAG_SCOPE_GLOBAL);
-
-  return tags;
-}
-
-static ClapperMediaItem *
-_parse_uri_data (ClapperParserM3u *self, GUri *uri, const gchar *ptr, gsize len, GError **error)
-{
-  ClapperMediaItem *item = NULL;
-  gchar *line = g_strndup (ptr, len);
-
-  GST_DEBUG_OBJECT (self, "Parsing line: %s", line);
-
-  if (gst_uri_is_valid (line)) {
-    GST_DEBUG_OBJECT (self, "Found URI: %s", line);
-    item = clapper_media_item_new (line);
-  } else {
-    gchar *base_uri, *res_uri;
-
-    base_uri = g_uri_to_string (uri);
-    res_uri = g_uri_resolve_relative (base_uri, line, G_URI_FLAGS_ENCODED, error);
-    g_free (base_uri);
-
-    if (res_uri) {
-      GST_DEBUG_OBJECT (self, "Resolved URI: %s", res_uri);
-      item = clapper_media_item_new (res_uri);
-      g_free (res_uri);
+      return FALSE;
     }
   }
 
-  g_free (line);
+  batch = playlist_utils_batch_new (uri, playlist);
+  playlist_utils_batch_set_recording (batch, cache_key != NULL);
 
-  return item;
-}
+  success = playlist_utils_parse_m3u (data, data_size,
+      (PlaylistUtilsEntryFunc) playlist_utils_batch_add_entry, batch,
+      cancellable, error);
 
-static gboolean
-clapper_parser_m3u_parse (ClapperPlaylistable *playlistable, GUri *uri, GBytes *bytes,
-    GListStore *playlist, GCancellable *cancellable, GError **error)
-{
-  ClapperParserM3u *self = CLAPPER_PARSER_M3U_CAST (playlistable);
-  GstTagList *tags = NULL;
-  const gchar *ptr, *end;
-  gsize data_size;
-  gboolean success = FALSE;
+  if (success) {
+    playlist_utils_batch_flush (batch);
 
-  GST_DEBUG_OBJECT (self, "Parse");
+    if (cache_key) {
+      GError *cache_error = NULL;
 
-  ptr = g_bytes_get_data (bytes, &data_size);
-  end = ptr + data_size;
-
-  while (ptr < end) {
-    const gchar *nl = memchr (ptr, '\n', end - ptr);
-    gsize len = nl ? nl - ptr : end - ptr;
-
-    switch (ptr[0]) {
-      case '#':
-        if (g_str_has_prefix (ptr, "#EXTINF:"))
-          gst_tag_list_replace (&tags, _parse_extinf_data (self, ptr, len));
-        break;
-      case '\0':
-      case '\n':
-      case ' ':
-        break;
-      default:{
-        ClapperMediaItem *item;
-        if ((item = _parse_uri_data (self, uri, ptr, len, error))) {
-          if (tags) {
-            clapper_media_item_populate_tags (item, tags);
-            gst_clear_tag_list (&tags);
-          }
-          g_list_store_append (playlist, (GObject *) item);
-          gst_object_unref (item);
-          success = TRUE;
-        }
-        break;
+      if (!playlist_utils_cache_store (self->cache_dir, cache_key, batch,
+          CACHE_MAX_ENTRY_SIZE, CACHE_MAX_TOTAL_SIZE, &cache_error)) {
+        GST_WARNING_OBJECT (self, "Could not store playlist cache: %s", cache_error->message);
+        g_error_free (cache_error);
       }
     }
-
-    if (G_UNLIKELY (*error != NULL) || g_cancellable_is_cancelled (cancellable)) {
-      success = FALSE;
-      break;
-    }
-
-    /* Advance to the next line */
-    ptr = nl ? (nl + 1) : end;
   }
 
-  gst_clear_tag_list (&tags);
+  playlist_utils_batch_free (batch);
+  g_free (cache_key);
 
   GST_DEBUG_OBJECT (self, "Parsing %s", (success)
       ? "succeeded"
@@ -187,12 +129,18 @@ G_DEFINE_TYPE_WITH_CODE (ClapperParserM3u, clapper_parser_m3u, GST_TYPE_OBJECT,
 static void
 clapper_parser_m3u_init (ClapperParserM3u *self)
 {
+  self->cache_dir = g_build_filename (g_get_user_cache_dir (),
+      CLAPPER_API_NAME, "enhancers", "clapper-parser-m3u", NULL);
 }
 
 static void
 clapper_parser_m3u_finalize (GObject *object)
 {
-  GST_TRACE_OBJECT (object, "Finalize");
+  ClapperParserM3u *self = CLAPPER_PARSER_M3U_CAST (object);
+
+  GST_TRACE_OBJECT (self, "Finalize");
+
+  g_free (self->cache_dir);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
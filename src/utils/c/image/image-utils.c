@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "image-utils.h"
+
+#define JPEG_QUALITY "85"
+
+/*
+ * Downscales encoded image, so its larger dimension fits into @max_size
+ * keeping aspect ratio. Images with alpha channel are encoded as PNG,
+ * others as JPEG. Returns %NULL without setting @error when image
+ * is already small enough, as it is never upscaled.
+ */
+GBytes *
+image_utils_downscale (const guint8 *data, gsize size, guint max_size,
+    const gchar **content_type, GError **error)
+{
+  GdkPixbufLoader *loader = gdk_pixbuf_loader_new ();
+  GdkPixbuf *pixbuf, *scaled = NULL;
+  GBytes *bytes = NULL;
+  gchar *buf = NULL;
+  gsize buf_size = 0;
+  gint width, height;
+  gdouble scale;
+  gboolean has_alpha;
+
+  if (!gdk_pixbuf_loader_write (loader, data, size, error)
+      || !gdk_pixbuf_loader_close (loader, error))
+    goto finish;
+
+  pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+
+  /* Never upscale */
+  if ((guint) MAX (width, height) <= max_size)
+    goto finish;
+
+  scale = (gdouble) max_size / MAX (width, height);
+  scaled = gdk_pixbuf_scale_simple (pixbuf,
+      MAX (width * scale, 1), MAX (height * scale, 1), GDK_INTERP_BILINEAR);
+
+  if ((has_alpha = gdk_pixbuf_get_has_alpha (scaled))) {
+    gdk_pixbuf_save_to_buffer (scaled, &buf, &buf_size, "png", error, NULL);
+  } else {
+    gdk_pixbuf_save_to_buffer (scaled, &buf, &buf_size, "jpeg", error,
+        "quality", JPEG_QUALITY, NULL);
+  }
+
+  if (buf) {
+    bytes = g_bytes_new_take (buf, buf_size);
+
+    if (content_type)
+      *content_type = (has_alpha) ? "image/png" : "image/jpeg";
+  }
+
+finish:
+  g_clear_object (&scaled);
+  g_object_unref (loader);
+
+  return bytes;
+}
@@ -0,0 +1,1527 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <glib/gstdio.h>
+
+#include "playlist-utils.h"
+
+/* Cache file layout (little endian):
+ * header: magic[4], version (u32), n_entries (u32)
+ * entry: uri_len (u32), uri, title_len (u32), title, duration_ns (u64) */
+#define CACHE_MAGIC "CPLC"
+#define CACHE_VERSION 2
+#define CACHE_HEADER_SIZE 12
+#define CACHE_FILE_SUFFIX ".cache"
+
+/* Shortest possible PLS entry is "FileN=x" */
+#define PLS_MIN_ENTRY_LENGTH 7
+
+/* Amount of data fed into markup parser between cancellation checks */
+#define MARKUP_CHUNK_SIZE (64 * 1024)
+
+struct _PlaylistUtilsBatch
+{
+  GListStore *playlist;
+  gchar *base_uri;
+
+  GPtrArray *pending;
+  guint n_entries;
+
+  /* Serialized entries for cache, %NULL when not recording */
+  GByteArray *record;
+};
+
+PlaylistUtilsBatch *
+playlist_utils_batch_new (GUri *uri, GListStore *playlist)
+{
+  PlaylistUtilsBatch *batch = g_new0 (PlaylistUtilsBatch, 1);
+
+  batch->playlist = g_object_ref (playlist);
+  batch->base_uri = g_uri_to_string (uri);
+  batch->pending = g_ptr_array_new_full (PLAYLIST_UTILS_BATCH_SIZE,
+      (GDestroyNotify) gst_object_unref);
+
+  return batch;
+}
+
+gchar *
+playlist_utils_resolve_uri (const gchar *base_uri, const gchar *location, gssize len, GError **error)
+{
+  gchar *line, *res_uri;
+
+  line = (len < 0) ? g_strdup (location) : g_strndup (location, len);
+
+  if (gst_uri_is_valid (line))
+    return line;
+
+  res_uri = g_uri_resolve_relative (base_uri, line, G_URI_FLAGS_ENCODED, error);
+  g_free (line);
+
+  return res_uri;
+}
+
+static inline void
+_batch_take_item (PlaylistUtilsBatch *batch, ClapperMediaItem *item)
+{
+  g_ptr_array_add (batch->pending, item);
+  batch->n_entries++;
+
+  if (batch->pending->len >= PLAYLIST_UTILS_BATCH_SIZE)
+    playlist_utils_batch_flush (batch);
+}
+
+static inline void
+_record_uint32 (GByteArray *record, guint32 val)
+{
+  val = GUINT32_TO_LE (val);
+  g_byte_array_append (record, (const guint8 *) &val, sizeof (val));
+}
+
+static inline void
+_record_uint64 (GByteArray *record, guint64 val)
+{
+  val = GUINT64_TO_LE (val);
+  g_byte_array_append (record, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+_record_entry (GByteArray *record, const gchar *uri, GstTagList *tags)
+{
+  const gchar *title = NULL;
+  guint64 duration = 0;
+  gsize len;
+
+  if (tags) {
+    gst_tag_list_peek_string_index (tags, GST_TAG_TITLE, 0, &title);
+    gst_tag_list_get_uint64 (tags, GST_TAG_DURATION, &duration);
+  }
+
+  len = strlen (uri);
+  _record_uint32 (record, len);
+  g_byte_array_append (record, (const guint8 *) uri, len);
+
+  len = (title) ? strlen (title) : 0;
+  _record_uint32 (record, len);
+  if (len > 0)
+    g_byte_array_append (record, (const guint8 *) title, len);
+
+  _record_uint64 (record, duration);
+}
+
+/*
+ * Creates media item from location (resolved against playlist URI
+ * when relative) and queues it for insertion into the playlist.
+ *
+ * Optional tags are populated into the item, they should be of a global scope.
+ */
+gboolean
+playlist_utils_batch_add_entry (PlaylistUtilsBatch *batch, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  ClapperMediaItem *item;
+  gchar *uri;
+
+  if (!(uri = playlist_utils_resolve_uri (batch->base_uri, location, len, error)))
+    return FALSE;
+
+  item = clapper_media_item_new (uri);
+
+  if (tags)
+    clapper_media_item_populate_tags (item, tags);
+
+  if (batch->record)
+    _record_entry (batch->record, uri, tags);
+
+  g_free (uri);
+  _batch_take_item (batch, item);
+
+  return TRUE;
+}
+
+void
+playlist_utils_batch_flush (PlaylistUtilsBatch *batch)
+{
+  if (batch->pending->len == 0)
+    return;
+
+  g_list_store_splice (batch->playlist,
+      g_list_model_get_n_items (G_LIST_MODEL (batch->playlist)), 0,
+      batch->pending->pdata, batch->pending->len);
+  g_ptr_array_set_size (batch->pending, 0);
+}
+
+/*
+ * Enables serialization of added entries, so they
+ * can be later stored with playlist_utils_cache_store().
+ */
+void
+playlist_utils_batch_set_recording (PlaylistUtilsBatch *batch, gboolean recording)
+{
+  if (recording && !batch->record) {
+    batch->record = g_byte_array_new ();
+  } else if (!recording && batch->record) {
+    g_byte_array_unref (batch->record);
+    batch->record = NULL;
+  }
+}
+
+guint
+playlist_utils_batch_get_n_entries (PlaylistUtilsBatch *batch)
+{
+  return batch->n_entries;
+}
+
+/*
+ * Frees batch, entries that were not flushed yet are discarded.
+ */
+void
+playlist_utils_batch_free (PlaylistUtilsBatch *batch)
+{
+  g_object_unref (batch->playlist);
+  g_free (batch->base_uri);
+  g_ptr_array_unref (batch->pending);
+
+  if (batch->record)
+    g_byte_array_unref (batch->record);
+
+  g_free (batch);
+}
+
+/*
+ * Parses "[[hh:]mm:]ss[.fff]" time format into seconds.
+ */
+gboolean
+playlist_utils_parse_clock_time (const gchar *text, gdouble *seconds)
+{
+  gdouble total = 0;
+  guint n_parts = 0;
+
+  while (TRUE) {
+    gchar *end = NULL;
+    gdouble val = g_ascii_strtod (text, &end);
+
+    if (end == text || val < 0 || ++n_parts > 3)
+      return FALSE;
+
+    total = total * 60 + val;
+
+    if (*end == ':') {
+      text = end + 1;
+      continue;
+    }
+    if (*end != '\0')
+      return FALSE;
+
+    break;
+  }
+
+  *seconds = total;
+
+  return TRUE;
+}
+
+/* Finds title separator, skipping over commas within quoted attributes */
+static const gchar *
+_find_extinf_comma (const gchar *str, const gchar *end)
+{
+  gboolean quoted = FALSE;
+
+  for (; str < end; ++str) {
+    if (*str == '"')
+      quoted = !quoted;
+    else if (*str == ',' && !quoted)
+      return str;
+  }
+
+  return NULL;
+}
+
+static GstTagList *
+_parse_extinf (const gchar *line, gsize len)
+{
+  GstTagList *tags = NULL;
+  const gchar *end = line + len, *comma;
+  gchar *dur_str, *dur_end = NULL;
+  gdouble duration;
+  gsize dur_len;
+
+  /* Skip "#EXTINF:", caller ensures that line starts with it */
+  line += 8;
+
+  /* Duration is only read up to the first comma, so
+   * strtod never sees data past the end of line */
+  comma = _find_extinf_comma (line, end);
+  dur_len = ((comma) ? comma : end) - line;
+
+  dur_str = g_strndup (line, MIN (dur_len, 64));
+  duration = g_ascii_strtod (dur_str, &dur_end);
+
+  /* Also rejects NaN and values that would overflow clock time */
+  if (dur_end != dur_str && duration > 0
+      && duration < (gdouble) (G_MAXUINT64 / GST_SECOND)) {
+    tags = gst_tag_list_new (
+        GST_TAG_DURATION, (guint64) (duration * GST_SECOND), NULL);
+  }
+  g_free (dur_str);
+
+  if (comma) {
+    const gchar *title = comma + 1;
+    gsize title_len = end - title;
+
+    while (title_len > 0 && g_ascii_isspace (title[0])) {
+      title++;
+      title_len--;
+    }
+
+    /* Title might also be empty due to embedded NUL */
+    if (title_len > 0 && title[0] != '\0') {
+      gchar *title_str = g_strndup (title, title_len);
+
+      if (!tags)
+        tags = gst_tag_list_new_empty ();
+
+      gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+          GST_TAG_TITLE, title_str, NULL);
+      g_free (title_str);
+    }
+  }
+
+  if (tags)
+    gst_tag_list_set_scope (tags, GST_TAG_SCOPE_GLOBAL);
+
+  return tags;
+}
+
+/*
+ * Parses M3U/M3U8 playlist data, calling @func for each
+ * found location together with tags from its "#EXTINF" line.
+ *
+ * Data does not have to be NUL terminated. UTF-8 BOM, CRLF
+ * line endings and surrounding whitespaces are handled.
+ *
+ * Returns %TRUE if at least one entry was accepted. Stops at
+ * first error set by @func or when @cancellable is cancelled.
+ */
+gboolean
+playlist_utils_parse_m3u (const gchar *data, gsize size, PlaylistUtilsEntryFunc func,
+    gpointer user_data, GCancellable *cancellable, GError **error)
+{
+  const gchar *ptr = data, *end = data + size;
+  GstTagList *tags = NULL;
+  GError *my_error = NULL;
+  gboolean success = FALSE;
+
+  /* Skip UTF-8 BOM */
+  if (size >= 3 && memcmp (ptr, "\xEF\xBB\xBF", 3) == 0)
+    ptr += 3;
+
+  while (ptr < end) {
+    const gchar *nl = memchr (ptr, '\n', end - ptr);
+    const gchar *line = ptr;
+    gsize len = nl ? nl - ptr : end - ptr;
+
+    /* Advance to the next line, data is not NUL terminated,
+     * so from now on only "line" within "len" can be read */
+    ptr = nl ? (nl + 1) : end;
+
+    /* Trim whitespaces, including CR from CRLF line endings */
+    while (len > 0 && g_ascii_isspace (line[len - 1]))
+      len--;
+    while (len > 0 && g_ascii_isspace (line[0])) {
+      line++;
+      len--;
+    }
+
+    if (len == 0)
+      continue;
+
+    switch (line[0]) {
+      case '#':
+        if (len >= 8 && memcmp (line, "#EXTINF:", 8) == 0)
+          gst_tag_list_replace (&tags, _parse_extinf (line, len));
+        break;
+      case '\0':
+        break;
+      default:
+        if (func (user_data, line, len, tags, &my_error))
+          success = TRUE;
+        gst_clear_tag_list (&tags);
+        break;
+    }
+
+    if (G_UNLIKELY (my_error != NULL) || g_cancellable_is_cancelled (cancellable)) {
+      success = FALSE;
+      break;
+    }
+  }
+
+  gst_clear_tag_list (&tags);
+
+  if (my_error)
+    g_propagate_error (error, my_error);
+
+  return success;
+}
+
+static inline gboolean
+_skip_bom (const gchar **ptr, gsize *size)
+{
+  if (*size < 3 || memcmp (*ptr, "\xEF\xBB\xBF", 3) != 0)
+    return FALSE;
+
+  *ptr += 3;
+  *size -= 3;
+
+  return TRUE;
+}
+
+/* Values point directly into parsed data */
+typedef struct
+{
+  const gchar *file;
+  gsize file_len;
+  const gchar *title;
+  gsize title_len;
+  gint64 length;
+} PlsEntry;
+
+typedef enum
+{
+  PLS_KEY_UNKNOWN = 0,
+  PLS_KEY_FILE,
+  PLS_KEY_TITLE,
+  PLS_KEY_LENGTH
+} PlsKey;
+
+static inline gboolean
+_read_key_prefix (const gchar **ptr, gsize *len, const gchar *prefix, gsize prefix_len)
+{
+  if (*len <= prefix_len || g_ascii_strncasecmp (*ptr, prefix, prefix_len) != 0)
+    return FALSE;
+
+  *ptr += prefix_len;
+  *len -= prefix_len;
+
+  return TRUE;
+}
+
+static PlsKey
+_parse_pls_key (const gchar *ptr, gsize len, guint *index)
+{
+  PlsKey key;
+  guint64 val = 0;
+  gsize i;
+
+  if (_read_key_prefix (&ptr, &len, "File", 4))
+    key = PLS_KEY_FILE;
+  else if (_read_key_prefix (&ptr, &len, "Title", 5))
+    key = PLS_KEY_TITLE;
+  else if (_read_key_prefix (&ptr, &len, "Length", 6))
+    key = PLS_KEY_LENGTH;
+  else
+    return PLS_KEY_UNKNOWN;
+
+  /* Remaining part must be entry number */
+  for (i = 0; i < len; ++i) {
+    if (!g_ascii_isdigit (ptr[i]) || val > G_MAXUINT / 10)
+      return PLS_KEY_UNKNOWN;
+
+    val = val * 10 + (ptr[i] - '0');
+  }
+
+  if (val == 0 || val > G_MAXUINT)
+    return PLS_KEY_UNKNOWN;
+
+  *index = (guint) val;
+
+  return key;
+}
+
+static void
+_store_pls_line (GArray *entries, guint max_entries, const gchar *ptr, gsize len)
+{
+  PlsEntry *entry;
+  PlsKey key;
+  const gchar *eq, *val;
+  gsize key_len, val_len;
+  guint index = 0;
+
+  if (!(eq = memchr (ptr, '=', len)))
+    return;
+
+  key_len = eq - ptr;
+  val = eq + 1;
+  val_len = len - key_len - 1;
+
+  /* Trim whitespaces around key and value */
+  while (key_len > 0 && g_ascii_isspace (ptr[key_len - 1]))
+    key_len--;
+  while (val_len > 0 && g_ascii_isspace (*val)) {
+    val++;
+    val_len--;
+  }
+  while (val_len > 0 && g_ascii_isspace (val[val_len - 1]))
+    val_len--;
+
+  /* Out of range numbers can not belong to any entry */
+  if ((key = _parse_pls_key (ptr, key_len, &index)) == PLS_KEY_UNKNOWN
+      || index > max_entries)
+    return;
+
+  if (index > entries->len)
+    g_array_set_size (entries, index);
+
+  entry = &g_array_index (entries, PlsEntry, index - 1);
+
+  switch (key) {
+    case PLS_KEY_FILE:
+      entry->file = val;
+      entry->file_len = val_len;
+      break;
+    case PLS_KEY_TITLE:
+      entry->title = val;
+      entry->title_len = val_len;
+      break;
+    case PLS_KEY_LENGTH:{
+      gchar *str = g_strndup (val, val_len);
+      entry->length = g_ascii_strtoll (str, NULL, 10);
+      g_free (str);
+      break;
+    }
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+static GstTagList *
+_make_pls_entry_tags (PlsEntry *entry)
+{
+  GstTagList *tags = NULL;
+
+  /* Negative length means live stream. Also rejects
+   * values that would overflow clock time. */
+  if (entry->length > 0 && (guint64) entry->length < G_MAXUINT64 / GST_SECOND) {
+    tags = gst_tag_list_new (
+        GST_TAG_DURATION, (guint64) (entry->length * GST_SECOND), NULL);
+  }
+  if (entry->title_len > 0) {
+    gchar *title = g_strndup (entry->title, entry->title_len);
+
+    if (!tags)
+      tags = gst_tag_list_new_empty ();
+
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_TITLE, title, NULL);
+    g_free (title);
+  }
+
+  if (tags)
+    gst_tag_list_set_scope (tags, GST_TAG_SCOPE_GLOBAL);
+
+  return tags;
+}
+
+/*
+ * Parses PLS playlist data, calling @func for each "FileN"
+ * location in order of entry numbers, together with tags
+ * from its "TitleN" and "LengthN" keys.
+ *
+ * Data does not have to be NUL terminated. UTF-8 BOM, CRLF
+ * line endings and case of keys are handled.
+ *
+ * Returns %TRUE if at least one entry was accepted. Stops at
+ * first error set by @func or when @cancellable is cancelled.
+ */
+gboolean
+playlist_utils_parse_pls (const gchar *data, gsize size, PlaylistUtilsEntryFunc func,
+    gpointer user_data, GCancellable *cancellable, GError **error)
+{
+  const gchar *ptr = data, *end;
+  GArray *entries;
+  GError *my_error = NULL;
+  guint i, max_entries;
+  gboolean success = FALSE;
+
+  _skip_bom (&ptr, &size);
+  end = ptr + size;
+
+  /* Entries are numbered and do not have to be in order,
+   * so gather them all first, then pass them sorted */
+  max_entries = MIN (size / PLS_MIN_ENTRY_LENGTH + 1, G_MAXUINT);
+  entries = g_array_new (FALSE, TRUE, sizeof (PlsEntry));
+
+  while (ptr < end) {
+    const gchar *nl = memchr (ptr, '\n', end - ptr);
+    const gchar *line = ptr;
+    gsize len = nl ? nl - ptr : end - ptr;
+
+    /* Advance to the next line, data is not NUL terminated,
+     * so from now on only "line" within "len" can be read */
+    ptr = nl ? (nl + 1) : end;
+
+    /* Handle CRLF line endings */
+    if (len > 0 && line[len - 1] == '\r')
+      len--;
+
+    if (len == 0)
+      continue;
+
+    switch (line[0]) {
+      case '[':
+      case ';':
+      case '#':
+      case '\0':
+        break;
+      default:
+        _store_pls_line (entries, max_entries, line, len);
+        break;
+    }
+
+    if (g_cancellable_is_cancelled (cancellable))
+      goto finish;
+  }
+
+  for (i = 0; i < entries->len; ++i) {
+    PlsEntry *entry = &g_array_index (entries, PlsEntry, i);
+    GstTagList *tags;
+
+    /* Skip missing numbers */
+    if (entry->file_len == 0)
+      continue;
+
+    tags = _make_pls_entry_tags (entry);
+
+    if (func (user_data, entry->file, entry->file_len, tags, &my_error))
+      success = TRUE;
+
+    gst_clear_tag_list (&tags);
+
+    if (G_UNLIKELY (my_error != NULL) || g_cancellable_is_cancelled (cancellable)) {
+      success = FALSE;
+      break;
+    }
+  }
+
+finish:
+  g_array_unref (entries);
+
+  if (my_error)
+    g_propagate_error (error, my_error);
+
+  return success;
+}
+
+/* Feeds data in chunks, so cancellation can be checked in between */
+static gboolean
+_parse_markup (const GMarkupParser *parser, gpointer user_data,
+    const gchar *data, gsize size, GCancellable *cancellable, GError **error)
+{
+  GMarkupParseContext *context;
+  const gchar *ptr = data, *end = data + size;
+  gboolean success = TRUE;
+
+  context = g_markup_parse_context_new (parser,
+      G_MARKUP_TREAT_CDATA_AS_TEXT, user_data, NULL);
+
+  while (success && ptr < end) {
+    gsize len = MIN ((gsize) (end - ptr), MARKUP_CHUNK_SIZE);
+
+    success = (g_markup_parse_context_parse (context, ptr, len, error)
+        && !g_cancellable_is_cancelled (cancellable));
+    ptr += len;
+  }
+
+  if (success)
+    success = g_markup_parse_context_end_parse (context, error);
+
+  g_markup_parse_context_free (context);
+
+  return success;
+}
+
+typedef enum
+{
+  XSPF_FIELD_NONE = 0,
+  XSPF_FIELD_LOCATION,
+  XSPF_FIELD_TITLE,
+  XSPF_FIELD_CREATOR,
+  XSPF_FIELD_ALBUM,
+  XSPF_FIELD_DURATION
+} XspfField;
+
+typedef struct
+{
+  PlaylistUtilsEntryFunc func;
+  gpointer user_data;
+  gboolean accepted;
+
+  gboolean in_track;
+  XspfField field;
+  GString *text;
+
+  /* Current track data */
+  gchar *location;
+  gchar *title;
+  gchar *creator;
+  gchar *album;
+  guint64 duration_ms;
+} XspfData;
+
+static void
+_reset_xspf_track (XspfData *data)
+{
+  g_clear_pointer (&data->location, g_free);
+  g_clear_pointer (&data->title, g_free);
+  g_clear_pointer (&data->creator, g_free);
+  g_clear_pointer (&data->album, g_free);
+  data->duration_ms = 0;
+}
+
+static inline gboolean
+_xspf_parent_is_track (GMarkupParseContext *context)
+{
+  const GSList *stack = g_markup_parse_context_get_element_stack (context);
+
+  /* First element in stack is the current one */
+  return (stack && stack->next && strcmp (stack->next->data, "track") == 0);
+}
+
+static XspfField
+_get_xspf_track_field (const gchar *element_name)
+{
+  if (strcmp (element_name, "location") == 0)
+    return XSPF_FIELD_LOCATION;
+  if (strcmp (element_name, "title") == 0)
+    return XSPF_FIELD_TITLE;
+  if (strcmp (element_name, "creator") == 0)
+    return XSPF_FIELD_CREATOR;
+  if (strcmp (element_name, "album") == 0)
+    return XSPF_FIELD_ALBUM;
+  if (strcmp (element_name, "duration") == 0)
+    return XSPF_FIELD_DURATION;
+
+  return XSPF_FIELD_NONE;
+}
+
+static GstTagList *
+_make_xspf_track_tags (XspfData *data)
+{
+  GstTagList *tags = gst_tag_list_new_empty ();
+
+  /* Also rejects values that would overflow clock time */
+  if (data->duration_ms > 0 && data->duration_ms < G_MAXUINT64 / GST_MSECOND) {
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_DURATION, (guint64) (data->duration_ms * GST_MSECOND), NULL);
+  }
+  if (data->title) {
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_TITLE, data->title, NULL);
+  }
+  if (data->creator) {
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_ARTIST, data->creator, NULL);
+  }
+  if (data->album) {
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_ALBUM, data->album, NULL);
+  }
+
+  if (gst_tag_list_is_empty (tags)) {
+    gst_tag_list_unref (tags);
+    return NULL;
+  }
+
+  gst_tag_list_set_scope (tags, GST_TAG_SCOPE_GLOBAL);
+
+  return tags;
+}
+
+static void
+_xspf_start_element_cb (GMarkupParseContext *context, const gchar *element_name,
+    const gchar **attribute_names, const gchar **attribute_values,
+    gpointer user_data, GError **error)
+{
+  XspfData *data = (XspfData *) user_data;
+
+  if (strcmp (element_name, "track") == 0) {
+    _reset_xspf_track (data);
+    data->in_track = TRUE;
+    return;
+  }
+
+  if (data->in_track && data->field == XSPF_FIELD_NONE && _xspf_parent_is_track (context)) {
+    data->field = _get_xspf_track_field (element_name);
+    g_string_truncate (data->text, 0);
+  }
+}
+
+static void
+_xspf_end_element_cb (GMarkupParseContext *context, const gchar *element_name,
+    gpointer user_data, GError **error)
+{
+  XspfData *data = (XspfData *) user_data;
+
+  if (data->field != XSPF_FIELD_NONE && data->field == _get_xspf_track_field (element_name)) {
+    gchar *value = g_strstrip (g_strndup (data->text->str, data->text->len));
+
+    if (*value == '\0') {
+      g_free (value);
+      value = NULL;
+    }
+
+    switch (data->field) {
+      case XSPF_FIELD_LOCATION:
+        /* Only first location is used, others are alternatives */
+        if (!data->location)
+          data->location = g_steal_pointer (&value);
+        break;
+      case XSPF_FIELD_TITLE:
+        g_free (data->title);
+        data->title = g_steal_pointer (&value);
+        break;
+      case XSPF_FIELD_CREATOR:
+        g_free (data->creator);
+        data->creator = g_steal_pointer (&value);
+        break;
+      case XSPF_FIELD_ALBUM:
+        g_free (data->album);
+        data->album = g_steal_pointer (&value);
+        break;
+      case XSPF_FIELD_DURATION:
+        if (value)
+          data->duration_ms = g_ascii_strtoull (value, NULL, 10);
+        break;
+      default:
+        g_assert_not_reached ();
+        break;
+    }
+
+    g_free (value);
+    data->field = XSPF_FIELD_NONE;
+
+    return;
+  }
+
+  if (data->in_track && strcmp (element_name, "track") == 0) {
+    data->in_track = FALSE;
+
+    if (data->location) {
+      GstTagList *tags = _make_xspf_track_tags (data);
+
+      if (data->func (data->user_data, data->location, -1, tags, error))
+        data->accepted = TRUE;
+
+      if (tags)
+        gst_tag_list_unref (tags);
+    }
+
+    _reset_xspf_track (data);
+  }
+}
+
+static void
+_xspf_text_cb (GMarkupParseContext *context, const gchar *text, gsize text_len,
+    gpointer user_data, GError **error)
+{
+  XspfData *data = (XspfData *) user_data;
+
+  if (data->field != XSPF_FIELD_NONE)
+    g_string_append_len (data->text, text, text_len);
+}
+
+static const GMarkupParser xspf_parser = {
+  .start_element = _xspf_start_element_cb,
+  .end_element = _xspf_end_element_cb,
+  .text = _xspf_text_cb,
+};
+
+/*
+ * Parses XSPF playlist data, calling @func for the first
+ * location of each track together with its tags.
+ *
+ * Data does not have to be NUL terminated. UTF-8 BOM, which
+ * GMarkup does not accept, is skipped.
+ *
+ * Returns %TRUE if at least one entry was accepted. Stops at
+ * first error set by @func or when @cancellable is cancelled.
+ */
+gboolean
+playlist_utils_parse_xspf (const gchar *data, gsize size, PlaylistUtilsEntryFunc func,
+    gpointer user_data, GCancellable *cancellable, GError **error)
+{
+  XspfData xspf_data = { 0, };
+  gboolean success;
+
+  xspf_data.func = func;
+  xspf_data.user_data = user_data;
+  xspf_data.text = g_string_new (NULL);
+
+  _skip_bom (&data, &size);
+
+  success = (_parse_markup (&xspf_parser, &xspf_data, data, size, cancellable, error)
+      && xspf_data.accepted);
+
+  g_string_free (xspf_data.text, TRUE);
+  _reset_xspf_track (&xspf_data);
+
+  return success;
+}
+
+typedef enum
+{
+  ASX_FIELD_NONE = 0,
+  ASX_FIELD_TITLE,
+  ASX_FIELD_AUTHOR
+} AsxField;
+
+typedef struct
+{
+  PlaylistUtilsEntryFunc func;
+  gpointer user_data;
+  gboolean accepted;
+
+  gboolean in_entry;
+  AsxField field;
+  GString *text;
+
+  /* Current entry data */
+  gchar *ref;
+  gchar *title;
+  gchar *author;
+  gdouble duration;
+} AsxData;
+
+static void
+_reset_asx_entry (AsxData *data)
+{
+  g_clear_pointer (&data->ref, g_free);
+  g_clear_pointer (&data->title, g_free);
+  g_clear_pointer (&data->author, g_free);
+  data->duration = 0;
+}
+
+/* ASX element and attribute names are case insensitive */
+static inline gboolean
+_asx_name_is (const gchar *name, const gchar *expected)
+{
+  return (g_ascii_strcasecmp (name, expected) == 0);
+}
+
+static const gchar *
+_get_asx_attribute (const gchar **attribute_names, const gchar **attribute_values, const gchar *name)
+{
+  guint i;
+
+  for (i = 0; attribute_names[i] != NULL; ++i) {
+    if (_asx_name_is (attribute_names[i], name))
+      return attribute_values[i];
+  }
+
+  return NULL;
+}
+
+static inline gboolean
+_asx_parent_is_entry (GMarkupParseContext *context)
+{
+  const GSList *stack = g_markup_parse_context_get_element_stack (context);
+
+  /* First element in stack is the current one */
+  return (stack && stack->next && _asx_name_is (stack->next->data, "entry"));
+}
+
+static AsxField
+_get_asx_entry_field (const gchar *element_name)
+{
+  if (_asx_name_is (element_name, "title"))
+    return ASX_FIELD_TITLE;
+  if (_asx_name_is (element_name, "author"))
+    return ASX_FIELD_AUTHOR;
+
+  return ASX_FIELD_NONE;
+}
+
+static GstTagList *
+_make_asx_entry_tags (AsxData *data)
+{
+  GstTagList *tags = gst_tag_list_new_empty ();
+
+  /* Also rejects values that would overflow clock time */
+  if (data->duration > 0 && data->duration < (gdouble) (G_MAXUINT64 / GST_SECOND)) {
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_DURATION, (guint64) (data->duration * GST_SECOND), NULL);
+  }
+  if (data->title) {
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_TITLE, data->title, NULL);
+  }
+  if (data->author) {
+    gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+        GST_TAG_ARTIST, data->author, NULL);
+  }
+
+  if (gst_tag_list_is_empty (tags)) {
+    gst_tag_list_unref (tags);
+    return NULL;
+  }
+
+  gst_tag_list_set_scope (tags, GST_TAG_SCOPE_GLOBAL);
+
+  return tags;
+}
+
+static void
+_asx_start_element_cb (GMarkupParseContext *context, const gchar *element_name,
+    const gchar **attribute_names, const gchar **attribute_values,
+    gpointer user_data, GError **error)
+{
+  AsxData *data = (AsxData *) user_data;
+  const gchar *value;
+
+  if (_asx_name_is (element_name, "entry")) {
+    _reset_asx_entry (data);
+    data->in_entry = TRUE;
+    return;
+  }
+
+  /* Reference to another playlist, let player resolve it later */
+  if (_asx_name_is (element_name, "entryref")) {
+    if ((value = _get_asx_attribute (attribute_names, attribute_values, "href"))
+        && data->func (data->user_data, value, -1, NULL, error))
+      data->accepted = TRUE;
+    return;
+  }
+
+  if (!data->in_entry || data->field != ASX_FIELD_NONE || !_asx_parent_is_entry (context))
+    return;
+
+  if (_asx_name_is (element_name, "ref")) {
+    /* Only first ref is used, others are fallbacks */
+    if (!data->ref && (value = _get_asx_attribute (attribute_names, attribute_values, "href")))
+      data->ref = g_strstrip (g_strdup (value));
+  } else if (_asx_name_is (element_name, "duration")) {
+    /* Unparsable duration is ignored */
+    if ((value = _get_asx_attribute (attribute_names, attribute_values, "value")))
+      playlist_utils_parse_clock_time (value, &data->duration);
+  } else if ((data->field = _get_asx_entry_field (element_name)) != ASX_FIELD_NONE) {
+    g_string_truncate (data->text, 0);
+  }
+}
+
+static void
+_asx_end_element_cb (GMarkupParseContext *context, const gchar *element_name,
+    gpointer user_data, GError **error)
+{
+  AsxData *data = (AsxData *) user_data;
+
+  if (data->field != ASX_FIELD_NONE && data->field == _get_asx_entry_field (element_name)) {
+    gchar *value = g_strstrip (g_strndup (data->text->str, data->text->len));
+
+    if (*value != '\0') {
+      gchar **dest = (data->field == ASX_FIELD_TITLE) ? &data->title : &data->author;
+
+      g_free (*dest);
+      *dest = g_steal_pointer (&value);
+    }
+
+    g_free (value);
+    data->field = ASX_FIELD_NONE;
+
+    return;
+  }
+
+  if (data->in_entry && _asx_name_is (element_name, "entry")) {
+    data->in_entry = FALSE;
+
+    if (data->ref && *data->ref != '\0') {
+      GstTagList *tags = _make_asx_entry_tags (data);
+
+      if (data->func (data->user_data, data->ref, -1, tags, error))
+        data->accepted = TRUE;
+
+      if (tags)
+        gst_tag_list_unref (tags);
+    }
+
+    _reset_asx_entry (data);
+  }
+}
+
+static void
+_asx_text_cb (GMarkupParseContext *context, const gchar *text, gsize text_len,
+    gpointer user_data, GError **error)
+{
+  AsxData *data = (AsxData *) user_data;
+
+  if (data->field != ASX_FIELD_NONE)
+    g_string_append_len (data->text, text, text_len);
+}
+
+static const GMarkupParser asx_parser = {
+  .start_element = _asx_start_element_cb,
+  .end_element = _asx_end_element_cb,
+  .text = _asx_text_cb,
+};
+
+/* Whether "&" at given position starts an entity known to GMarkup */
+static gboolean
+_is_entity (const gchar *ptr, const gchar *end)
+{
+  static const gchar *const names[] = { "amp;", "lt;", "gt;", "quot;", "apos;", NULL };
+  gsize i, avail;
+
+  /* Skip "&" */
+  ptr++;
+  avail = end - ptr;
+
+  if (avail > 0 && *ptr == '#') {
+    gboolean hex = (avail > 1 && (ptr[1] == 'x' || ptr[1] == 'X'));
+    gsize n_digits = 0;
+
+    for (i = (hex) ? 2 : 1; i < avail; ++i, ++n_digits) {
+      if (!((hex) ? g_ascii_isxdigit (ptr[i]) : g_ascii_isdigit (ptr[i])))
+        break;
+    }
+
+    return (n_digits > 0 && i < avail && ptr[i] == ';');
+  }
+
+  for (i = 0; names[i] != NULL; ++i) {
+    gsize len = strlen (names[i]);
+
+    if (avail >= len && memcmp (ptr, names[i], len) == 0)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*
+ * ASX files in the wild are rarely well-formed XML. Makes them
+ * acceptable for GMarkup by skipping UTF-8 BOM, escaping stray
+ * ampersands (usually within unescaped "href" URLs) and lowercasing
+ * element names, so tags closed with a different case still match.
+ *
+ * Other errors (e.g. unquoted attribute values, unclosed tags or
+ * non UTF-8 encoding) are not recovered from and fail parsing.
+ */
+static GString *
+_sanitize_asx_data (const gchar *ptr, gsize size)
+{
+  const gchar *end;
+  GString *string = g_string_sized_new (size + 64);
+
+  _skip_bom (&ptr, &size);
+  end = ptr + size;
+
+  while (ptr < end) {
+    const gchar *special = ptr;
+
+    while (special < end && *special != '<' && *special != '&')
+      special++;
+
+    g_string_append_len (string, ptr, special - ptr);
+
+    if ((ptr = special) == end)
+      break;
+
+    if (*ptr == '&') {
+      g_string_append (string, (_is_entity (ptr, end)) ? "&" : "&amp;");
+      ptr++;
+      continue;
+    }
+
+    /* Start or end tag, comments and declarations are left as-is */
+    g_string_append_c (string, *ptr++);
+
+    if (ptr < end && *ptr == '/')
+      g_string_append_c (string, *ptr++);
+
+    while (ptr < end && (g_ascii_isalnum (*ptr)
+        || *ptr == '_' || *ptr == '-' || *ptr == '.' || *ptr == ':'))
+      g_string_append_c (string, g_ascii_tolower (*ptr++));
+  }
+
+  return string;
+}
+
+/*
+ * Parses ASX playlist data, calling @func for the first ref
+ * of each entry together with its tags and for each entryref.
+ *
+ * Data does not have to be NUL terminated. Common markup
+ * errors are recovered from, see _sanitize_asx_data().
+ *
+ * Returns %TRUE if at least one entry was accepted. Stops at
+ * first error set by @func or when @cancellable is cancelled.
+ */
+gboolean
+playlist_utils_parse_asx (const gchar *data, gsize size, PlaylistUtilsEntryFunc func,
+    gpointer user_data, GCancellable *cancellable, GError **error)
+{
+  AsxData asx_data = { 0, };
+  GString *sanitized;
+  gboolean success;
+
+  asx_data.func = func;
+  asx_data.user_data = user_data;
+  asx_data.text = g_string_new (NULL);
+
+  sanitized = _sanitize_asx_data (data, size);
+
+  success = (_parse_markup (&asx_parser, &asx_data,
+      sanitized->str, sanitized->len, cancellable, error)
+      && asx_data.accepted);
+
+  g_string_free (sanitized, TRUE);
+  g_string_free (asx_data.text, TRUE);
+  _reset_asx_entry (&asx_data);
+
+  return success;
+}
+
+/*
+ * Makes cache key from playlist content. URI is included too,
+ * since relative entries are resolved against it.
+ */
+gchar *
+playlist_utils_cache_make_key (GUri *uri, GBytes *bytes)
+{
+  GChecksum *checksum;
+  gchar *uri_str, *key;
+  gconstpointer data;
+  gsize data_size;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  uri_str = g_uri_to_string (uri);
+  g_checksum_update (checksum, (const guchar *) uri_str, -1);
+  g_free (uri_str);
+
+  data = g_bytes_get_data (bytes, &data_size);
+  g_checksum_update (checksum, (const guchar *) data, data_size);
+
+  key = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return key;
+}
+
+static inline gboolean
+_read_uint32 (const guint8 **ptr, const guint8 *end, guint32 *val)
+{
+  if ((gsize) (end - *ptr) < sizeof (guint32))
+    return FALSE;
+
+  memcpy (val, *ptr, sizeof (guint32));
+  *val = GUINT32_FROM_LE (*val);
+  *ptr += sizeof (guint32);
+
+  return TRUE;
+}
+
+static inline gboolean
+_read_uint64 (const guint8 **ptr, const guint8 *end, guint64 *val)
+{
+  if ((gsize) (end - *ptr) < sizeof (guint64))
+    return FALSE;
+
+  memcpy (val, *ptr, sizeof (guint64));
+  *val = GUINT64_FROM_LE (*val);
+  *ptr += sizeof (guint64);
+
+  return TRUE;
+}
+
+static inline gboolean
+_read_string (const guint8 **ptr, const guint8 *end, const gchar **str, guint32 *len)
+{
+  if (!_read_uint32 (ptr, end, len) || (gsize) (end - *ptr) < *len)
+    return FALSE;
+
+  *str = (const gchar *) *ptr;
+  *ptr += *len;
+
+  return TRUE;
+}
+
+static gboolean
+_read_entry (const guint8 **ptr, const guint8 *end, const gchar **uri, guint32 *uri_len,
+    const gchar **title, guint32 *title_len, guint64 *duration)
+{
+  return (_read_string (ptr, end, uri, uri_len)
+      && *uri_len > 0
+      && _read_string (ptr, end, title, title_len)
+      && _read_uint64 (ptr, end, duration));
+}
+
+/*
+ * Fills playlist with entries from cache. Returns %FALSE if there is
+ * no valid cache for given key (playlist is left untouched then)
+ * or when operation was cancelled (playlist might be partially filled
+ * then, same as when parsing is cancelled).
+ *
+ * Cache file modification time is updated on success, so most
+ * recently used files are the last ones to be removed when trimming.
+ */
+gboolean
+playlist_utils_cache_restore (const gchar *cache_dir, const gchar *key, GUri *uri,
+    GListStore *playlist, GCancellable *cancellable)
+{
+  PlaylistUtilsBatch *batch;
+  GMappedFile *mapped_file;
+  const guint8 *data, *ptr, *end;
+  gchar *filename, *path;
+  guint32 version = 0, n_entries = 0, i;
+  gboolean success = FALSE;
+
+  filename = g_strconcat (key, CACHE_FILE_SUFFIX, NULL);
+  path = g_build_filename (cache_dir, filename, NULL);
+  g_free (filename);
+
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+
+  if (!mapped_file) {
+    g_free (path);
+    return FALSE;
+  }
+
+  data = (const guint8 *) g_mapped_file_get_contents (mapped_file);
+  end = data + g_mapped_file_get_length (mapped_file);
+  ptr = data;
+
+  if ((gsize) (end - ptr) < CACHE_HEADER_SIZE || memcmp (ptr, CACHE_MAGIC, 4) != 0)
+    goto invalid;
+
+  ptr += 4;
+  if (!_read_uint32 (&ptr, end, &version) || version != CACHE_VERSION
+      || !_read_uint32 (&ptr, end, &n_entries) || n_entries == 0)
+    goto invalid;
+
+  /* Validate whole file first, so invalid cache never leaves playlist half filled */
+  for (i = 0; i < n_entries; ++i) {
+    const gchar *entry_uri, *title;
+    guint32 uri_len, title_len;
+    guint64 duration;
+
+    if (!_read_entry (&ptr, end, &entry_uri, &uri_len, &title, &title_len, &duration))
+      goto invalid;
+  }
+  if (ptr != end)
+    goto invalid;
+
+  ptr = data + CACHE_HEADER_SIZE;
+  batch = playlist_utils_batch_new (uri, playlist);
+
+  for (i = 0; i < n_entries; ++i) {
+    ClapperMediaItem *item;
+    const gchar *entry_uri, *title;
+    guint32 uri_len, title_len;
+    guint64 duration;
+    gchar *entry_uri_str;
+
+    _read_entry (&ptr, end, &entry_uri, &uri_len, &title, &title_len, &duration);
+
+    entry_uri_str = g_strndup (entry_uri, uri_len);
+    item = clapper_media_item_new (entry_uri_str);
+    g_free (entry_uri_str);
+
+    if (title_len > 0 || duration > 0) {
+      GstTagList *tags = gst_tag_list_new_empty ();
+
+      if (duration > 0) {
+        gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+            GST_TAG_DURATION, duration, NULL);
+      }
+      if (title_len > 0) {
+        gchar *title_str = g_strndup (title, title_len);
+
+        gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+            GST_TAG_TITLE, title_str, NULL);
+        g_free (title_str);
+      }
+
+      gst_tag_list_set_scope (tags, GST_TAG_SCOPE_GLOBAL);
+      clapper_media_item_populate_tags (item, tags);
+      gst_tag_list_unref (tags);
+    }
+
+    _batch_take_item (batch, item);
+
+    if (g_cancellable_is_cancelled (cancellable))
+      break;
+  }
+
+  if ((success = !g_cancellable_is_cancelled (cancellable)))
+    playlist_utils_batch_flush (batch);
+
+  playlist_utils_batch_free (batch);
+
+  if (success) {
+    g_debug ("Restored %u playlist entries from cache", n_entries);
+
+    if (g_utime (path, NULL) != 0)
+      g_debug ("Could not update cache file modification time: %s", g_strerror (errno));
+  }
+  goto finish;
+
+invalid:
+  g_debug ("Removing invalid playlist cache file: %s", path);
+  g_unlink (path);
+
+finish:
+  g_mapped_file_unref (mapped_file);
+  g_free (path);
+
+  return success;
+}
+
+static gint
+_compare_file_infos_by_mtime (GFileInfo **info_a, GFileInfo **info_b)
+{
+  GDateTime *time_a, *time_b;
+  gint res;
+
+  time_a = g_file_info_get_modification_date_time (*info_a);
+  time_b = g_file_info_get_modification_date_time (*info_b);
+
+  res = (time_a && time_b) ? g_date_time_compare (time_a, time_b) : 0;
+
+  if (time_a)
+    g_date_time_unref (time_a);
+  if (time_b)
+    g_date_time_unref (time_b);
+
+  return res;
+}
+
+/* Removes oldest cache files until their total size fits within limit */
+static void
+_cache_trim (const gchar *cache_dir, guint64 max_total_size)
+{
+  GFile *dir;
+  GFileEnumerator *enumerator;
+  GPtrArray *infos;
+  guint64 total_size = 0;
+  guint i;
+
+  dir = g_file_new_for_path (cache_dir);
+  enumerator = g_file_enumerate_children (dir,
+      G_FILE_ATTRIBUTE_STANDARD_NAME ","
+      G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+      G_FILE_ATTRIBUTE_TIME_MODIFIED,
+      G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+
+  if (!enumerator) {
+    g_object_unref (dir);
+    return;
+  }
+
+  infos = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+  while (TRUE) {
+    GFileInfo *info = NULL;
+
+    if (!g_file_enumerator_iterate (enumerator, &info, NULL, NULL, NULL) || !info)
+      break;
+
+    if (!g_str_has_suffix (g_file_info_get_name (info), CACHE_FILE_SUFFIX))
+      continue;
+
+    total_size += g_file_info_get_size (info);
+    g_ptr_array_add (infos, g_object_ref (info));
+  }
+
+  g_object_unref (enumerator);
+
+  if (total_size > max_total_size) {
+    g_ptr_array_sort (infos, (GCompareFunc) _compare_file_infos_by_mtime);
+
+    for (i = 0; i < infos->len && total_size > max_total_size; ++i) {
+      GFileInfo *info = g_ptr_array_index (infos, i);
+      GFile *file = g_file_get_child (dir, g_file_info_get_name (info));
+
+      if (g_file_delete (file, NULL, NULL)) {
+        g_debug ("Removed old playlist cache file: %s", g_file_info_get_name (info));
+        total_size -= g_file_info_get_size (info);
+      }
+      g_object_unref (file);
+    }
+  }
+
+  g_ptr_array_unref (infos);
+  g_object_unref (dir);
+}
+
+/*
+ * Atomically writes entries recorded by batch into cache. Oldest
+ * cache files are removed afterwards to keep total size within limit.
+ */
+gboolean
+playlist_utils_cache_store (const gchar *cache_dir, const gchar *key, PlaylistUtilsBatch *batch,
+    guint64 max_entry_size, guint64 max_total_size, GError **error)
+{
+  GByteArray *contents;
+  gchar *filename, *path;
+  gboolean success;
+
+  if (G_UNLIKELY (!batch->record)) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+        "Playlist batch was not recording entries");
+    return FALSE;
+  }
+  if (batch->n_entries == 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+        "Playlist has no entries to cache");
+    return FALSE;
+  }
+  if (CACHE_HEADER_SIZE + batch->record->len > max_entry_size) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+        "Playlist cache data exceeds size limit");
+    return FALSE;
+  }
+
+  if (g_mkdir_with_parents (cache_dir, 0755) != 0) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "Could not create cache directory: %s", g_strerror (errno));
+    return FALSE;
+  }
+
+  contents = g_byte_array_sized_new (CACHE_HEADER_SIZE + batch->record->len);
+  g_byte_array_append (contents, (const guint8 *) CACHE_MAGIC, 4);
+  _record_uint32 (contents, CACHE_VERSION);
+  _record_uint32 (contents, batch->n_entries);
+  g_byte_array_append (contents, batch->record->data, batch->record->len);
+
+  filename = g_strconcat (key, CACHE_FILE_SUFFIX, NULL);
+  path = g_build_filename (cache_dir, filename, NULL);
+  g_free (filename);
+
+  /* Writes into temporary file and renames it afterwards */
+  success = g_file_set_contents_full (path, (const gchar *) contents->data, contents->len,
+      G_FILE_SET_CONTENTS_CONSISTENT, 0644, error);
+
+  g_byte_array_unref (contents);
+  g_free (path);
+
+  if (success)
+    _cache_trim (cache_dir, max_total_size);
+
+  return success;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include <clapper/clapper.h>
+
+G_BEGIN_DECLS
+
+/* Amount of items collected before inserting them into playlist at once */
+#define PLAYLIST_UTILS_BATCH_SIZE 256
+
+/* Playlists smaller than this are parsed faster than cache lookup */
+#define PLAYLIST_UTILS_CACHE_MIN_DATA_SIZE (64 * 1024)
+
+typedef struct _PlaylistUtilsBatch PlaylistUtilsBatch;
+
+/* Compatible with playlist_utils_batch_add_entry() */
+typedef gboolean (* PlaylistUtilsEntryFunc) (gpointer user_data, const gchar *location, gssize len, GstTagList *tags, GError **error);
+
+PlaylistUtilsBatch * playlist_utils_batch_new (GUri *uri, GListStore *playlist);
+
+gboolean playlist_utils_batch_add_entry (PlaylistUtilsBatch *batch, const gchar *location, gssize len, GstTagList *tags, GError **error);
+
+void playlist_utils_batch_flush (PlaylistUtilsBatch *batch);
+
+void playlist_utils_batch_set_recording (PlaylistUtilsBatch *batch, gboolean recording);
+
+guint playlist_utils_batch_get_n_entries (PlaylistUtilsBatch *batch);
+
+void playlist_utils_batch_free (PlaylistUtilsBatch *batch);
+
+gchar * playlist_utils_resolve_uri (const gchar *base_uri, const gchar *location, gssize len, GError **error);
+
+gboolean playlist_utils_parse_clock_time (const gchar *text, gdouble *seconds);
+
+gboolean playlist_utils_parse_m3u (const gchar *data, gsize size, PlaylistUtilsEntryFunc func, gpointer user_data, GCancellable *cancellable, GError **error);
+
+gboolean playlist_utils_parse_pls (const gchar *data, gsize size, PlaylistUtilsEntryFunc func, gpointer user_data, GCancellable *cancellable, GError **error);
+
+gboolean playlist_utils_parse_xspf (const gchar *data, gsize size, PlaylistUtilsEntryFunc func, gpointer user_data, GCancellable *cancellable, GError **error);
+
+gboolean playlist_utils_parse_asx (const gchar *data, gsize size, PlaylistUtilsEntryFunc func, gpointer user_data, GCancellable *cancellable, GError **error);
+
+gchar * playlist_utils_cache_make_key (GUri *uri, GBytes *bytes);
+
+gboolean playlist_utils_cache_restore (const gchar *cache_dir, const gchar *key, GUri *uri, GListStore *playlist, GCancellable *cancellable);
+
+gboolean playlist_utils_cache_store (const gchar *cache_dir, const gchar *key, PlaylistUtilsBatch *batch, guint64 max_entry_size, guint64 max_total_size, GError **error);
+
+G_END_DECLS
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures action dispatch, comparing it against a chain of
+ * string comparisons that was used before. Both must agree
+ * on every sample, otherwise benchmark fails.
+ *
+ * Usage: bench-actions [n-iterations]
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "clapper-control-hub-actions.h"
+
+static const gchar *const samples[] = {
+  "toggle_play", "play", "pause", "stop", "clear",
+  "seek 12.5", "seek 3600", "set_speed 1.25", "set_volume 0.75",
+  "set_mute true", "set_progression 2", "add https://example.com/video.mp4",
+  "insert https://example.com/video.mp4 12", "select 3", "remove 7",
+  /* Invalid ones */
+  "play 1", "seek", "seeking 1", "set_volume", "unknown", "", "add",
+  NULL
+};
+
+static ClapperControlHubAction
+_reference_get_action (const gchar *text)
+{
+  if (strcmp (text, "toggle_play") == 0)
+    return CLAPPER_CONTROL_HUB_ACTION_TOGGLE_PLAY;
+  if (strcmp (text, "play") == 0)
+    return CLAPPER_CONTROL_HUB_ACTION_PLAY;
+  if (strcmp (text, "pause") == 0)
+    return CLAPPER_CONTROL_HUB_ACTION_PAUSE;
+  if (strcmp (text, "stop") == 0)
+    return CLAPPER_CONTROL_HUB_ACTION_STOP;
+  if (strcmp (text, "clear") == 0)
+    return CLAPPER_CONTROL_HUB_ACTION_CLEAR;
+
+  if (g_str_has_prefix (text, "seek "))
+    return CLAPPER_CONTROL_HUB_ACTION_SEEK;
+  if (g_str_has_prefix (text, "set_speed "))
+    return CLAPPER_CONTROL_HUB_ACTION_SET_SPEED;
+  if (g_str_has_prefix (text, "set_volume "))
+    return CLAPPER_CONTROL_HUB_ACTION_SET_VOLUME;
+  if (g_str_has_prefix (text, "set_mute "))
+    return CLAPPER_CONTROL_HUB_ACTION_SET_MUTE;
+  if (g_str_has_prefix (text, "set_progression "))
+    return CLAPPER_CONTROL_HUB_ACTION_SET_PROGRESSION;
+  if (g_str_has_prefix (text, "add "))
+    return CLAPPER_CONTROL_HUB_ACTION_ADD;
+  if (g_str_has_prefix (text, "insert "))
+    return CLAPPER_CONTROL_HUB_ACTION_INSERT;
+  if (g_str_has_prefix (text, "select "))
+    return CLAPPER_CONTROL_HUB_ACTION_SELECT;
+  if (g_str_has_prefix (text, "remove "))
+    return CLAPPER_CONTROL_HUB_ACTION_REMOVE;
+
+  return CLAPPER_CONTROL_HUB_ACTION_INVALID;
+}
+
+/* Result is accumulated, so compiler cannot skip the calls */
+static gdouble
+_measure (ClapperControlHubAction (* get_action) (const gchar *text),
+    guint n_iterations, guint64 *checksum)
+{
+  gint64 start = g_get_monotonic_time ();
+  guint i, j, n_calls = 0;
+
+  for (i = 0; i < n_iterations; ++i) {
+    for (j = 0; samples[j] != NULL; ++j, ++n_calls)
+      *checksum += get_action (samples[j]);
+  }
+
+  return (gdouble) (g_get_monotonic_time () - start) * 1000 / MAX (n_calls, 1);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  guint64 checksum = 0, ref_checksum = 0;
+  guint i, n_iterations = 1000000;
+  gdouble ns, ref_ns;
+
+  if (argc > 1)
+    n_iterations = (guint) g_ascii_strtoull (argv[1], NULL, 10);
+
+  for (i = 0; samples[i] != NULL; ++i) {
+    ClapperControlHubAction action = clapper_control_hub_actions_get_action (samples[i]);
+    ClapperControlHubAction expected = _reference_get_action (samples[i]);
+
+    if (action != expected) {
+      g_printerr ("Mismatch for \"%s\": %i, expected: %i\n", samples[i], action, expected);
+      return 1;
+    }
+  }
+
+  ref_ns = _measure (_reference_get_action, n_iterations, &ref_checksum);
+  ns = _measure (clapper_control_hub_actions_get_action, n_iterations, &checksum);
+
+  if (checksum != ref_checksum) {
+    g_printerr ("Checksum mismatch\n");
+    return 1;
+  }
+
+  g_print ("dispatch: %.2f ns/action, string comparisons: %.2f ns/action (%.2fx)\n",
+      ns, ref_ns, ref_ns / MAX (ns, 0.001));
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures building state snapshot of a big queue as JSON and its
+ * MessagePack transcoding. First build escapes and caches all item
+ * titles, following ones reuse them.
+ *
+ * Usage: bench-snapshot [n-items] [n-iterations]
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/tag/tag.h>
+#include <clapper/clapper.h>
+
+#include "clapper-control-hub.h"
+#include "clapper-control-hub-json.h"
+#include "clapper-control-hub-msgpack.h"
+
+static void
+_fill_items (ClapperControlHub *hub, guint n_items)
+{
+  guint i;
+
+  for (i = 0; i < n_items; ++i) {
+    ClapperMediaItem *item;
+    GstTagList *tags;
+    gchar *uri, *title;
+
+    uri = g_strdup_printf ("https://example.com/video%u.mp4", i);
+    item = clapper_media_item_new (uri);
+
+    /* Every tenth title needs escaping */
+    title = (i % 10 == 0)
+        ? g_strdup_printf ("Video \"%u\"\twith\\escapes", i)
+        : g_strdup_printf ("Video %u", i);
+
+    tags = gst_tag_list_new (GST_TAG_TITLE, title, NULL);
+    clapper_media_item_populate_tags (item, tags);
+
+    g_ptr_array_add (hub->items, item);
+
+    gst_tag_list_unref (tags);
+    g_free (title);
+    g_free (uri);
+  }
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  ClapperControlHub *hub;
+  GBytes *binary = NULL;
+  gchar *snapshot;
+  gint64 start, cold_us, json_us, msgpack_us;
+  gsize json_size;
+  guint i, n_items = 10000, n_iterations = 100;
+
+  clapper_init (NULL, NULL);
+
+  if (argc > 1)
+    n_items = (guint) g_ascii_strtoull (argv[1], NULL, 10);
+  if (argc > 2)
+    n_iterations = MAX ((guint) g_ascii_strtoull (argv[2], NULL, 10), 1);
+
+  /* JSON builder only reads hub fields, so a full hub
+   * instance with running server is not needed here */
+  hub = g_new0 (ClapperControlHub, 1);
+  hub->items = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_object_unref);
+  hub->json_titles = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  hub->played_index = CLAPPER_QUEUE_INVALID_POSITION;
+  hub->volume = 1.0;
+  hub->speed = 1.0;
+
+  _fill_items (hub, n_items);
+
+  start = g_get_monotonic_time ();
+  snapshot = clapper_control_hub_json_build_default (hub, TRUE);
+  cold_us = g_get_monotonic_time () - start;
+
+  json_size = strlen (snapshot);
+  g_free (snapshot);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_iterations; ++i) {
+    snapshot = clapper_control_hub_json_build_default (hub, TRUE);
+    g_free (snapshot);
+  }
+  json_us = (g_get_monotonic_time () - start) / n_iterations;
+
+  snapshot = clapper_control_hub_json_build_default (hub, TRUE);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_iterations; ++i) {
+    g_clear_pointer (&binary, g_bytes_unref);
+
+    if (!(binary = clapper_control_hub_msgpack_from_json (snapshot))) {
+      g_printerr ("Could not transcode snapshot\n");
+      return 1;
+    }
+  }
+  msgpack_us = (g_get_monotonic_time () - start) / n_iterations;
+
+  g_print ("%u items, JSON: %" G_GSIZE_FORMAT " bytes, MessagePack: %" G_GSIZE_FORMAT " bytes\n",
+      n_items, json_size, g_bytes_get_size (binary));
+  g_print ("first build: %.3f ms, cached build: %.3f ms, transcode: %.3f ms\n",
+      cold_us / 1000.0, json_us / 1000.0, msgpack_us / 1000.0);
+
+  g_bytes_unref (binary);
+  g_free (snapshot);
+  g_hash_table_unref (hub->json_titles);
+  g_ptr_array_unref (hub->items);
+  g_free (hub);
+
+  return 0;
+}
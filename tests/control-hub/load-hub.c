@@ -0,0 +1,942 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Load generator for control hub. Opens N WebSocket clients that
+ * fire a weighted mix of commands, each client sending its next
+ * command after receiving result of the previous one. Commands are
+ * sent as single action batches with unique request ID, so latency
+ * is measured to the matching "batch_result" reply instead of
+ * (hub-wide) events that other clients commands could cause.
+ *
+ * By default it hosts a headless player (with fakesinks) and control
+ * hub loaded from the build tree. Its address and path are discovered
+ * with MDNS query for the service of this process. With "--port" it
+ * connects to an already running hub instead.
+ *
+ * Reported CPU time and RSS are of this process, so they include
+ * clients too. Items to select are taken from initial snapshot.
+ *
+ * Usage: load-hub [OPTION...]
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include <clapper/clapper.h>
+#include <libsoup/soup.h>
+
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#define CONNECT_RETRY_INTERVAL 100
+#define CONNECT_MAX_RETRIES 50
+
+#define DISCOVER_RETRY_INTERVAL 200
+#define DISCOVER_MAX_RETRIES 50
+
+#define MDNS_PORT 5353
+#define MDNS_GROUP_IPV4 "224.0.0.251"
+
+#define DNS_TYPE_TXT 16
+#define DNS_TYPE_SRV 33
+
+/* Legacy (one-shot) query for "_clapper._tcp.local" PTR records,
+ * sent from a random port, so it is answered with unicast */
+static const guint8 discover_query[] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  8, '_', 'c', 'l', 'a', 'p', 'p', 'e', 'r', 4, '_', 't', 'c', 'p', 5, 'l', 'o', 'c', 'a', 'l', 0,
+  0x00, 0x0c, 0x00, 0x01
+};
+
+typedef enum
+{
+  COMMAND_SEEK = 0,
+  COMMAND_VOLUME,
+  COMMAND_ADD,
+  COMMAND_SELECT,
+  N_COMMANDS
+} Command;
+
+static const gchar *const command_names[N_COMMANDS] = {
+  "seek", "volume", "add", "select"
+};
+
+typedef struct
+{
+  guint index;
+  SoupWebsocketConnection *connection;
+  guint n_retries;
+
+  /* IDs of items from snapshot, starting at queue offset */
+  GArray *ids;
+  guint offset;
+  guint played_index;
+
+  guint n_sent;
+  guint volume_step;
+
+  /* Request ID of command in flight, if any */
+  gchar *request_id;
+  gint64 sent_time;
+  GSource *timeout_source;
+
+  gboolean done;
+} LoadClient;
+
+static gint n_clients = 10;
+static gint n_commands = 100;
+static gint n_items = 50;
+static gint port = 0;
+static gint command_timeout = 2000;
+static gchar *host = NULL;
+static gchar *path = NULL;
+static gchar *mix = NULL;
+static gchar *media_uri = NULL;
+
+static GOptionEntry entries[] = {
+  { "clients", 'c', 0, G_OPTION_ARG_INT, &n_clients, "Amount of WebSocket clients (default: 10)", "N" },
+  { "commands", 'n', 0, G_OPTION_ARG_INT, &n_commands, "Commands sent by each client (default: 100)", "N" },
+  { "mix", 'm', 0, G_OPTION_ARG_STRING, &mix, "Command weights (default: seek=1,volume=1,add=1,select=1)", "MIX" },
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items, "Queue items of hosted player (default: 50)", "N" },
+  { "uri", 'u', 0, G_OPTION_ARG_STRING, &media_uri, "Playable media URI used for queue items", "URI" },
+  { "timeout", 't', 0, G_OPTION_ARG_INT, &command_timeout, "Time to wait for command result in ms (default: 2000)", "MS" },
+  { "host", 0, 0, G_OPTION_ARG_STRING, &host, "Host of already running hub (default: 127.0.0.1)", "HOST" },
+  { "port", 'p', 0, G_OPTION_ARG_INT, &port, "Port of already running hub", "PORT" },
+  { "path", 0, 0, G_OPTION_ARG_STRING, &path, "WebSocket path (default: /websocket)", "PATH" },
+  { NULL }
+};
+
+static GMainLoop *loop;
+static SoupSession *session;
+static GRand *random_gen;
+static guint weights[N_COMMANDS] = { 1, 1, 1, 1 };
+static guint weights_sum = 4;
+static guint n_active = 0;
+static gboolean hosted = FALSE;
+static gboolean failed = FALSE;
+static LoadClient *clients = NULL;
+
+/* Hosted hub discovery */
+static GSocket *discover_socket = NULL;
+static GSource *discover_source = NULL;
+static guint discover_retries = 0;
+
+/* Results */
+static gint64 start_time;
+static gint64 cpu_start;
+static gint64 rss_before;
+static GArray *latencies;
+static guint n_timed_out = 0;
+static guint n_rejected = 0;
+static guint n_frames = 0;
+static guint64 n_bytes = 0;
+
+static void _client_connect (LoadClient *client);
+static void _client_send_next (LoadClient *client);
+
+static gboolean
+_parse_mix (const gchar *text)
+{
+  gchar **parts;
+  guint i, j;
+  gboolean success = TRUE;
+
+  memset (weights, 0, sizeof (weights));
+  weights_sum = 0;
+
+  parts = g_strsplit (text, ",", -1);
+
+  for (i = 0; parts[i] != NULL && success; ++i) {
+    gchar **pair = g_strsplit (parts[i], "=", 2);
+
+    success = FALSE;
+
+    for (j = 0; pair[0] && pair[1] && j < N_COMMANDS; ++j) {
+      if (strcmp (pair[0], command_names[j]) == 0) {
+        weights[j] = (guint) g_ascii_strtoull (pair[1], NULL, 10);
+        weights_sum += weights[j];
+        success = TRUE;
+        break;
+      }
+    }
+
+    g_strfreev (pair);
+  }
+
+  g_strfreev (parts);
+
+  return (success && weights_sum > 0);
+}
+
+static Command
+_pick_command (void)
+{
+  guint i, val = g_rand_int_range (random_gen, 0, weights_sum);
+
+  for (i = 0; i < N_COMMANDS - 1; ++i) {
+    if (val < weights[i])
+      break;
+    val -= weights[i];
+  }
+
+  return (Command) i;
+}
+
+static void
+_client_finish (LoadClient *client)
+{
+  if (client->done)
+    return;
+
+  client->done = TRUE;
+
+  if (--n_active == 0)
+    g_main_loop_quit (loop);
+}
+
+static gboolean
+_command_timeout_cb (LoadClient *client)
+{
+  g_clear_pointer (&client->timeout_source, g_source_unref);
+
+  g_clear_pointer (&client->request_id, g_free);
+  n_timed_out++;
+
+  _client_send_next (client);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Picks random item that is not played already, as selecting it would be a no-op */
+static gboolean
+_client_pick_item (LoadClient *client, guint *id)
+{
+  guint i;
+
+  if (client->ids->len == 0
+      || (client->ids->len == 1 && client->played_index == client->offset))
+    return FALSE;
+
+  i = g_rand_int_range (random_gen, 0, client->ids->len);
+
+  if (client->offset + i == client->played_index)
+    i = (i + 1) % client->ids->len;
+
+  *id = g_array_index (client->ids, guint, i);
+
+  return TRUE;
+}
+
+static void
+_client_send_next (LoadClient *client)
+{
+  gchar *action = NULL, *text;
+  Command command;
+  guint id = 0;
+
+  if (client->n_sent == (guint) n_commands) {
+    _client_finish (client);
+    return;
+  }
+
+  command = _pick_command ();
+
+  /* Nothing to select, change volume instead */
+  if (command == COMMAND_SELECT && !_client_pick_item (client, &id))
+    command = COMMAND_VOLUME;
+
+  switch (command) {
+    case COMMAND_SEEK: {
+      gchar pos[G_ASCII_DTOSTR_BUF_SIZE];
+
+      g_ascii_dtostr (pos, sizeof (pos), g_rand_double_range (random_gen, 0, 10));
+      action = g_strdup_printf ("seek %s", pos);
+      break;
+    }
+    case COMMAND_VOLUME:
+      /* Consecutive values differ, so each command changes volume */
+      client->volume_step = (client->volume_step + 1) % 100;
+      action = g_strdup_printf ("set_volume 0.%02u", client->volume_step);
+      break;
+    case COMMAND_ADD:
+      action = g_strdup_printf ("add %s", (media_uri) ? media_uri : "file:///load-hub/dummy.mkv");
+      break;
+    case COMMAND_SELECT:
+      action = g_strdup_printf ("select %u", id);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+
+  client->n_sent++;
+  client->request_id = g_strdup_printf ("c%u-%u", client->index, client->n_sent);
+
+  text = g_strdup_printf ("batch %s\n%s", client->request_id, action);
+  client->sent_time = g_get_monotonic_time ();
+  soup_websocket_connection_send_text (client->connection, text);
+
+  g_free (action);
+  g_free (text);
+
+  client->timeout_source = g_timeout_source_new (command_timeout);
+  g_source_set_callback (client->timeout_source, (GSourceFunc) _command_timeout_cb, client, NULL);
+  g_source_attach (client->timeout_source, NULL);
+}
+
+static inline guint
+_find_uint (const gchar *text, gsize size, const gchar *key, guint fallback)
+{
+  const gchar *str;
+
+  if (!(str = g_strstr_len (text, size, key)))
+    return fallback;
+
+  return (guint) g_ascii_strtoull (str + strlen (key), NULL, 10);
+}
+
+/* Collects IDs of queue items within snapshot */
+static void
+_client_read_snapshot (LoadClient *client, const gchar *text, gsize size)
+{
+  const gchar *str, *end = text + size;
+
+  client->offset = _find_uint (text, size, "\"offset\":", 0);
+  client->played_index = _find_uint (text, size, "\"played_index\":", G_MAXUINT);
+
+  if (!(str = g_strstr_len (text, size, "\"items\":[")))
+    return;
+
+  /* Titles are escaped, so key cannot appear inside of them */
+  while ((str = g_strstr_len (str, end - str, "\"id\":"))) {
+    guint id;
+
+    str += 5;
+    id = (guint) g_ascii_strtoull (str, NULL, 10);
+    g_array_append_val (client->ids, id);
+  }
+}
+
+static void
+_message_cb (SoupWebsocketConnection *connection, gint type, GBytes *message, LoadClient *client)
+{
+  const gchar *text;
+  gchar *result_prefix;
+  gsize size;
+  gboolean matched;
+
+  text = g_bytes_get_data (message, &size);
+
+  n_frames++;
+  n_bytes += size;
+
+  if (type != SOUP_WEBSOCKET_DATA_TEXT || client->done)
+    return;
+
+  /* Initial snapshot, tells which items can be selected */
+  if (client->n_sent == 0 && !client->request_id) {
+    if (!g_strstr_len (text, size, "\"event\":\"snapshot\""))
+      return;
+
+    _client_read_snapshot (client, text, size);
+    _client_send_next (client);
+
+    return;
+  }
+
+  /* Event might be inside of a batch */
+  if (g_strstr_len (text, size, "\"event\":\"played_index_changed\""))
+    client->played_index = _find_uint (text, size, "\"played_index\":", G_MAXUINT);
+
+  if (!client->request_id)
+    return;
+
+  result_prefix = g_strdup_printf ("{\"event\":\"batch_result\",\"id\":\"%s\"", client->request_id);
+  matched = g_str_has_prefix (text, result_prefix);
+  g_free (result_prefix);
+
+  if (matched) {
+    gint64 latency = g_get_monotonic_time () - client->sent_time;
+
+    g_array_append_val (latencies, latency);
+
+    if (g_strstr_len (text, size, "false"))
+      n_rejected++;
+
+    if (client->timeout_source) {
+      g_source_destroy (client->timeout_source);
+      g_clear_pointer (&client->timeout_source, g_source_unref);
+    }
+    g_clear_pointer (&client->request_id, g_free);
+
+    _client_send_next (client);
+  }
+}
+
+static void
+_closed_cb (SoupWebsocketConnection *connection, LoadClient *client)
+{
+  if (client->done)
+    return;
+
+  g_printerr ("Client %u connection closed by server\n", client->index);
+
+  if (client->timeout_source) {
+    g_source_destroy (client->timeout_source);
+    g_clear_pointer (&client->timeout_source, g_source_unref);
+  }
+
+  failed = TRUE;
+  _client_finish (client);
+}
+
+static gboolean
+_retry_connect_cb (LoadClient *client)
+{
+  _client_connect (client);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_connected_cb (SoupSession *sess, GAsyncResult *result, LoadClient *client)
+{
+  GError *error = NULL;
+
+  if (!(client->connection = soup_session_websocket_connect_finish (sess, result, &error))) {
+    /* Hosted hub might be still starting */
+    if (++client->n_retries < CONNECT_MAX_RETRIES) {
+      g_clear_error (&error);
+      g_timeout_add (CONNECT_RETRY_INTERVAL, (GSourceFunc) _retry_connect_cb, client);
+      return;
+    }
+
+    g_printerr ("Client %u could not connect: %s\n", client->index, error->message);
+    g_error_free (error);
+
+    failed = TRUE;
+    _client_finish (client);
+
+    return;
+  }
+
+  /* Events stream can be big, do not limit it */
+  soup_websocket_connection_set_max_incoming_payload_size (client->connection, 0);
+
+  g_signal_connect (client->connection, "message", G_CALLBACK (_message_cb), client);
+  g_signal_connect (client->connection, "closed", G_CALLBACK (_closed_cb), client);
+}
+
+static void
+_client_connect (LoadClient *client)
+{
+  SoupMessage *msg;
+  gchar *uri;
+
+  uri = g_strdup_printf ("ws://%s:%i%s", host, port, path);
+  msg = soup_message_new (SOUP_METHOD_GET, uri);
+
+  soup_session_websocket_connect_async (session, msg, NULL, NULL,
+      G_PRIORITY_DEFAULT, NULL, (GAsyncReadyCallback) _connected_cb, client);
+
+  g_object_unref (msg);
+  g_free (uri);
+}
+
+/* Returns offset right after name at @offset or zero if it is invalid */
+static gsize
+_dns_skip_name (const guint8 *data, gsize size, gsize offset)
+{
+  while (offset < size) {
+    guint8 len = data[offset];
+
+    if ((len & 0xc0) == 0xc0)
+      return (offset + 2 <= size) ? offset + 2 : 0;
+    if (len == 0)
+      return offset + 1;
+
+    offset += 1 + len;
+  }
+
+  return 0;
+}
+
+/* Reads first label of name at @offset, following compression pointers */
+static gboolean
+_dns_read_first_label (const guint8 *data, gsize size, gsize offset, gchar label[64])
+{
+  guint n_jumps = 0;
+
+  while (offset < size) {
+    guint8 len = data[offset];
+
+    if ((len & 0xc0) == 0xc0) {
+      if (offset + 1 >= size || ++n_jumps > 16)
+        return FALSE;
+
+      offset = ((len & 0x3f) << 8) | data[offset + 1];
+      continue;
+    }
+    if (len == 0 || len > 63 || offset + 1 + len > size)
+      return FALSE;
+
+    memcpy (label, data + offset + 1, len);
+    label[len] = '\0';
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Finds port and path of our service in MDNS response */
+static gboolean
+_dns_parse_response (const guint8 *data, gsize size, const gchar *instance_part,
+    guint16 *found_port, gchar **found_path)
+{
+  gsize offset = 12;
+  guint i, n_questions, n_records;
+
+  if (size < 12 || !(data[2] & 0x80))
+    return FALSE;
+
+  n_questions = (data[4] << 8) | data[5];
+  n_records = ((data[6] << 8) | data[7]) + ((data[8] << 8) | data[9]) + ((data[10] << 8) | data[11]);
+
+  for (i = 0; i < n_questions; ++i) {
+    if (!(offset = _dns_skip_name (data, size, offset)) || (offset += 4) > size)
+      return FALSE;
+  }
+
+  for (i = 0; i < n_records; ++i) {
+    gchar label[64];
+    gsize name_offset = offset, rdata;
+    guint type, rdlength;
+
+    if (!(offset = _dns_skip_name (data, size, offset)) || offset + 10 > size)
+      return FALSE;
+
+    type = (data[offset] << 8) | data[offset + 1];
+    rdlength = (data[offset + 8] << 8) | data[offset + 9];
+    rdata = offset + 10;
+    offset = rdata + rdlength;
+
+    if (offset > size)
+      return FALSE;
+
+    if ((type != DNS_TYPE_SRV && type != DNS_TYPE_TXT)
+        || !_dns_read_first_label (data, size, name_offset, label)
+        || !strstr (label, instance_part))
+      continue;
+
+    if (type == DNS_TYPE_SRV && rdlength >= 6) {
+      *found_port = (data[rdata + 4] << 8) | data[rdata + 5];
+    } else if (type == DNS_TYPE_TXT) {
+      gsize pos = rdata;
+
+      while (pos < offset) {
+        guint8 len = data[pos];
+
+        if (pos + 1 + len > offset)
+          break;
+        if (len > 5 && memcmp (data + pos + 1, "path=", 5) == 0) {
+          g_free (*found_path);
+          *found_path = g_strndup ((const gchar *) data + pos + 6, len - 5);
+        }
+        pos += 1 + len;
+      }
+    }
+  }
+
+  return (*found_port != 0 && *found_path != NULL);
+}
+
+static void _start_clients (void);
+
+static void
+_discover_finish (void)
+{
+  g_source_destroy (discover_source);
+  g_clear_pointer (&discover_source, g_source_unref);
+  g_clear_object (&discover_socket);
+}
+
+static gboolean
+_discover_readable_cb (GSocket *socket, GIOCondition condition, gpointer user_data G_GNUC_UNUSED)
+{
+  guint8 data[9000];
+  GSocketAddress *src = NULL;
+  gchar *instance_part, *found_path = NULL;
+  guint16 found_port = 0;
+  gssize size;
+
+  if ((size = g_socket_receive_from (socket, &src, (gchar *) data, sizeof (data), NULL, NULL)) <= 0)
+    return G_SOURCE_CONTINUE;
+
+  /* Instance name is "<host> <prgname> controlhub<index>" */
+  instance_part = g_strdup_printf (" %s controlhub", g_get_prgname ());
+
+  if (_dns_parse_response (data, size, instance_part, &found_port, &found_path)) {
+    g_free (host);
+    host = g_inet_address_to_string (g_inet_socket_address_get_address (G_INET_SOCKET_ADDRESS (src)));
+    port = found_port;
+    g_free (path);
+    path = g_strdup_printf ("%s/websocket", found_path);
+
+    g_print ("discovered hosted hub: ws://%s:%i%s\n", host, port, path);
+
+    _discover_finish ();
+    _start_clients ();
+  }
+
+  g_free (instance_part);
+  g_free (found_path);
+  g_object_unref (src);
+
+  /* Source was destroyed if discovery finished */
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_discover_send_cb (gpointer user_data G_GNUC_UNUSED)
+{
+  GInetAddress *group;
+  GSocketAddress *dest;
+
+  /* Already discovered */
+  if (!discover_socket)
+    return G_SOURCE_REMOVE;
+
+  if (++discover_retries > DISCOVER_MAX_RETRIES) {
+    g_printerr ("Could not discover hosted hub with MDNS\n");
+    _discover_finish ();
+
+    failed = TRUE;
+    g_main_loop_quit (loop);
+
+    return G_SOURCE_REMOVE;
+  }
+
+  group = g_inet_address_new_from_string (MDNS_GROUP_IPV4);
+  dest = g_inet_socket_address_new (group, MDNS_PORT);
+
+  g_socket_send_to (discover_socket, dest, (const gchar *) discover_query,
+      sizeof (discover_query), NULL, NULL);
+
+  g_object_unref (dest);
+  g_object_unref (group);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Hosted hub starts listening on a random port and announces it
+ * with MDNS, so query it until our service is answered */
+static gboolean
+_discover_start (void)
+{
+  GInetAddress *any;
+  GSocketAddress *address;
+  GError *error = NULL;
+  gboolean success;
+
+  if (!(discover_socket = g_socket_new (G_SOCKET_FAMILY_IPV4,
+      G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error))) {
+    g_printerr ("Could not create discovery socket: %s\n", error->message);
+    g_error_free (error);
+
+    return FALSE;
+  }
+
+  any = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (any, 0);
+
+  if (!(success = g_socket_bind (discover_socket, address, FALSE, &error))) {
+    g_printerr ("Could not bind discovery socket: %s\n", error->message);
+    g_error_free (error);
+    g_clear_object (&discover_socket);
+  }
+
+  g_object_unref (address);
+  g_object_unref (any);
+
+  if (!success)
+    return FALSE;
+
+  g_socket_set_blocking (discover_socket, FALSE);
+  g_socket_set_multicast_loopback (discover_socket, TRUE);
+
+  discover_source = g_socket_create_source (discover_socket, G_IO_IN, NULL);
+  g_source_set_callback (discover_source, (GSourceFunc) _discover_readable_cb, NULL, NULL);
+  g_source_attach (discover_source, NULL);
+
+  _discover_send_cb (NULL);
+  g_timeout_add (DISCOVER_RETRY_INTERVAL, _discover_send_cb, NULL);
+
+  return TRUE;
+}
+
+static ClapperPlayer *
+_host_player (void)
+{
+  ClapperPlayer *player;
+  ClapperEnhancerProxyList *proxies;
+  ClapperEnhancerProxy *proxy;
+  ClapperQueue *queue;
+  gint i;
+
+  player = clapper_player_new ();
+  clapper_player_set_video_sink (player, gst_element_factory_make ("fakesink", NULL));
+  clapper_player_set_audio_sink (player, gst_element_factory_make ("fakesink", NULL));
+
+  proxies = clapper_player_get_enhancer_proxies (player);
+
+  if (!(proxy = clapper_enhancer_proxy_list_get_proxy_by_module (proxies, "clapper-control-hub"))) {
+    g_printerr ("Control hub enhancer not found in: %s\n", g_getenv ("CLAPPER_ENHANCERS_PATH"));
+    gst_object_unref (player);
+
+    return NULL;
+  }
+
+  clapper_enhancer_proxy_set_locally (proxy,
+      "active", TRUE,
+      "queue-controllable", TRUE,
+      NULL);
+  clapper_enhancer_proxy_set_target_creation_allowed (proxy, TRUE);
+  gst_object_unref (proxy);
+
+  queue = clapper_player_get_queue (player);
+
+  for (i = 0; i < n_items; ++i) {
+    ClapperMediaItem *item = clapper_media_item_new ((media_uri) ? media_uri : "file:///load-hub/dummy.mkv");
+
+    clapper_queue_add_item (queue, item);
+    gst_object_unref (item);
+  }
+
+  return player;
+}
+
+static gint
+_compare_latency (gconstpointer a, gconstpointer b)
+{
+  gint64 la = *((const gint64 *) a), lb = *((const gint64 *) b);
+
+  return (la > lb) - (la < lb);
+}
+
+static gdouble
+_percentile_ms (guint percent)
+{
+  guint index = (latencies->len - 1) * percent / 100;
+
+  return g_array_index (latencies, gint64, index) / 1000.0;
+}
+
+static gint64
+_get_cpu_time (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0) {
+    return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+  }
+#endif
+
+  return -1;
+}
+
+/* Current resident memory in KiB, if it can be read */
+static gint64
+_get_rss (void)
+{
+  gchar *contents = NULL;
+  const gchar *line;
+  gint64 rss = -1;
+
+  if (g_file_get_contents ("/proc/self/status", &contents, NULL, NULL)
+      && (line = strstr (contents, "VmRSS:")))
+    rss = g_ascii_strtoll (line + 6, NULL, 10);
+
+  g_free (contents);
+
+  return rss;
+}
+
+static void
+_print_results (gint64 duration, gint64 cpu_time, gint64 rss_before, gint64 rss_after)
+{
+  gdouble secs = MAX (duration, 1) / (gdouble) G_USEC_PER_SEC;
+  guint n_total = latencies->len + n_timed_out;
+
+  g_print ("clients: %i, commands: %u (%u timed out, %u rejected), duration: %.2f s, %.1f commands/s\n",
+      n_clients, n_total, n_timed_out, n_rejected, secs, n_total / secs);
+
+  if (latencies->len > 0) {
+    gint64 sum = 0;
+    guint i;
+
+    g_array_sort (latencies, _compare_latency);
+
+    for (i = 0; i < latencies->len; ++i)
+      sum += g_array_index (latencies, gint64, i);
+
+    g_print ("latency (ms): min %.2f, avg %.2f, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f\n",
+        g_array_index (latencies, gint64, 0) / 1000.0, sum / 1000.0 / latencies->len,
+        _percentile_ms (50), _percentile_ms (95), _percentile_ms (99),
+        g_array_index (latencies, gint64, latencies->len - 1) / 1000.0);
+  }
+
+  g_print ("received: %u frames (%.1f/s), %.2f MiB (%.2f MiB/s)\n",
+      n_frames, n_frames / secs, n_bytes / 1048576.0, n_bytes / 1048576.0 / secs);
+
+  if (cpu_time >= 0)
+    g_print ("cpu: %.2f s (%.1f%%)\n", cpu_time / (gdouble) G_USEC_PER_SEC,
+        100.0 * cpu_time / MAX (duration, 1));
+  if (rss_before >= 0 && rss_after >= 0)
+    g_print ("rss: %.1f MiB -> %.1f MiB (%+.1f MiB)\n", rss_before / 1024.0,
+        rss_after / 1024.0, (rss_after - rss_before) / 1024.0);
+}
+
+static void
+_start_clients (void)
+{
+  gint i;
+
+  rss_before = _get_rss ();
+  cpu_start = _get_cpu_time ();
+  start_time = g_get_monotonic_time ();
+
+  for (i = 0; i < n_clients; ++i) {
+    n_active++;
+    _client_connect (&clients[i]);
+  }
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  GOptionContext *context;
+  ClapperPlayer *player = NULL;
+  GError *error = NULL;
+  gint64 duration, cpu_time = -1;
+  gint i;
+
+  context = g_option_context_new ("- control hub load generator");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  if (mix && !_parse_mix (mix)) {
+    g_printerr ("Invalid commands mix: %s\n", mix);
+    return 1;
+  }
+  if (n_clients <= 0 || n_commands < 0) {
+    g_printerr ("Invalid amount of clients or commands\n");
+    return 1;
+  }
+
+  if (!host)
+    host = g_strdup ("127.0.0.1");
+  if (!path)
+    path = g_strdup ("/websocket");
+
+  /* Hosted hub is loaded from build tree */
+  if ((hosted = (port == 0))) {
+    gchar *prgname;
+
+    /* Unique, so MDNS service of this process can be found */
+    prgname = g_strdup_printf ("load-hub-%08x", g_random_int ());
+    g_set_prgname (prgname);
+    g_free (prgname);
+
+    g_setenv ("CLAPPER_ENHANCERS_PATH", LOAD_HUB_ENHANCERS_PATH, FALSE);
+    g_setenv ("CLAPPER_ENHANCERS_EXTRA_PATH", "", TRUE);
+    g_setenv ("CLAPPER_DISABLE_CACHE", "1", TRUE);
+  }
+
+  clapper_init (NULL, NULL);
+
+  if (hosted && !(player = _host_player ()))
+    return 1;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  session = soup_session_new ();
+  random_gen = g_rand_new ();
+  latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  clients = g_new0 (LoadClient, n_clients);
+
+  for (i = 0; i < n_clients; ++i) {
+    clients[i].index = i;
+    clients[i].volume_step = i;
+    clients[i].ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    clients[i].played_index = G_MAXUINT;
+  }
+
+  if (hosted) {
+    if (!_discover_start ())
+      return 1;
+  } else {
+    _start_clients ();
+  }
+
+  g_main_loop_run (loop);
+
+  /* Nothing to report if hosted hub was not discovered */
+  if (start_time > 0) {
+    duration = g_get_monotonic_time () - start_time;
+    if (cpu_start >= 0)
+      cpu_time = _get_cpu_time () - cpu_start;
+
+    _print_results (duration, cpu_time, rss_before, _get_rss ());
+  }
+
+  for (i = 0; i < n_clients; ++i) {
+    if (clients[i].timeout_source) {
+      g_source_destroy (clients[i].timeout_source);
+      g_source_unref (clients[i].timeout_source);
+    }
+    if (clients[i].connection) {
+      g_signal_handlers_disconnect_by_data (clients[i].connection, &clients[i]);
+      soup_websocket_connection_close (clients[i].connection, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+      g_object_unref (clients[i].connection);
+    }
+    g_array_unref (clients[i].ids);
+    g_free (clients[i].request_id);
+  }
+  g_free (clients);
+
+  g_array_unref (latencies);
+  g_rand_free (random_gen);
+  g_object_unref (session);
+  g_main_loop_unref (loop);
+
+  if (player)
+    gst_object_unref (player);
+
+  return (failed) ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "clapper-control-hub-msgpack.h"
+
+static void
+_assert_action (const guint8 *data, gsize size, const gchar *expected)
+{
+  gchar *action = clapper_control_hub_msgpack_to_action (data, size);
+
+  g_assert_cmpstr (action, ==, expected);
+  g_free (action);
+}
+
+#define ASSERT_ACTION(expected, ...) G_STMT_START { \
+  const guint8 data[] = { __VA_ARGS__ }; \
+  _assert_action (data, sizeof (data), expected); \
+} G_STMT_END
+
+static void
+test_msgpack_from_json (void)
+{
+  const guint8 expected[] = {
+    0x83, 0xa1, 'a', 0x01, 0xa1, 'b', 0x92, 0xc3, 0xc0,
+    0xa1, 'c', 0xcd, 0x01, 0x00
+  };
+  GBytes *bytes;
+
+  bytes = clapper_control_hub_msgpack_from_json ("{\"a\":1,\"b\":[true,null],\"c\":256}");
+  g_assert_nonnull (bytes);
+  g_assert_cmpmem (g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes),
+      expected, sizeof (expected));
+  g_bytes_unref (bytes);
+
+  g_assert_null (clapper_control_hub_msgpack_from_json ("{\"a\":"));
+  g_assert_null (clapper_control_hub_msgpack_from_json ("[1,2"));
+}
+
+static void
+_assert_string (const gchar *json, const gchar *expected)
+{
+  GBytes *bytes = clapper_control_hub_msgpack_from_json (json);
+  const guint8 *data;
+  gsize size, len = strlen (expected);
+
+  g_assert_nonnull (bytes);
+  data = g_bytes_get_data (bytes, &size);
+
+  /* Fixstr header followed by decoded string */
+  g_assert_cmpuint (len, <, 32);
+  g_assert_cmpuint (data[0], ==, 0xa0 | len);
+  g_assert_cmpmem (data + 1, size - 1, expected, len);
+
+  g_bytes_unref (bytes);
+}
+
+static void
+test_msgpack_string_escapes (void)
+{
+  _assert_string ("\"a\\\"b\\\\c\\/d\"", "a\"b\\c/d");
+  _assert_string ("\"\\b\\f\\n\\r\\t\"", "\b\f\n\r\t");
+
+  /* Unicode escapes encoded as UTF-8 */
+  _assert_string ("\"\\u0041\\u00e9\\u20AC\"", "A\xc3\xa9\xe2\x82\xac");
+  _assert_string ("\"\\ud83d\\ude00\"", "\xf0\x9f\x98\x80");
+
+  /* Lone surrogates become replacement character */
+  _assert_string ("\"\\ud83dx\"", "\xef\xbf\xbdx");
+  _assert_string ("\"\\ude00\"", "\xef\xbf\xbd");
+
+  g_assert_null (clapper_control_hub_msgpack_from_json ("\"\\x\""));
+  g_assert_null (clapper_control_hub_msgpack_from_json ("\"\\u12\""));
+  g_assert_null (clapper_control_hub_msgpack_from_json ("\"\\u12zz\""));
+}
+
+static void
+test_msgpack_unsigned_action (void)
+{
+  ASSERT_ACTION ("volume 100", 0x92, 0xa6, 'v', 'o', 'l', 'u', 'm', 'e', 0x64);
+  ASSERT_ACTION ("select 300", 0x92, 0xa6, 's', 'e', 'l', 'e', 'c', 't', 0xcd, 0x01, 0x2c);
+  ASSERT_ACTION ("play", 0xa4, 'p', 'l', 'a', 'y');
+}
+
+static void
+test_msgpack_signed_action (void)
+{
+  /* Negative fixint */
+  ASSERT_ACTION ("seek -1", 0x92, 0xa4, 's', 'e', 'e', 'k', 0xff);
+  ASSERT_ACTION ("seek -32", 0x92, 0xa4, 's', 'e', 'e', 'k', 0xe0);
+
+  /* Signed integers of each size, also non-negative ones */
+  ASSERT_ACTION ("seek -128", 0x92, 0xa4, 's', 'e', 'e', 'k', 0xd0, 0x80);
+  ASSERT_ACTION ("seek 127", 0x92, 0xa4, 's', 'e', 'e', 'k', 0xd0, 0x7f);
+  ASSERT_ACTION ("seek -2", 0x92, 0xa4, 's', 'e', 'e', 'k', 0xd1, 0xff, 0xfe);
+  ASSERT_ACTION ("seek -70000", 0x92, 0xa4, 's', 'e', 'e', 'k',
+      0xd2, 0xff, 0xfe, 0xee, 0x90);
+  ASSERT_ACTION ("seek -9223372036854775808", 0x92, 0xa4, 's', 'e', 'e', 'k',
+      0xd3, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00);
+
+  /* Truncated */
+  ASSERT_ACTION (NULL, 0x92, 0xa4, 's', 'e', 'e', 'k', 0xd1, 0xff);
+  ASSERT_ACTION (NULL, 0x92, 0xa4, 's', 'e', 'e', 'k', 0xd3, 0x80);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/control-hub/msgpack/from-json", test_msgpack_from_json);
+  g_test_add_func ("/control-hub/msgpack/string-escapes", test_msgpack_string_escapes);
+  g_test_add_func ("/control-hub/msgpack/unsigned-action", test_msgpack_unsigned_action);
+  g_test_add_func ("/control-hub/msgpack/signed-action", test_msgpack_signed_action);
+
+  return g_test_run ();
+}
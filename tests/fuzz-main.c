@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs libFuzzer entry point over given files, so fuzz targets
+ * can be build and tested with regular compilers too.
+ */
+
+#include <glib.h>
+
+int LLVMFuzzerTestOneInput (const guint8 *data, gsize size);
+
+gint
+main (gint argc, gchar **argv)
+{
+  gint i;
+
+  for (i = 1; i < argc; ++i) {
+    GError *error = NULL;
+    gchar *contents;
+    guint8 *copy;
+    gsize size;
+
+    if (!g_file_get_contents (argv[i], &contents, &size, &error)) {
+      g_printerr ("Could not read %s: %s\n", argv[i], error->message);
+      g_error_free (error);
+
+      return 1;
+    }
+
+    /* Pass exact size copy, so reads past the end are detectable */
+    copy = g_memdup2 (contents, MAX (size, 1));
+    g_free (contents);
+
+    LLVMFuzzerTestOneInput (copy, size);
+    g_free (copy);
+  }
+
+  return 0;
+}
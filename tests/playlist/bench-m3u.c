@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures M3U parsing throughput for a generated playlist with
+ * given amount of lines. Each entry takes two of them, as it has
+ * its own "#EXTINF" line. Throughput is reported in lines and
+ * items (accepted entries) per second.
+ *
+ * Usage: bench-m3u <n-lines> [--items|--cached]
+ *
+ * With "--items", entries are also turned into media items inserted
+ * into a playlist in batches, the same way as parser enhancer does.
+ *
+ * With "--cached", playlist is parsed and stored in cache first,
+ * then only restoring the same media items from it is measured.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include <clapper/clapper.h>
+
+#include "../../src/utils/c/playlist/playlist-utils.h"
+
+static gboolean
+_count_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  (*(guint *) user_data)++;
+
+  return TRUE;
+}
+
+static GString *
+_make_playlist (guint n_entries)
+{
+  GString *data = g_string_sized_new ((gsize) n_entries * 96);
+  guint i;
+
+  g_string_append (data, "#EXTM3U\r\n");
+
+  for (i = 0; i < n_entries; ++i) {
+    g_string_append_printf (data,
+        "#EXTINF:%u tvg-id=\"ch%u\" group-title=\"Group, %u\",Channel %u\r\n"
+        "http://example.com/stream/%u.m3u8\r\n", 60 + i % 3600, i, i % 50, i, i);
+  }
+
+  return data;
+}
+
+/* Parses playlist into media items, optionally storing them in cache */
+static gboolean
+_parse_items (GString *data, GUri *uri, GListStore *playlist,
+    const gchar *cache_dir, const gchar *key, GError **error)
+{
+  PlaylistUtilsBatch *batch = playlist_utils_batch_new (uri, playlist);
+  gboolean success;
+
+  playlist_utils_batch_set_recording (batch, cache_dir != NULL);
+
+  success = playlist_utils_parse_m3u (data->str, data->len,
+      (PlaylistUtilsEntryFunc) playlist_utils_batch_add_entry, batch, NULL, error);
+  playlist_utils_batch_flush (batch);
+
+  if (success && cache_dir) {
+    success = playlist_utils_cache_store (cache_dir, key, batch,
+        G_MAXUINT64, G_MAXUINT64, error);
+  }
+
+  playlist_utils_batch_free (batch);
+
+  return success;
+}
+
+static void
+_remove_cache_dir (const gchar *cache_dir)
+{
+  GDir *dir = g_dir_open (cache_dir, 0, NULL);
+  const gchar *name;
+
+  while ((name = g_dir_read_name (dir))) {
+    gchar *path = g_build_filename (cache_dir, name, NULL);
+
+    g_unlink (path);
+    g_free (path);
+  }
+
+  g_dir_close (dir);
+  g_rmdir (cache_dir);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  GString *data;
+  GError *error = NULL;
+  gint64 start, elapsed;
+  guint n_lines, n_entries, n_parsed = 0;
+  gboolean items, cached, success;
+
+  if (argc < 2) {
+    g_printerr ("Usage: %s <n-lines> [--items|--cached]\n", argv[0]);
+    return 1;
+  }
+
+  n_lines = (guint) MIN (g_ascii_strtoull (argv[1], NULL, 10), G_MAXUINT - 1);
+  n_entries = n_lines / 2;
+
+  /* Including "#EXTM3U" header line */
+  n_lines = n_entries * 2 + 1;
+  items = (argc > 2 && strcmp (argv[2], "--items") == 0);
+  cached = (argc > 2 && strcmp (argv[2], "--cached") == 0);
+
+  if (items || cached)
+    clapper_init (NULL, NULL);
+  else
+    gst_init (NULL, NULL);
+
+  data = _make_playlist (n_entries);
+
+  if (cached) {
+    GListStore *playlist = g_list_store_new (CLAPPER_TYPE_MEDIA_ITEM);
+    GUri *uri = g_uri_parse ("http://example.com/playlist.m3u", G_URI_FLAGS_ENCODED, NULL);
+    GBytes *bytes = g_bytes_new_static (data->str, data->len);
+    gchar *cache_dir, *key = NULL;
+
+    if ((cache_dir = g_dir_make_tmp ("bench-m3u-XXXXXX", &error))) {
+      GListStore *parsed = g_list_store_new (CLAPPER_TYPE_MEDIA_ITEM);
+
+      key = playlist_utils_cache_make_key (uri, bytes);
+      success = _parse_items (data, uri, parsed, cache_dir, key, &error);
+
+      g_clear_pointer (&key, g_free);
+      g_object_unref (parsed);
+    } else {
+      success = FALSE;
+    }
+
+    /* Key is made again, as parser enhancer hashes data on each load */
+    start = g_get_monotonic_time ();
+
+    if (success) {
+      key = playlist_utils_cache_make_key (uri, bytes);
+      success = playlist_utils_cache_restore (cache_dir, key, uri, playlist, NULL);
+      n_parsed = g_list_model_get_n_items (G_LIST_MODEL (playlist));
+    }
+
+    elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+    if (cache_dir)
+      _remove_cache_dir (cache_dir);
+
+    g_free (cache_dir);
+    g_free (key);
+    g_bytes_unref (bytes);
+    g_uri_unref (uri);
+    g_object_unref (playlist);
+  } else if (items) {
+    GListStore *playlist = g_list_store_new (CLAPPER_TYPE_MEDIA_ITEM);
+    GUri *uri = g_uri_parse ("http://example.com/playlist.m3u", G_URI_FLAGS_ENCODED, NULL);
+
+    start = g_get_monotonic_time ();
+
+    success = _parse_items (data, uri, playlist, NULL, NULL, &error);
+    n_parsed = g_list_model_get_n_items (G_LIST_MODEL (playlist));
+
+    elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+    g_uri_unref (uri);
+    g_object_unref (playlist);
+  } else {
+    start = g_get_monotonic_time ();
+
+    success = playlist_utils_parse_m3u (data->str, data->len,
+        _count_entry, &n_parsed, NULL, &error);
+
+    elapsed = MAX (g_get_monotonic_time () - start, 1);
+  }
+
+  if (!success || n_parsed != n_entries) {
+    g_printerr ("Parsing failed, got %u of %u entries: %s\n", n_parsed, n_entries,
+        (error) ? error->message : "no error");
+    g_clear_error (&error);
+    g_string_free (data, TRUE);
+
+    return 1;
+  }
+
+  g_print ("%u lines (%u items) in %.3f ms: %.0f lines/s, %.0f items/s\n",
+      n_lines, n_parsed, elapsed / 1000.0,
+      n_lines * (gdouble) G_USEC_PER_SEC / elapsed,
+      n_parsed * (gdouble) G_USEC_PER_SEC / elapsed);
+
+  g_string_free (data, TRUE);
+
+  return 0;
+}
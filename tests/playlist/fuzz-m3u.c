@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * libFuzzer entry point for M3U parsing. When not built with
+ * "fuzzing" option, it is run over the seed corpus by fuzz-main.c.
+ */
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "../../src/utils/c/playlist/playlist-utils.h"
+
+int LLVMFuzzerTestOneInput (const guint8 *data, gsize size);
+
+static gboolean
+_check_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  const gchar *title = NULL;
+
+  /* Locations are never empty and never start or end with whitespace */
+  g_assert_cmpint (len, >, 0);
+  g_assert_false (g_ascii_isspace (location[0]));
+  g_assert_false (g_ascii_isspace (location[len - 1]));
+
+  if (tags && gst_tag_list_peek_string_index (tags, GST_TAG_TITLE, 0, &title))
+    g_assert_cmpuint (strlen (title), >, 0);
+
+  return TRUE;
+}
+
+int
+LLVMFuzzerTestOneInput (const guint8 *data, gsize size)
+{
+  static gboolean initialized = FALSE;
+
+  if (!initialized) {
+    gst_init (NULL, NULL);
+    initialized = TRUE;
+  }
+
+  playlist_utils_parse_m3u ((const gchar *) data, size, _check_entry, NULL, NULL, NULL);
+
+  return 0;
+}
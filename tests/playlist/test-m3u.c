@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "../../src/utils/c/playlist/playlist-utils.h"
+
+typedef struct
+{
+  gchar *location;
+  gchar *title;
+  guint64 duration;
+} TestEntry;
+
+static void
+_test_entry_free (TestEntry *entry)
+{
+  g_free (entry->location);
+  g_free (entry->title);
+  g_free (entry);
+}
+
+static gboolean
+_collect_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  GPtrArray *entries = (GPtrArray *) user_data;
+  TestEntry *entry = g_new0 (TestEntry, 1);
+
+  entry->location = g_strndup (location, len);
+
+  if (tags) {
+    gst_tag_list_get_string (tags, GST_TAG_TITLE, &entry->title);
+    gst_tag_list_get_uint64 (tags, GST_TAG_DURATION, &entry->duration);
+  }
+
+  g_ptr_array_add (entries, entry);
+
+  return TRUE;
+}
+
+static gboolean
+_fail_second_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  guint *n_calls = (guint *) user_data;
+
+  if (++(*n_calls) == 2) {
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Rejected");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Parses copy of data without NUL terminator, so any read
+ * past the end is caught by sanitizers and valgrind */
+static GPtrArray *
+_parse (const gchar *data, gsize size, gboolean *success)
+{
+  GPtrArray *entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _test_entry_free);
+  gchar *copy = g_malloc (MAX (size, 1));
+  GError *error = NULL;
+
+  memcpy (copy, data, size);
+  *success = playlist_utils_parse_m3u (copy, size, _collect_entry, entries, NULL, &error);
+  g_assert_no_error (error);
+  g_free (copy);
+
+  return entries;
+}
+
+#define PARSE_STR(str, success) _parse (str, strlen (str), success)
+#define ENTRY(entries, index) ((TestEntry *) g_ptr_array_index (entries, index))
+
+static void
+test_m3u_crlf (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = PARSE_STR ("#EXTM3U\r\n"
+      "#EXTINF:10.5,First Title\r\n"
+      "http://example.com/1.mp4\r\n"
+      "\r\n"
+      "http://example.com/2.mp4\r\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 2);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "http://example.com/1.mp4");
+  g_assert_cmpstr (ENTRY (entries, 0)->title, ==, "First Title");
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 10.5 * GST_SECOND);
+  g_assert_cmpstr (ENTRY (entries, 1)->location, ==, "http://example.com/2.mp4");
+  g_assert_null (ENTRY (entries, 1)->title);
+
+  g_ptr_array_unref (entries);
+
+  /* Lone CR is not a line separator */
+  entries = PARSE_STR ("http://example.com/1.mp4\rhttp://example.com/2.mp4", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_m3u_bom (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = PARSE_STR ("\xEF\xBB\xBFhttp://example.com/1.mp4\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "http://example.com/1.mp4");
+
+  g_ptr_array_unref (entries);
+
+  /* BOM alone and truncated BOM */
+  entries = PARSE_STR ("\xEF\xBB\xBF", &success);
+  g_assert_false (success);
+  g_assert_cmpuint (entries->len, ==, 0);
+  g_ptr_array_unref (entries);
+
+  entries = _parse ("\xEF\xBB", 2, &success);
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_m3u_empty (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = _parse ("", 0, &success);
+  g_assert_false (success);
+  g_assert_cmpuint (entries->len, ==, 0);
+  g_ptr_array_unref (entries);
+
+  entries = PARSE_STR ("\n\n \r\n\t\n#EXTM3U\n#EXTINF:\n#EXTINF:,\n", &success);
+  g_assert_false (success);
+  g_assert_cmpuint (entries->len, ==, 0);
+  g_ptr_array_unref (entries);
+
+  /* Empty lines between EXTINF and its location keep tags */
+  entries = PARSE_STR ("#EXTINF:-1,Live\n\n\n  file.mp4  ", &success);
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "file.mp4");
+  g_assert_cmpstr (ENTRY (entries, 0)->title, ==, "Live");
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 0);
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_m3u_huge_lines (void)
+{
+  GString *data = g_string_new (NULL);
+  GPtrArray *entries;
+  gboolean success;
+  gsize i, huge_len = 4 * 1024 * 1024;
+
+  g_string_append (data, "#EXTINF:1e300,");
+  for (i = 0; i < huge_len; ++i)
+    g_string_append_c (data, 'T');
+  g_string_append (data, "\nhttp://example.com/");
+  for (i = 0; i < huge_len; ++i)
+    g_string_append_c (data, 'x');
+
+  entries = _parse (data->str, data->len, &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_assert_cmpuint (strlen (ENTRY (entries, 0)->location), ==, huge_len + 19);
+  g_assert_cmpuint (strlen (ENTRY (entries, 0)->title), ==, huge_len);
+
+  /* Duration that would overflow clock time is ignored */
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 0);
+
+  g_ptr_array_unref (entries);
+  g_string_free (data, TRUE);
+}
+
+static void
+test_m3u_extinf_attributes (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = PARSE_STR ("#EXTINF:5 tvg-name=\"A, B\" group-title=\"C\",Channel, One\n"
+      "http://example.com/live\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_assert_cmpstr (ENTRY (entries, 0)->title, ==, "Channel, One");
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 5 * GST_SECOND);
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_m3u_entry_error (void)
+{
+  const gchar *data = "a.mp4\nb.mp4\nc.mp4\n";
+  GError *error = NULL;
+  guint n_calls = 0;
+
+  g_assert_false (playlist_utils_parse_m3u (data, strlen (data),
+      _fail_second_entry, &n_calls, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_cmpuint (n_calls, ==, 2);
+
+  g_error_free (error);
+}
+
+static void
+test_m3u_cancelled (void)
+{
+  const gchar *data = "a.mp4\nb.mp4\nc.mp4\n";
+  GCancellable *cancellable = g_cancellable_new ();
+  GPtrArray *entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _test_entry_free);
+
+  g_cancellable_cancel (cancellable);
+
+  g_assert_false (playlist_utils_parse_m3u (data, strlen (data),
+      _collect_entry, entries, cancellable, NULL));
+  g_assert_cmpuint (entries->len, ==, 1);
+
+  g_ptr_array_unref (entries);
+  g_object_unref (cancellable);
+}
+
+static void
+_remove_cache_dir (const gchar *cache_dir)
+{
+  GDir *dir = g_dir_open (cache_dir, 0, NULL);
+  const gchar *name;
+
+  while ((name = g_dir_read_name (dir))) {
+    gchar *path = g_build_filename (cache_dir, name, NULL);
+
+    g_unlink (path);
+    g_free (path);
+  }
+
+  g_dir_close (dir);
+  g_rmdir (cache_dir);
+}
+
+static void
+test_m3u_cache_round_trip (void)
+{
+  const gchar *data = "#EXTM3U\n"
+      "#EXTINF:10.5,First Title\n"
+      "http://example.com/1.mp4\n"
+      "relative/2.mp4\n"
+      "#EXTINF:-1,Live\n"
+      "http://example.com/live\n";
+  GListStore *parsed = g_list_store_new (CLAPPER_TYPE_MEDIA_ITEM);
+  GListStore *restored = g_list_store_new (CLAPPER_TYPE_MEDIA_ITEM);
+  GUri *uri = g_uri_parse ("http://example.com/list/playlist.m3u", G_URI_FLAGS_ENCODED, NULL);
+  GBytes *bytes = g_bytes_new_static (data, strlen (data));
+  PlaylistUtilsBatch *batch;
+  GError *error = NULL;
+  gchar *cache_dir, *key;
+  guint i, n_items;
+
+  cache_dir = g_dir_make_tmp ("test-m3u-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  key = playlist_utils_cache_make_key (uri, bytes);
+
+  /* Nothing stored yet */
+  g_assert_false (playlist_utils_cache_restore (cache_dir, key, uri, restored, NULL));
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (restored)), ==, 0);
+
+  batch = playlist_utils_batch_new (uri, parsed);
+  playlist_utils_batch_set_recording (batch, TRUE);
+
+  g_assert_true (playlist_utils_parse_m3u (data, strlen (data),
+      (PlaylistUtilsEntryFunc) playlist_utils_batch_add_entry, batch, NULL, &error));
+  g_assert_no_error (error);
+  playlist_utils_batch_flush (batch);
+
+  g_assert_true (playlist_utils_cache_store (cache_dir, key, batch,
+      G_MAXUINT64, G_MAXUINT64, &error));
+  g_assert_no_error (error);
+  playlist_utils_batch_free (batch);
+
+  g_assert_true (playlist_utils_cache_restore (cache_dir, key, uri, restored, NULL));
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (parsed));
+  g_assert_cmpuint (n_items, ==, 3);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (restored)), ==, n_items);
+
+  for (i = 0; i < n_items; ++i) {
+    ClapperMediaItem *parsed_item = g_list_model_get_item (G_LIST_MODEL (parsed), i);
+    ClapperMediaItem *restored_item = g_list_model_get_item (G_LIST_MODEL (restored), i);
+    gchar *parsed_title = clapper_media_item_get_title (parsed_item);
+    gchar *restored_title = clapper_media_item_get_title (restored_item);
+
+    g_assert_cmpstr (clapper_media_item_get_uri (restored_item), ==,
+        clapper_media_item_get_uri (parsed_item));
+    g_assert_cmpstr (restored_title, ==, parsed_title);
+    g_assert_cmpfloat (clapper_media_item_get_duration (restored_item), ==,
+        clapper_media_item_get_duration (parsed_item));
+
+    if (i == 0) {
+      g_assert_cmpstr (restored_title, ==, "First Title");
+      g_assert_cmpfloat (clapper_media_item_get_duration (restored_item), ==, 10.5);
+    } else if (i == 1) {
+      g_assert_cmpstr (clapper_media_item_get_uri (restored_item), ==,
+          "http://example.com/list/relative/2.mp4");
+    }
+
+    g_free (parsed_title);
+    g_free (restored_title);
+    gst_object_unref (parsed_item);
+    gst_object_unref (restored_item);
+  }
+
+  _remove_cache_dir (cache_dir);
+
+  g_free (cache_dir);
+  g_free (key);
+  g_bytes_unref (bytes);
+  g_uri_unref (uri);
+  g_object_unref (parsed);
+  g_object_unref (restored);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  clapper_init (NULL, NULL);
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/playlist/m3u/crlf", test_m3u_crlf);
+  g_test_add_func ("/playlist/m3u/bom", test_m3u_bom);
+  g_test_add_func ("/playlist/m3u/empty", test_m3u_empty);
+  g_test_add_func ("/playlist/m3u/huge-lines", test_m3u_huge_lines);
+  g_test_add_func ("/playlist/m3u/extinf-attributes", test_m3u_extinf_attributes);
+  g_test_add_func ("/playlist/m3u/entry-error", test_m3u_entry_error);
+  g_test_add_func ("/playlist/m3u/cancelled", test_m3u_cancelled);
+  g_test_add_func ("/playlist/m3u/cache-round-trip", test_m3u_cache_round_trip);
+
+  return g_test_run ();
+}
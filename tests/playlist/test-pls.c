@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "../../src/utils/c/playlist/playlist-utils.h"
+
+typedef struct
+{
+  gchar *location;
+  gchar *title;
+  guint64 duration;
+} TestEntry;
+
+static void
+_test_entry_free (TestEntry *entry)
+{
+  g_free (entry->location);
+  g_free (entry->title);
+  g_free (entry);
+}
+
+static gboolean
+_collect_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  GPtrArray *entries = (GPtrArray *) user_data;
+  TestEntry *entry = g_new0 (TestEntry, 1);
+
+  entry->location = g_strndup (location, len);
+
+  if (tags) {
+    gst_tag_list_get_string (tags, GST_TAG_TITLE, &entry->title);
+    gst_tag_list_get_uint64 (tags, GST_TAG_DURATION, &entry->duration);
+  }
+
+  g_ptr_array_add (entries, entry);
+
+  return TRUE;
+}
+
+static gboolean
+_fail_second_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  guint *n_calls = (guint *) user_data;
+
+  if (++(*n_calls) == 2) {
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Rejected");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Parses copy of data without NUL terminator, so any read
+ * past the end is caught by sanitizers and valgrind */
+static GPtrArray *
+_parse (const gchar *data, gsize size, gboolean *success)
+{
+  GPtrArray *entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _test_entry_free);
+  gchar *copy = g_malloc (MAX (size, 1));
+  GError *error = NULL;
+
+  memcpy (copy, data, size);
+  *success = playlist_utils_parse_pls (copy, size, _collect_entry, entries, NULL, &error);
+  g_assert_no_error (error);
+  g_free (copy);
+
+  return entries;
+}
+
+#define PARSE_STR(str, success) _parse (str, strlen (str), success)
+#define ENTRY(entries, index) ((TestEntry *) g_ptr_array_index (entries, index))
+
+static void
+test_pls_basic (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = PARSE_STR ("[playlist]\r\n"
+      "NumberOfEntries=2\r\n"
+      "File1=http://example.com/1.mp4\r\n"
+      "Title1=First Title\r\n"
+      "Length1=10\r\n"
+      "File2 = http://example.com/2.mp4 \r\n"
+      "Length2=-1\r\n"
+      "Version=2\r\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 2);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "http://example.com/1.mp4");
+  g_assert_cmpstr (ENTRY (entries, 0)->title, ==, "First Title");
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 10 * GST_SECOND);
+  g_assert_cmpstr (ENTRY (entries, 1)->location, ==, "http://example.com/2.mp4");
+  g_assert_null (ENTRY (entries, 1)->title);
+
+  /* Negative length means live stream */
+  g_assert_cmpuint (ENTRY (entries, 1)->duration, ==, 0);
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_pls_order (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  /* Entries are sorted by their numbers, missing numbers are skipped */
+  entries = PARSE_STR ("[playlist]\n"
+      "Title3=Third\n"
+      "File3=c.mp4\n"
+      "File1=a.mp4\n"
+      "Title2=Without file\n"
+      "File0=zero.mp4\n"
+      "File01x=invalid.mp4\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 2);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "a.mp4");
+  g_assert_cmpstr (ENTRY (entries, 1)->location, ==, "c.mp4");
+  g_assert_cmpstr (ENTRY (entries, 1)->title, ==, "Third");
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_pls_case_and_bom (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = PARSE_STR ("\xEF\xBB\xBF[Playlist]\nfile1=a.mp4\nTITLE1=Upper\nlEnGtH1=5\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "a.mp4");
+  g_assert_cmpstr (ENTRY (entries, 0)->title, ==, "Upper");
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 5 * GST_SECOND);
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_pls_out_of_range (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  /* Number bigger than amount of entries that could fit in data */
+  entries = PARSE_STR ("File4294967295=a.mp4\nFile99999999999=b.mp4\n"
+      "File1=c.mp4\nLength1=99999999999999999999\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "c.mp4");
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 0);
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_pls_empty (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = _parse ("", 0, &success);
+  g_assert_false (success);
+  g_assert_cmpuint (entries->len, ==, 0);
+  g_ptr_array_unref (entries);
+
+  entries = PARSE_STR ("[playlist]\nNumberOfEntries=0\nFile1=\n\n", &success);
+  g_assert_false (success);
+  g_assert_cmpuint (entries->len, ==, 0);
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_pls_entry_error (void)
+{
+  const gchar *data = "File1=a.mp4\nFile2=b.mp4\nFile3=c.mp4\n";
+  GError *error = NULL;
+  guint n_calls = 0;
+
+  g_assert_false (playlist_utils_parse_pls (data, strlen (data),
+      _fail_second_entry, &n_calls, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_cmpuint (n_calls, ==, 2);
+
+  g_error_free (error);
+}
+
+static void
+test_pls_cancelled (void)
+{
+  const gchar *data = "File1=a.mp4\nFile2=b.mp4\nFile3=c.mp4\n";
+  GCancellable *cancellable = g_cancellable_new ();
+  GPtrArray *entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _test_entry_free);
+
+  g_cancellable_cancel (cancellable);
+
+  g_assert_false (playlist_utils_parse_pls (data, strlen (data),
+      _collect_entry, entries, cancellable, NULL));
+
+  g_ptr_array_unref (entries);
+  g_object_unref (cancellable);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  gst_init (NULL, NULL);
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/playlist/pls/basic", test_pls_basic);
+  g_test_add_func ("/playlist/pls/order", test_pls_order);
+  g_test_add_func ("/playlist/pls/case-and-bom", test_pls_case_and_bom);
+  g_test_add_func ("/playlist/pls/out-of-range", test_pls_out_of_range);
+  g_test_add_func ("/playlist/pls/empty", test_pls_empty);
+  g_test_add_func ("/playlist/pls/entry-error", test_pls_entry_error);
+  g_test_add_func ("/playlist/pls/cancelled", test_pls_cancelled);
+
+  return g_test_run ();
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2025 Rafał Dzięgiel <rafostar.github@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "../../src/utils/c/playlist/playlist-utils.h"
+
+typedef struct
+{
+  gchar *location;
+  gchar *title;
+  gchar *artist;
+  guint64 duration;
+} TestEntry;
+
+static void
+_test_entry_free (TestEntry *entry)
+{
+  g_free (entry->location);
+  g_free (entry->title);
+  g_free (entry->artist);
+  g_free (entry);
+}
+
+static gboolean
+_collect_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  GPtrArray *entries = (GPtrArray *) user_data;
+  TestEntry *entry = g_new0 (TestEntry, 1);
+
+  entry->location = g_strndup (location, len);
+
+  if (tags) {
+    gst_tag_list_get_string (tags, GST_TAG_TITLE, &entry->title);
+    gst_tag_list_get_string (tags, GST_TAG_ARTIST, &entry->artist);
+    gst_tag_list_get_uint64 (tags, GST_TAG_DURATION, &entry->duration);
+  }
+
+  g_ptr_array_add (entries, entry);
+
+  return TRUE;
+}
+
+static gboolean
+_fail_second_entry (gpointer user_data, const gchar *location, gssize len,
+    GstTagList *tags, GError **error)
+{
+  guint *n_calls = (guint *) user_data;
+
+  if (++(*n_calls) == 2) {
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Rejected");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Parses copy of data without NUL terminator, so any read
+ * past the end is caught by sanitizers and valgrind */
+static GPtrArray *
+_parse (const gchar *data, gsize size, gboolean *success)
+{
+  GPtrArray *entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _test_entry_free);
+  gchar *copy = g_malloc (MAX (size, 1));
+  GError *error = NULL;
+
+  memcpy (copy, data, size);
+  *success = playlist_utils_parse_xspf (copy, size, _collect_entry, entries, NULL, &error);
+  g_assert_no_error (error);
+  g_free (copy);
+
+  return entries;
+}
+
+#define PARSE_STR(str, success) _parse (str, strlen (str), success)
+#define ENTRY(entries, index) ((TestEntry *) g_ptr_array_index (entries, index))
+
+static void
+test_xspf_basic (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  entries = PARSE_STR ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+      "  <title>Playlist Title</title>\n"
+      "  <trackList>\n"
+      "    <track>\n"
+      "      <location> http://example.com/1.mp4 </location>\n"
+      "      <location>http://example.com/alt.mp4</location>\n"
+      "      <title>First &amp; Best</title>\n"
+      "      <creator>Artist</creator>\n"
+      "      <duration>1500</duration>\n"
+      "    </track>\n"
+      "    <track><location><![CDATA[http://example.com/2.mp4?a=1&b=2]]></location></track>\n"
+      "    <track><title>Without location</title></track>\n"
+      "  </trackList>\n"
+      "</playlist>\n", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 2);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "http://example.com/1.mp4");
+  g_assert_cmpstr (ENTRY (entries, 0)->title, ==, "First & Best");
+  g_assert_cmpstr (ENTRY (entries, 0)->artist, ==, "Artist");
+  g_assert_cmpuint (ENTRY (entries, 0)->duration, ==, 1500 * GST_MSECOND);
+  g_assert_cmpstr (ENTRY (entries, 1)->location, ==, "http://example.com/2.mp4?a=1&b=2");
+  g_assert_null (ENTRY (entries, 1)->title);
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_xspf_bom (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+
+  /* BOM without XML declaration */
+  entries = PARSE_STR ("\xEF\xBB\xBF<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">"
+      "<trackList><track><location>a.mp4</location></track></trackList></playlist>", &success);
+
+  g_assert_true (success);
+  g_assert_cmpuint (entries->len, ==, 1);
+  g_assert_cmpstr (ENTRY (entries, 0)->location, ==, "a.mp4");
+
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_xspf_invalid (void)
+{
+  GPtrArray *entries;
+  gboolean success;
+  GError *error = NULL;
+  const gchar *data = "<playlist><trackList><track><location>a.mp4</track>";
+
+  entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _test_entry_free);
+  g_assert_false (playlist_utils_parse_xspf (data, strlen (data),
+      _collect_entry, entries, NULL, &error));
+  g_assert_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_PARSE);
+  g_assert_cmpuint (entries->len, ==, 0);
+  g_clear_error (&error);
+  g_ptr_array_unref (entries);
+
+  entries = PARSE_STR ("<playlist><trackList/></playlist>", &success);
+  g_assert_false (success);
+  g_assert_cmpuint (entries->len, ==, 0);
+  g_ptr_array_unref (entries);
+}
+
+static void
+test_xspf_entry_error (void)
+{
+  const gchar *data = "<playlist><trackList>"
+      "<track><location>a.mp4</location></track>"
+      "<track><location>b.mp4</location></track>"
+      "<track><location>c.mp4</location></track>"
+      "</trackList></playlist>";
+  GError *error = NULL;
+  guint n_calls = 0;
+
+  g_assert_false (playlist_utils_parse_xspf (data, strlen (data),
+      _fail_second_entry, &n_calls, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_cmpuint (n_calls, ==, 2);
+
+  g_error_free (error);
+}
+
+static void
+test_xspf_cancelled (void)
+{
+  const gchar *data = "<playlist><trackList>"
+      "<track><location>a.mp4</location></track>"
+      "<track><location>b.mp4</location></track>"
+      "<track><location>c.mp4</location></track>"
+      "</trackList></playlist>";
+  GCancellable *cancellable = g_cancellable_new ();
+  GPtrArray *entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _test_entry_free);
+
+  g_cancellable_cancel (cancellable);
+
+  g_assert_false (playlist_utils_parse_xspf (data, strlen (data),
+      _collect_entry, entries, cancellable, NULL));
+
+  g_ptr_array_unref (entries);
+  g_object_unref (cancellable);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  gst_init (NULL, NULL);
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/playlist/xspf/basic", test_xspf_basic);
+  g_test_add_func ("/playlist/xspf/bom", test_xspf_bom);
+  g_test_add_func ("/playlist/xspf/invalid", test_xspf_invalid);
+  g_test_add_func ("/playlist/xspf/entry-error", test_xspf_entry_error);
+  g_test_add_func ("/playlist/xspf/cancelled", test_xspf_cancelled);
+
+  return g_test_run ();
+}